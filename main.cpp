@@ -1,7 +1,71 @@
+#include <cstring>
+#include <iostream>
+
+#include "src/BatchRunner.hpp"
+#include "src/GeneratorRunner.hpp"
+#include "src/LoadGenerator.hpp"
+#include "src/PathServer.hpp"
+#ifdef ASTAR_WITH_SFML
 #include "src/MapSearcher.hpp"
+#endif
 
 int main(int argc, char *argv[])
 {
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+    {
+        BatchRunner::Options options;
+        std::string error;
+        if (!BatchRunner::parseOptions(argc, argv, options, error))
+        {
+            std::cerr << error << std::endl;
+            BatchRunner::printUsage(std::cerr, argv[0]);
+            return 1;
+        }
+        BatchRunner runner;
+        return runner.run(options);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--generate") == 0)
+    {
+        GeneratorRunner::Options options;
+        std::string error;
+        if (!GeneratorRunner::parseOptions(argc, argv, options, error))
+        {
+            std::cerr << error << std::endl;
+            GeneratorRunner::printUsage(std::cerr, argv[0]);
+            return 1;
+        }
+        return GeneratorRunner::run(options);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+    {
+        PathServer::Options options;
+        std::string error;
+        if (!PathServer::parseOptions(argc, argv, options, error))
+        {
+            std::cerr << error << std::endl;
+            PathServer::printUsage(std::cerr, argv[0]);
+            return 1;
+        }
+        PathServer server;
+        return server.run(options);
+    }
+
+    if (argc > 1 && strcmp(argv[1], "--load") == 0)
+    {
+        LoadGenerator::Options options;
+        std::string error;
+        if (!LoadGenerator::parseOptions(argc, argv, options, error))
+        {
+            std::cerr << error << std::endl;
+            LoadGenerator::printUsage(std::cerr, argv[0]);
+            return 1;
+        }
+        return LoadGenerator::run(options);
+    }
+
+#ifdef ASTAR_WITH_SFML
     srand(time(0));
     bool isShutDown = false;
     while (!isShutDown)
@@ -10,4 +74,12 @@ int main(int argc, char *argv[])
         isShutDown = search.run();
     }
     return 0;
+#else
+    std::cerr << "Built without SFML, only batch mode is available" << std::endl;
+    BatchRunner::printUsage(std::cerr, argv[0]);
+    GeneratorRunner::printUsage(std::cerr, argv[0]);
+    PathServer::printUsage(std::cerr, argv[0]);
+    LoadGenerator::printUsage(std::cerr, argv[0]);
+    return 1;
+#endif
 }
@@ -1,14 +1,19 @@
 #pragma once
 #include <assert.h>
-#include <memory>
 #include <algorithm>
-#include <deque>
 #include <cfloat>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Trace.hpp"
 
 using std::deque;
 using std::find_if;
-using std::make_shared;
-using std::shared_ptr;
 
 /**
  * @brief Enum class for determination of current state of search
@@ -21,51 +26,131 @@ enum class SearchState
     OUT_OF_MEMORY
 };
 
+namespace detail
+{
+    /**
+     * @brief True if UserState has optional bool isReachable(UserState &goal) used to reject queries without search
+     */
+    template <class T, class = void>
+    struct HasReachabilityCheck : std::false_type
+    {
+    };
+
+    template <class T>
+    struct HasReachabilityCheck<T, std::void_t<decltype(std::declval<T &>().isReachable(std::declval<T &>()))>> : std::true_type
+    {
+    };
+
+    /**
+     * @brief True if UserState has optional size_t getStateIndex() const, dense index equal for the same states
+     */
+    template <class T, class = void>
+    struct HasStateIndex : std::false_type
+    {
+    };
+
+    template <class T>
+    struct HasStateIndex<T, std::void_t<decltype(std::declval<const T &>().getStateIndex())>> : std::true_type
+    {
+    };
+
+    /**
+     * @brief True if UserState has optional uint64_t getStateKey() const, sparse key equal for the same states
+     */
+    template <class T, class = void>
+    struct HasStateKey : std::false_type
+    {
+    };
+
+    template <class T>
+    struct HasStateKey<T, std::void_t<decltype(std::declval<const T &>().getStateKey())>> : std::true_type
+    {
+    };
+}
+
 /**
  * @brief The AStar search class. UserState is the users state space type
  *
+ * Nodes are kept in structure-of-arrays pool and referenced by 32-bit index, so search data
+ * of one node is two costs and parent index. f is computed as g + h when it is needed.
+ * Integer CostT avoids float rounding if all costs of UserState are integral, fractional costs such as
+ * diagonal moves of MapSearchNode need floating point CostT (see isCostExact).
+ * Whole node with 8 byte MapSearchNode and 4 byte CostT takes 32 bytes (see getBytesPerNode):
+ * 8 of state, 12 of search data and 12 of list bookkeeping.
+ * Open list is a binary heap that tracks position of every node, so improved nodes are moved up in O(log n).
+ * If UserState has getStateIndex() existing node of a state is found in O(1) through a table indexed by it,
+ * if it has getStateKey() through a hash table keyed by it, otherwise open and closed lists are scanned for every successor
+ *
  * @tparam UserState class that satisfies _AbstractUserState interface
+ * @tparam CostT type of g and h, float or integer type
  */
-template <class UserState>
+template <class UserState, class CostT = float>
 class AStarSearch
 {
 
 public:
     /**
-     * @brief A node represents a possible state in the search
+     * @brief Index of node in node pool
+     */
+    using NodeId = uint32_t;
+    static constexpr NodeId NO_NODE = UINT32_MAX;
+    static constexpr uint32_t NOT_OPEN = UINT32_MAX;
+    static constexpr CostT NO_COST = std::numeric_limits<CostT>::max();
+
+    /**
+     * @brief Bytes of search data (g, h, parent) stored per node, excluding UserState and list bookkeeping
      */
-    class Node
+    static constexpr size_t NODE_SEARCH_DATA_SIZE = 2 * sizeof(CostT) + sizeof(NodeId);
+
+    /**
+     * @brief Class comparator of open list heap
+     */
+    class NodeComparator
     {
     public:
-        shared_ptr<Node> parent; // used during the search to record the parent of successor nodes
-        shared_ptr<Node> child;  // used after the search for the application to view the search in reverse
-
-        float g; // cost of this node + it's predecessors
-        float h; // heuristic estimate of distance to goal
-        float f; // sum of cumulative cost of predecessors and self and heuristic
+        explicit NodeComparator(const AStarSearch *search) : m_search(search) {}
 
-        Node() : parent(0),
-                 child(0),
-                 g(0.0f),
-                 h(0.0f),
-                 f(0.0f)
+        // x > y
+        bool operator()(const NodeId x, const NodeId y) const
         {
+            if (m_search->m_nodeLimit == 0)
+            {
+                return m_search->_f(x) > m_search->_f(y);
+            }
+            // Memory bounded search expands the deepest of equal nodes, so it goes on instead of regenerating forgotten ones
+            const CostT keyX = m_search->_openKey(x);
+            const CostT keyY = m_search->_openKey(y);
+            if (keyX == keyY)
+            {
+                return m_search->m_g[x] < m_search->m_g[y];
+            }
+            return keyX > keyY;
         }
 
-        UserState userState;
+    private:
+        const AStarSearch *m_search;
     };
 
     /**
-     * @brief Class comparator for sorting a heap using STL push_heap, make_heap, pop_heap
+     * @brief Interface to watch the search progress. All callbacks are invoked
+     * from the thread that runs the search
      */
-    class NodeComparator
+    class Observer
     {
     public:
-        // x > y
-        bool operator()(const shared_ptr<Node> x, const shared_ptr<Node> y) const
-        {
-            return x->f > y->f;
-        }
+        virtual ~Observer() {}
+        /**
+         * @brief Node was expanded and moved to closed list
+         */
+        virtual void onExpand(const UserState &state) = 0;
+        /**
+         * @brief Node was pushed to open list
+         */
+        virtual void onGenerate(const UserState &state) = 0;
+        /**
+         * @brief Search is over. Solution is empty if search was not succeeded
+         */
+        virtual void onFinish(SearchState result, const deque<UserState> &solution) = 0;
     };
 
     /**
@@ -76,28 +161,35 @@ public:
      */
     AStarSearch(UserState &start, UserState &goal)
     {
+        ASTAR_TRACE_SPAN("astar setup");
         m_start = _allocateNode();
         m_goal = _allocateNode();
 
-        assert((m_start != nullptr && m_goal != nullptr));
+        assert((m_start != NO_NODE && m_goal != NO_NODE));
+        m_peakNodes = _liveNodeCount();
 
-        m_start->userState = start;
-        m_goal->userState = goal;
+        m_states[m_start] = start;
+        m_states[m_goal] = goal;
 
         m_state = SearchState::SEARCHING;
 
         // Initialise the AStar specific parts of the start Node
-        m_start->g = 0;
-        m_start->h = m_start->userState.goalDistanceEstimate(m_goal->userState);
-        m_start->f = m_start->g + m_start->h;
-        m_start->parent = 0;
+        m_g[m_start] = 0;
+        m_h[m_start] = static_cast<CostT>(m_states[m_start].goalDistanceEstimate(m_states[m_goal]));
+        m_parent[m_start] = NO_NODE;
 
-        // Push the start node on the open nodes as not expanded yet
-        m_openNodes.push_back(m_start); // heap now unsorted
+        // Goal that can't be reached leaves open list empty, so the first step fails at once
+        if constexpr (detail::HasReachabilityCheck<UserState>::value)
+        {
+            if (!m_states[m_start].isReachable(m_states[m_goal]))
+            {
+                return;
+            }
+        }
 
-        // Sort back element into heap
-        // As open nodes was empty we can skip step with make_head invocation
-        std::push_heap(m_openNodes.begin(), m_openNodes.end(), NodeComparator());
+        // Push the start node on the open nodes as not expanded yet
+        _registerState(m_start);
+        _pushOpen(m_start);
     }
 
     /**
@@ -105,6 +197,7 @@ public:
      */
     SearchState preformSearch()
     {
+        ASTAR_TRACE_SPAN("astar search");
         SearchState searchState;
         do
         {
@@ -115,6 +208,22 @@ public:
         return searchState;
     }
 
+    /**
+     * @brief Continue succeeded search to the next goal when goal is a set of states (see MultiGoalSearchNode).
+     * Found goal is expanded first, so UserState should stop treating it as goal before this call,
+     * otherwise the same goal is found again. Goals come in order of their path cost
+     */
+    SearchState resumeSearch()
+    {
+        if (m_state != SearchState::SUCCEEDED)
+        {
+            return m_state;
+        }
+        m_state = SearchState::SEARCHING;
+        _pushOpen(m_found);
+        return preformSearch();
+    }
+
     /**
      * @brief Function that allows user to add new successors of given node to continue search
      *
@@ -123,11 +232,11 @@ public:
      */
     bool addSuccessor(UserState &state)
     {
-        shared_ptr<Node> node = _allocateNode();
+        NodeId node = _allocateNode();
 
-        if (node)
+        if (node != NO_NODE)
         {
-            node->userState = state;
+            m_states[node] = state;
             m_successors.push_back(node);
 
             return true;
@@ -137,16 +246,89 @@ public:
     }
 
     /**
-     * @brief Function to put all solution nodes in deque for comfortble use
+     * @brief Set observer to be notified about search progress. Pass nullptr to detach
+     */
+    void setObserver(Observer *observer) { m_observer = observer; }
+
+    /**
+     * @brief Limit number of nodes alive in the pool, 0 means no limit. When limit is reached,
+     * open leaves with the worst f are forgotten as in SMA*: parent keeps state and f of every forgotten child,
+     * goes back to open list with the lowest of them and regenerates them with their backed up f
+     * when they become the best choice again. Closed nodes whose children are all forgotten are forgotten too,
+     * so their f is backed up into their parent. Records of forgotten children are kept apart from the limit,
+     * there are at most as many of them per node as it has successors.
+     * Node too deep to reach the goal within the limit is forgotten as hopeless instead of being expanded,
+     * so search succeeds whenever the limit is larger than the number of nodes on the solution path
+     * and ends with OUT_OF_MEMORY only if the goal can't be reached within it.
+     * Pool may exceed the limit only by successors of the node being expanded until the worst of them are forgotten.
+     * Of nodes with equal f the deepest is expanded and the shallowest is forgotten.
+     * Cost is optimal when the optimal path fits into the limit, otherwise a more expensive path that fits is found.
+     * Forgotten nodes are expanded again, so search time grows quickly when limit is much smaller than
+     * peak node count of unlimited search, most of all with many distinct costs. Set it before the search
+     */
+    void setNodeLimit(size_t limit)
+    {
+        m_nodeLimit = limit;
+        const size_t size = limit > 0 ? m_states.size() : 0;
+        m_forgottenF.resize(size, NO_COST);
+        m_forgottenHead.resize(size, NO_RECORD);
+        m_depth.resize(size, 0);
+        m_childCount.resize(size, 0);
+        m_closedPosition.resize(size, NOT_CLOSED);
+        m_parentG.resize(size, 0);
+    }
+
+    /**
+     * @brief Same as setNodeLimit with limit in bytes, see getBytesPerNode
+     */
+    void setMemoryLimit(size_t bytes) { setNodeLimit(std::max<size_t>(1, bytes / getBytesPerNode())); }
+
+    /**
+     * @brief True if step cost is held by CostT without truncation. Integer CostT would round diagonal
+     * and other fractional costs down and return wrong paths, so search asserts it for every step
+     */
+    template <class T>
+    static constexpr bool isCostExact(T cost)
+    {
+        return !std::is_integral<CostT>::value || static_cast<T>(static_cast<CostT>(cost)) == cost;
+    }
+
+    /**
+     * @brief Memory used by one node: state, search data, open or closed list entry, open list position and free list entry.
+     * Table of getStateIndex() is sized by the state space and is not included
+     */
+    static constexpr size_t getBytesPerNode() { return sizeof(UserState) + NODE_SEARCH_DATA_SIZE + 3 * sizeof(NodeId); }
+
+    /**
+     * @brief Largest number of nodes alive at once after each search step. Records of forgotten children
+     * are not counted
+     */
+    size_t getPeakNodeCount() const { return m_peakNodes; }
+
+    size_t getPeakMemoryBytes() const { return m_peakNodes * getBytesPerNode(); }
+
+    /**
+     * @brief Number of nodes forgotten because of node limit
+     */
+    size_t getPrunedNodeCount() const { return m_prunedNodes; }
+
+    /**
+     * @brief Function to put all solution nodes in deque for comfortble use.
+     * Nodes don't store child links, so path is restored by walking parents back from goal
      */
     deque<UserState> linearizeSolution()
     {
+        ASTAR_TRACE_SPAN("astar path");
         deque<UserState> solution;
-        shared_ptr<Node> current_node = m_start;
-        while (current_node)
+        if (m_state != SearchState::SUCCEEDED)
+        {
+            solution.push_back(m_states[m_start]);
+            return solution;
+        }
+        // Path ends at the found state, which for goal sets differs from goal passed in
+        for (NodeId node = m_found; node != NO_NODE; node = m_parent[node])
         {
-            solution.push_back(current_node->userState);
-            current_node = current_node->child;
+            solution.push_front(m_states[node]);
         }
         return solution;
     }
@@ -159,9 +341,9 @@ public:
      */
     float getSolutionCost()
     {
-        if (m_goal && m_state == SearchState::SUCCEEDED)
+        if (m_goal != NO_NODE && m_state == SearchState::SUCCEEDED)
         {
-            return m_goal->g;
+            return static_cast<float>(m_g[m_goal]);
         }
         else
         {
@@ -174,20 +356,65 @@ public:
      */
     unsigned int getStepCount() const { return m_expandedNodes.size(); }
 
+    /**
+     * @brief Get number of nodes ever allocated in node pool (freed nodes are reused)
+     */
+    size_t getAllocatedNodeCount() const { return m_states.size(); }
+
     /**
      * @brief Get the visited nodes
      */
     deque<UserState> getVisitedNodes() const
     {
         deque<UserState> visited;
-        for (const auto node : m_expandedNodes)
+        for (const NodeId node : m_expandedNodes)
         {
-            visited.push_back(node->userState);
+            visited.push_back(m_states[node]);
         }
         return visited;
     }
 
 private:
+    static constexpr uint32_t NO_RECORD = UINT32_MAX;
+    static constexpr uint32_t NOT_CLOSED = UINT32_MAX;
+
+    /**
+     * @brief Child forgotten because of node limit, it stays in the list of its parent until parent regenerates it
+     */
+    struct ForgottenChild
+    {
+        UserState state;
+        CostT g;
+        CostT f; // NO_COST if path through child doesn't fit into the limit
+        uint32_t depth;
+        NodeId parent; // NO_NODE if record is free
+        uint32_t next;
+    };
+
+    /**
+     * @brief Open leaf with its key and depth at the time it was added to the heap of leaves
+     */
+    struct LeafEntry
+    {
+        CostT key;
+        uint32_t depth;
+        NodeId node;
+    };
+
+    CostT _f(NodeId node) const
+    {
+        return m_g[node] + m_h[node];
+    }
+
+    /**
+     * @brief Priority of node in open list with node limit. Parent that waits to regenerate forgotten children
+     * is not needed before the best of them
+     */
+    CostT _openKey(NodeId node) const
+    {
+        return m_forgottenF[node] == NO_COST ? _f(node) : std::max(_f(node), m_forgottenF[node]);
+    }
+
     /**
      * @brief Function to preform one search step
      *
@@ -201,47 +428,63 @@ private:
             return m_state;
         }
 
-        // If we have no other nodes to expand then there is no solution and the search is failed
+        // If we have no other nodes to expand then there is no solution and the search is failed.
+        // With node limit paths that didn't fit into it may still lead to the goal
         if (m_openNodes.empty())
         {
-            m_state = SearchState::FAILED;
+            m_state = m_cutNodes > 0 ? SearchState::OUT_OF_MEMORY : SearchState::FAILED;
+            if (m_observer)
+            {
+                m_observer->onFinish(m_state, deque<UserState>());
+            }
             return m_state;
         }
 
         // Pop the best node (the one with the lowest f)
-        shared_ptr<Node> current_node = m_openNodes.front(); // get pointer to the node
-        std::pop_heap(m_openNodes.begin(), m_openNodes.end(), NodeComparator());
-        m_openNodes.pop_back();
+        NodeId current_node = m_openNodes.front(); // get index of the node
+        _removeOpen(current_node);
+
+        // Parent got cheaper after it reached the node, so node goes back with the new cost first
+        if (m_nodeLimit > 0 && _isStale(current_node))
+        {
+            _refresh(current_node);
+            _pushOpen(current_node);
+            _updateLeaf(current_node);
+            return m_state;
+        }
 
         // Check for the goal, once we pop that we're done
-        if (current_node->userState.isGoal(m_goal->userState))
+        if (m_states[current_node].isGoal(m_states[m_goal]))
         {
             // The user may want to use the Goal Node he passed in
-            // so copy the parent pointer of current_node
-            m_goal->parent = current_node->parent;
-            m_goal->g = current_node->g;
-
-            // A special case is that the goal was passed in as the start state
-            if (current_node->userState.isSameState(m_start->userState) == false)
-            {
-                _freeNode(current_node);
+            // so copy the parent of current_node
+            m_parent[m_goal] = m_parent[current_node];
+            m_g[m_goal] = m_g[current_node];
 
-                // set the child pointers in each node (except goal which has no child)
-                shared_ptr<Node> nodeChild = m_goal;
-                shared_ptr<Node> nodeParent = m_goal->parent;
-
-                while (nodeChild != m_start)
-                {
-                    nodeParent->child = nodeChild;
-                    nodeChild = nodeParent;
-                    nodeParent = nodeParent->parent;
-                }
-            }
+            // Found node is kept for the solution and to resume the search from it
+            m_found = current_node;
 
             m_state = SearchState::SUCCEEDED;
+            if (m_observer)
+            {
+                m_observer->onFinish(m_state, linearizeSolution());
+            }
 
             return m_state;
         }
+        else if (m_nodeLimit > 0 && m_depth[current_node] + 3 > m_nodeLimit && m_childCount[current_node] == 0)
+        {
+            // Path to a successor and goal node wouldn't fit into the limit, so parent backs up infinite f
+            ++m_cutNodes;
+            if (m_parent[current_node] == NO_NODE)
+            {
+                _pushClosed(current_node);
+            }
+            else
+            {
+                _forget(current_node, NO_COST);
+            }
+        }
         else // not goal
         {
 
@@ -252,167 +495,831 @@ private:
             m_successors.clear(); // empty vector of successor nodes to current_node
 
             // User provides this functions and uses AddSuccessor to add each successor of
-            // node 'current_node' to m_Successors
-            auto parent = current_node->parent ? &current_node->parent->userState : nullptr;
-            bool ret = current_node->userState.getSuccessors(this, parent);
+            // node 'current_node' to m_Successors.
+            // Parent state is copied as pool may grow and move states while successors are added
+            const NodeId parentNode = m_parent[current_node];
+            UserState parentState;
+            UserState *parent = nullptr;
+            if (parentNode != NO_NODE)
+            {
+                parentState = m_states[parentNode];
+                parent = &parentState;
+            }
+            UserState currentState = m_states[current_node];
+            bool ret = currentState.getSuccessors(this, parent);
 
             if (!ret)
             {
-                iterator_t successor;
-
                 // free the nodes that may previously have been added
+                for (const NodeId successor : m_successors)
+                {
+                    _freeNode(successor);
+                }
                 m_successors.clear(); // empty vector of successor nodes to current_node
 
                 // free up everything else we allocated
                 _freeNode(current_node);
 
                 m_state = SearchState::OUT_OF_MEMORY;
+                if (m_observer)
+                {
+                    m_observer->onFinish(m_state, deque<UserState>());
+                }
                 return m_state;
             }
 
             // Now handle each successor to the current node ...
-            for (auto successor = m_successors.begin(); successor != m_successors.end(); successor++)
+            for (const NodeId successor : m_successors)
             {
 
                 // 	The g value for this successor
-                float newg = current_node->g + current_node->userState.getCost((*successor)->userState);
+                const auto cost = currentState.getCost(m_states[successor]);
+                assert(isCostExact(cost));
+                CostT newg = m_g[current_node] + static_cast<CostT>(cost);
+                const uint32_t newDepth = m_nodeLimit > 0 ? m_depth[current_node] + 1 : 0;
 
-                // Now we need to find whether the node is on the open or closed lists
+                // Now we need to find whether the state is on the open or closed lists
                 // If it is but the node that is already on them is better (lower g)
                 // then we can forget about this successor
+                const NodeId existing = _findNode(successor);
+                if (existing != NO_NODE && !_isBetterPath(newg, newDepth, m_g[existing], m_nodeLimit > 0 ? m_depth[existing] : 0))
+                {
+                    _freeNode(successor);
+                    continue;
+                }
+                // Hopeless child stays forgotten, state forgotten not worse by another parent is regenerated by that parent
+                uint32_t record = NO_RECORD;
+                if (existing == NO_NODE && m_prunedNodes > 0)
+                {
+                    record = _findForgotten(current_node, m_states[successor]);
+                    if (record != NO_RECORD &&
+                        (m_forgotten[record].parent == current_node
+                             ? m_forgotten[record].f == NO_COST
+                             : !_isBetterPath(newg, newDepth, m_forgotten[record].g, m_forgotten[record].depth)))
+                    {
+                        _freeNode(successor);
+                        continue;
+                    }
+                }
 
-                // First linear search of open list to find node
-
-                iterator_t openListResult = find_if(m_openNodes.begin(), m_openNodes.end(), [successor](shared_ptr<Node> node)
-                                                    { return node->userState.isSameState((*successor)->userState); });
+                // The current node is the best node so far with this particular state
 
-                // we found same state on open
-                if (openListResult != m_openNodes.end())
+                CostT newh = static_cast<CostT>(m_states[successor].goalDistanceEstimate(m_states[m_goal]));
+                // Pathmax: after pruning children must not look better than their parent,
+                // forgotten child gets back its backed up f
+                if (m_prunedNodes > 0)
                 {
-                    if ((*openListResult)->g <= newg)
+                    CostT minF = _f(current_node);
+                    if (record != NO_RECORD && m_forgotten[record].parent == current_node)
                     {
-                        // instance in the Open is cheaper than the current one
-                        _freeNode((*successor));
-                        // Continue with next successor
-                        continue;
+                        minF = std::max(minF, m_forgotten[record].f);
+                    }
+                    if (minF > newg + newh)
+                    {
+                        newh = minF - newg;
                     }
                 }
 
-                iterator_t closedListResult = find_if(m_expandedNodes.begin(), m_expandedNodes.end(), [successor](shared_ptr<Node> node)
-                                                      { return node->userState.isSameState((*successor)->userState); });
+                if (existing != NO_NODE)
+                {
+                    // Cheaper node regenerates all its children, so what was backed up from the old ones is stale
+                    if (m_nodeLimit > 0)
+                    {
+                        _releaseForgotten(existing, false);
+                        _detachChild(existing);
+                        ++m_childCount[current_node];
+                        m_depth[existing] = newDepth;
+                        m_parentG[existing] = m_g[current_node];
+                    }
 
-                // we found this state on closed
-                if (closedListResult != m_expandedNodes.end())
+                    // Update old node with better AStar data and free the successor
+                    m_parent[existing] = current_node;
+                    m_g[existing] = newg;
+                    m_h[existing] = newh;
+                    _freeNode(successor);
+
+                    if (m_openPosition[existing] != NOT_OPEN)
+                    {
+                        // Lower f only moves the node up in the heap
+                        _siftUp(m_openPosition[existing]);
+                    }
+                    else
+                    {
+                        // Node was expanded, move it from closed list back to open list to investigate better solution.
+                        // It happens only with inconsistent heuristic or with node limit
+                        _removeClosed(existing);
+                        _pushOpen(existing);
+                        if (m_observer)
+                        {
+                            m_observer->onGenerate(m_states[existing]);
+                        }
+                    }
+                    _updateLeaf(existing);
+                }
+                else
                 {
-                    if ((*closedListResult)->g <= newg)
+                    // New successor, move it from successors to open list
+                    m_parent[successor] = current_node;
+                    m_g[successor] = newg;
+                    m_h[successor] = newh;
+                    if (m_nodeLimit > 0)
                     {
-                        // instance in the Closed is cheaper than the current one
-                        _freeNode((*successor));
-                        // Continue with next successor
-                        continue;
+                        m_depth[successor] = newDepth;
+                        m_parentG[successor] = m_g[current_node];
+                        ++m_childCount[current_node];
+                    }
+                    _registerState(successor);
+                    _pushOpen(successor);
+                    _updateLeaf(successor);
+
+                    if (m_observer)
+                    {
+                        m_observer->onGenerate(m_states[successor]);
                     }
                 }
+            }
 
-                // The current node is the best node so far with this particular state
+            m_maxBranching = std::max(m_maxBranching, m_successors.size());
+            if (m_nodeLimit > 0)
+            {
+                // Forgotten children were regenerated, hopeless ones stay forgotten
+                _releaseForgotten(current_node, true);
+            }
 
-                (*successor)->parent = current_node;
-                (*successor)->g = newg;
-                (*successor)->h = (*successor)->userState.goalDistanceEstimate(m_goal->userState);
-                (*successor)->f = (*successor)->g + (*successor)->h;
+            // push current_node onto Closed, as we have expanded it now
+            _pushClosed(current_node);
 
-                // Successor in closed list
-                // 1 - Update old version of this node in closed list as we have found better version
-                // 2 - Move it from closed to open list to be able to investigate better solution
-                // 3 - Sort heap again in open list
+            if (m_observer)
+            {
+                m_observer->onExpand(m_states[current_node]);
+            }
 
-                if (closedListResult != m_expandedNodes.end())
+            if (m_nodeLimit > 0)
+            {
+                if (m_childCount[current_node] == 0)
                 {
-                    // Update closed node with successor node AStar data
-                    (*closedListResult)->parent = (*successor)->parent;
-                    (*closedListResult)->g = (*successor)->g;
-                    (*closedListResult)->h = (*successor)->h;
-                    (*closedListResult)->f = (*successor)->f;
-
-                    // Free successor node
-                    _freeNode((*successor));
+                    m_deadEnds.push_back(current_node);
+                }
+                _enforceNodeLimit(m_nodeLimit);
+            }
+        }
+        m_peakNodes = std::max(m_peakNodes, _liveNodeCount());
+        return m_state;
+    }
 
-                    // Push closed node into open list
-                    m_openNodes.push_back((*closedListResult));
+    NodeId _allocateNode()
+    {
+        NodeId node;
+        if (!m_freeNodes.empty())
+        {
+            node = m_freeNodes.back();
+            m_freeNodes.pop_back();
+        }
+        else
+        {
+            node = m_states.size();
+            m_states.emplace_back();
+            m_g.push_back(0);
+            m_h.push_back(0);
+            m_parent.push_back(NO_NODE);
+            m_openPosition.push_back(NOT_OPEN);
+            if (m_nodeLimit > 0)
+            {
+                m_forgottenF.push_back(NO_COST);
+                m_forgottenHead.push_back(NO_RECORD);
+                m_depth.push_back(0);
+                m_childCount.push_back(0);
+                m_closedPosition.push_back(NOT_CLOSED);
+                m_parentG.push_back(0);
+            }
+        }
+        if (m_nodeLimit > 0)
+        {
+            m_depth[node] = 0;
+            m_childCount[node] = 0;
+            m_closedPosition[node] = NOT_CLOSED;
+        }
+        return node;
+    }
 
-                    // Remove closed node from closed list
-                    m_expandedNodes.erase(closedListResult);
+    size_t _liveNodeCount() const
+    {
+        return m_states.size() - m_freeNodes.size();
+    }
 
-                    // Sort back element into heap
-                    std::push_heap(m_openNodes.begin(), m_openNodes.end(), NodeComparator());
+    /**
+     * @brief Open or closed node with the same state as node, NO_NODE if there is none
+     */
+    NodeId _findNode(NodeId node)
+    {
+        if constexpr (detail::HasStateIndex<UserState>::value)
+        {
+            const size_t index = m_states[node].getStateIndex();
+            return index < m_stateNodes.size() ? m_stateNodes[index] : NO_NODE;
+        }
+        else if constexpr (detail::HasStateKey<UserState>::value)
+        {
+            const auto found = m_keyNodes.find(m_states[node].getStateKey());
+            return found != m_keyNodes.end() ? found->second : NO_NODE;
+        }
+        else
+        {
+            for (const auto *list : {&m_openNodes, &m_expandedNodes})
+            {
+                for (const NodeId other : *list)
+                {
+                    if (m_states[other].isSameState(m_states[node]))
+                    {
+                        return other;
+                    }
                 }
+            }
+            return NO_NODE;
+        }
+    }
+
+    /**
+     * @brief Make node the one that represents its state in open and closed lists
+     */
+    void _registerState(NodeId node)
+    {
+        if constexpr (detail::HasStateIndex<UserState>::value)
+        {
+            const size_t index = m_states[node].getStateIndex();
+            if (index >= m_stateNodes.size())
+            {
+                m_stateNodes.resize(std::max(index + 1, 2 * m_stateNodes.size()), NO_NODE);
+            }
+            m_stateNodes[index] = node;
+        }
+        else if constexpr (detail::HasStateKey<UserState>::value)
+        {
+            m_keyNodes[m_states[node].getStateKey()] = node;
+        }
+    }
 
-                // Successor in open list
-                // 1 - Update old version of this node in open list as we have found better version
-                // 2 - sort heap again in open list
+    // x goes before y in open list
+    bool _isBefore(NodeId x, NodeId y) const
+    {
+        return NodeComparator(this)(y, x);
+    }
+
+    void _pushOpen(NodeId node)
+    {
+        m_openNodes.push_back(node);
+        _siftUp(m_openNodes.size() - 1);
+    }
 
-                else if (openListResult != m_openNodes.end())
+    void _removeOpen(NodeId node)
+    {
+        const size_t position = m_openPosition[node];
+        m_openPosition[node] = NOT_OPEN;
+        const NodeId last = m_openNodes.back();
+        m_openNodes.pop_back();
+        if (position == m_openNodes.size())
+        {
+            return;
+        }
+        if (position == 0)
+        {
+            // Same order of equal nodes as std::pop_heap: hole goes down to a leaf, then last node goes up from it
+            size_t hole = 0;
+            const size_t size = m_openNodes.size();
+            while (2 * hole + 2 < size)
+            {
+                size_t child = 2 * hole + 2;
+                if (_isBefore(m_openNodes[child - 1], m_openNodes[child]))
                 {
-                    // Update open node with successor node AStar data
-                    //*(*openlist_result) = *(*successor);
-                    (*openListResult)->parent = (*successor)->parent;
-                    (*openListResult)->g = (*successor)->g;
-                    (*openListResult)->h = (*successor)->h;
-                    (*openListResult)->f = (*successor)->f;
-
-                    // Free successor node
-                    _freeNode((*successor));
-
-                    // re-make the heap. `sort_heap` called on an invalid heap does not work
-                    std::make_heap(m_openNodes.begin(), m_openNodes.end(), NodeComparator());
+                    --child;
                 }
+                m_openNodes[hole] = m_openNodes[child];
+                m_openPosition[m_openNodes[hole]] = hole;
+                hole = child;
+            }
+            if (2 * hole + 1 < size)
+            {
+                m_openNodes[hole] = m_openNodes[2 * hole + 1];
+                m_openPosition[m_openNodes[hole]] = hole;
+                hole = 2 * hole + 1;
+            }
+            m_openNodes[hole] = last;
+            _siftUp(hole);
+            return;
+        }
+        m_openNodes[position] = last;
+        _siftUp(position);
+        _siftDown(m_openPosition[last]);
+    }
+
+    void _siftUp(size_t position)
+    {
+        const NodeId node = m_openNodes[position];
+        while (position > 0)
+        {
+            const size_t parent = (position - 1) / 2;
+            if (!_isBefore(node, m_openNodes[parent]))
+            {
+                break;
+            }
+            m_openNodes[position] = m_openNodes[parent];
+            m_openPosition[m_openNodes[position]] = position;
+            position = parent;
+        }
+        m_openNodes[position] = node;
+        m_openPosition[node] = position;
+    }
 
-                // New successor
-                // 1 - Move it from successors to open list
-                // 2 - sort heap again in open list
+    void _siftDown(size_t position)
+    {
+        const NodeId node = m_openNodes[position];
+        const size_t size = m_openNodes.size();
+        while (2 * position + 1 < size)
+        {
+            size_t child = 2 * position + 1;
+            if (child + 1 < size && _isBefore(m_openNodes[child + 1], m_openNodes[child]))
+            {
+                ++child;
+            }
+            if (!_isBefore(m_openNodes[child], node))
+            {
+                break;
+            }
+            m_openNodes[position] = m_openNodes[child];
+            m_openPosition[m_openNodes[position]] = position;
+            position = child;
+        }
+        m_openNodes[position] = node;
+        m_openPosition[node] = position;
+    }
 
-                else
+    /**
+     * @brief Path of cost g and depth replaces the path of otherG and otherDepth. With node limit of two equal paths
+     * the one of fewer nodes is better, so every path that is shorter than the limit fits into it
+     */
+    bool _isBetterPath(CostT g, uint32_t depth, CostT otherG, uint32_t otherDepth) const
+    {
+        return g < otherG || (m_nodeLimit > 0 && g == otherG && depth < otherDepth);
+    }
+
+    void _pushClosed(NodeId node)
+    {
+        if (m_nodeLimit > 0)
+        {
+            m_closedPosition[node] = m_expandedNodes.size();
+        }
+        m_expandedNodes.push_back(node);
+    }
+
+    void _removeClosed(NodeId node)
+    {
+        if (m_nodeLimit == 0)
+        {
+            // Without node limit it happens only with inconsistent heuristic, so closed list is scanned
+            m_expandedNodes.erase(std::find(m_expandedNodes.begin(), m_expandedNodes.end(), node));
+            return;
+        }
+        const uint32_t position = m_closedPosition[node];
+        m_closedPosition[node] = NOT_CLOSED;
+        const NodeId last = m_expandedNodes.back();
+        m_expandedNodes.pop_back();
+        if (last != node)
+        {
+            m_expandedNodes[position] = last;
+            m_closedPosition[last] = position;
+        }
+    }
+
+    /**
+     * @brief Open leaf may be forgotten, so it's added to the heap of leaves with its current key and depth.
+     * Entries that don't match the node any more are skipped when they come out of the heap
+     */
+    void _updateLeaf(NodeId node)
+    {
+        if (m_nodeLimit == 0 || m_openPosition[node] == NOT_OPEN || m_childCount[node] > 0 || m_parent[node] == NO_NODE)
+        {
+            return;
+        }
+        if (m_leaves.size() > 2 * m_openNodes.size() + 64)
+        {
+            m_leaves.clear();
+            for (const NodeId open : m_openNodes)
+            {
+                if (m_childCount[open] == 0 && m_parent[open] != NO_NODE)
                 {
-                    // Push successor node into open list
-                    m_openNodes.push_back((*successor));
+                    m_leaves.push_back(LeafEntry{_openKey(open), m_depth[open], open});
+                }
+            }
+            std::make_heap(m_leaves.begin(), m_leaves.end(), &AStarSearch::_isForgottenLater);
+            return;
+        }
+        m_leaves.push_back(LeafEntry{_openKey(node), m_depth[node], node});
+        std::push_heap(m_leaves.begin(), m_leaves.end(), &AStarSearch::_isForgottenLater);
+    }
+
+    bool _isLeafEntry(const LeafEntry &entry) const
+    {
+        const NodeId node = entry.node;
+        return m_openPosition[node] != NOT_OPEN && m_childCount[node] == 0 && m_parent[node] != NO_NODE &&
+               m_depth[node] == entry.depth && _openKey(node) == entry.key;
+    }
+
+    // x is forgotten after y: it has lower key or it's deeper with the same key
+    static bool _isForgottenLater(const LeafEntry &x, const LeafEntry &y)
+    {
+        return x.key < y.key || (x.key == y.key && x.depth > y.depth);
+    }
+
+    /**
+     * @brief Open leaf with the highest key and the shallowest of them, except the best open node, or NO_NODE
+     */
+    NodeId _takeWorstLeaf()
+    {
+        if (m_openNodes.empty())
+        {
+            return NO_NODE;
+        }
+        const NodeId best = m_openNodes.front();
+        NodeId worst = NO_NODE;
+        bool isBestLeaf = false;
+        while (worst == NO_NODE && !m_leaves.empty())
+        {
+            std::pop_heap(m_leaves.begin(), m_leaves.end(), &AStarSearch::_isForgottenLater);
+            const LeafEntry entry = m_leaves.back();
+            m_leaves.pop_back();
+            if (!_isLeafEntry(entry))
+            {
+                continue;
+            }
+            if (entry.node == best)
+            {
+                isBestLeaf = true;
+                continue;
+            }
+            worst = entry.node;
+        }
+        if (isBestLeaf)
+        {
+            m_leaves.push_back(LeafEntry{_openKey(best), m_depth[best], best});
+            std::push_heap(m_leaves.begin(), m_leaves.end(), &AStarSearch::_isForgottenLater);
+        }
+        return worst;
+    }
+
+    /**
+     * @brief Forget nodes until pool fits into the limit as in SMA*. Closed leaf is a dead end whose successors
+     * were all reached cheaper and is dropped, unless it only has hopeless children, then its parent backs up
+     * infinite f. Otherwise open leaf with the highest key is recorded in its parent with the key, so records
+     * of its own children are merged into one, and parent goes back to open list to regenerate it later.
+     * Nodes are expanded only while path to their successors and goal node fits into the limit, so forgetting
+     * always ends with the path to the best open node. Backed up f never goes down, and as key of the best node
+     * grows only finitely many times, search terminates
+     */
+    void _enforceNodeLimit(size_t target)
+    {
+        if (_liveNodeCount() <= target)
+        {
+            return;
+        }
+        ASTAR_TRACE_SPAN("astar prune");
+        while (_liveNodeCount() > target)
+        {
+            if (_forgetDeadEnd())
+            {
+                continue;
+            }
+            const NodeId worst = _takeWorstLeaf();
+            if (worst == NO_NODE)
+            {
+                return;
+            }
+            const CostT key = _openKey(worst);
+            _removeOpen(worst);
+            _forget(worst, key);
+        }
+    }
+
+    bool _forgetDeadEnd()
+    {
+        while (!m_deadEnds.empty())
+        {
+            const NodeId node = m_deadEnds.back();
+            m_deadEnds.pop_back();
+            if (m_closedPosition[node] == NOT_CLOSED || m_childCount[node] > 0 || m_parent[node] == NO_NODE)
+            {
+                continue;
+            }
+            _removeClosed(node);
+            if (m_forgottenHead[node] != NO_RECORD && !_isStale(node))
+            {
+                _forget(node, NO_COST);
+            }
+            else
+            {
+                _detachChild(node);
+                _freeNode(node);
+                ++m_prunedNodes;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Free node that is out of open and closed lists and record it in its parent with f.
+     * Parent goes back to open list if f is finite
+     */
+    void _forget(NodeId node, CostT f)
+    {
+        const NodeId parent = m_parent[node];
+        _forgetChild(parent, node, f);
+        _detachChild(node);
+        _freeNode(node);
+        ++m_prunedNodes;
+        if (f == NO_COST)
+        {
+            return;
+        }
+        if (m_closedPosition[parent] != NOT_CLOSED)
+        {
+            _removeClosed(parent);
+            _pushOpen(parent);
+        }
+        else if (m_openPosition[parent] != NOT_OPEN)
+        {
+            // Lower forgotten f may move parent either way
+            _siftUp(m_openPosition[parent]);
+            _siftDown(m_openPosition[parent]);
+        }
+        _updateLeaf(parent);
+    }
+
+    /**
+     * @brief Parent of node got cheaper or shallower since node was reached from it
+     */
+    bool _isStale(NodeId node) const
+    {
+        const NodeId parent = m_parent[node];
+        return parent != NO_NODE && (m_parentG[node] != m_g[parent] || m_depth[node] != m_depth[parent] + 1);
+    }
+
+    /**
+     * @brief Move node and its forgotten children to the new cost of its parent. Children that didn't fit
+     * into the limit may fit now, so they are regenerated
+     */
+    void _refresh(NodeId node)
+    {
+        const NodeId parent = m_parent[node];
+        const CostT shift = m_parentG[node] - m_g[parent];
+        m_g[node] -= shift;
+        m_parentG[node] = m_g[parent];
+        m_depth[node] = m_depth[parent] + 1;
+        uint32_t kept = NO_RECORD;
+        uint32_t record = m_forgottenHead[node];
+        m_forgottenHead[node] = NO_RECORD;
+        m_forgottenF[node] = NO_COST;
+        while (record != NO_RECORD)
+        {
+            ForgottenChild &child = m_forgotten[record];
+            const uint32_t next = child.next;
+            if (child.f == NO_COST)
+            {
+                _freeRecord(record);
+            }
+            else
+            {
+                child.g -= shift;
+                child.f -= shift;
+                child.depth = m_depth[node] + 1;
+                child.next = kept;
+                kept = record;
+                m_forgottenF[node] = std::min(m_forgottenF[node], child.f);
+            }
+            record = next;
+        }
+        m_forgottenHead[node] = kept;
+    }
+
+    /**
+     * @brief Take node from children of its parent, parent left without children may be forgotten
+     */
+    void _detachChild(NodeId node)
+    {
+        const NodeId parent = m_parent[node];
+        if (parent == NO_NODE || --m_childCount[parent] > 0)
+        {
+            return;
+        }
+        if (m_closedPosition[parent] != NOT_CLOSED)
+        {
+            m_deadEnds.push_back(parent);
+        }
+        else
+        {
+            _updateLeaf(parent);
+        }
+    }
 
-                    // Sort back element into heap
-                    std::push_heap(m_openNodes.begin(), m_openNodes.end(), NodeComparator());
+    /**
+     * @brief Record state, g, depth and f of child in its parent before child is freed.
+     * Records of the child are merged into f
+     */
+    void _forgetChild(NodeId parent, NodeId child, CostT f)
+    {
+        uint32_t record;
+        if (!m_freeRecords.empty())
+        {
+            record = m_freeRecords.back();
+            m_freeRecords.pop_back();
+        }
+        else
+        {
+            record = m_forgotten.size();
+            m_forgotten.emplace_back();
+        }
+        // Parent that got cheaper since it reached child makes the whole subtree of child cheaper
+        const CostT shift = m_parentG[child] - m_g[parent];
+        if (f != NO_COST)
+        {
+            f -= shift;
+        }
+        m_forgotten[record] = ForgottenChild{m_states[child], m_g[child] - shift, f, m_depth[parent] + 1, parent, m_forgottenHead[parent]};
+        m_forgottenHead[parent] = record;
+        m_forgottenF[parent] = std::min(m_forgottenF[parent], f);
+        if constexpr (detail::HasStateIndex<UserState>::value)
+        {
+            const size_t index = m_states[child].getStateIndex();
+            if (index >= m_stateRecords.size())
+            {
+                m_stateRecords.resize(std::max(index + 1, 2 * m_stateRecords.size()), NO_RECORD);
+            }
+            m_stateRecords[index] = record;
+        }
+        else if constexpr (detail::HasStateKey<UserState>::value)
+        {
+            m_keyRecords[m_states[child].getStateKey()] = record;
+        }
+    }
+
+    /**
+     * @brief Record of state forgotten by parent, otherwise record of it in another parent or NO_RECORD
+     */
+    uint32_t _findForgotten(NodeId parent, UserState &state)
+    {
+        for (uint32_t record = m_forgottenHead[parent]; record != NO_RECORD; record = m_forgotten[record].next)
+        {
+            if (m_forgotten[record].state.isSameState(state))
+            {
+                return record;
+            }
+        }
+        if constexpr (detail::HasStateIndex<UserState>::value)
+        {
+            const size_t index = state.getStateIndex();
+            return index < m_stateRecords.size() ? m_stateRecords[index] : NO_RECORD;
+        }
+        else if constexpr (detail::HasStateKey<UserState>::value)
+        {
+            const auto found = m_keyRecords.find(state.getStateKey());
+            return found != m_keyRecords.end() ? found->second : NO_RECORD;
+        }
+        else
+        {
+            for (uint32_t record = 0; record < m_forgotten.size(); ++record)
+            {
+                if (m_forgotten[record].parent != NO_NODE && m_forgotten[record].state.isSameState(state))
+                {
+                    return record;
                 }
             }
+            return NO_RECORD;
+        }
+    }
 
-            // push current_node onto Closed, as we have expanded it now
-            m_expandedNodes.push_back(current_node);
+    /**
+     * @brief Drop records of forgotten children of node
+     *
+     * @param keepHopeless Records with infinite f stay
+     */
+    void _releaseForgotten(NodeId node, bool keepHopeless)
+    {
+        uint32_t kept = NO_RECORD;
+        uint32_t record = m_forgottenHead[node];
+        while (record != NO_RECORD)
+        {
+            const uint32_t next = m_forgotten[record].next;
+            if (keepHopeless && m_forgotten[record].f == NO_COST)
+            {
+                m_forgotten[record].next = kept;
+                kept = record;
+            }
+            else
+            {
+                _freeRecord(record);
+            }
+            record = next;
         }
-        return m_state;
+        m_forgottenHead[node] = kept;
+        m_forgottenF[node] = NO_COST;
     }
 
-    shared_ptr<Node> _allocateNode()
+    void _freeRecord(uint32_t record)
     {
-        return make_shared<Node>();
+        if constexpr (detail::HasStateIndex<UserState>::value)
+        {
+            const size_t index = m_forgotten[record].state.getStateIndex();
+            if (m_stateRecords[index] == record)
+            {
+                m_stateRecords[index] = NO_RECORD;
+            }
+        }
+        else if constexpr (detail::HasStateKey<UserState>::value)
+        {
+            const auto found = m_keyRecords.find(m_forgotten[record].state.getStateKey());
+            if (found != m_keyRecords.end() && found->second == record)
+            {
+                m_keyRecords.erase(found);
+            }
+        }
+        m_forgotten[record].parent = NO_NODE;
+        m_freeRecords.push_back(record);
     }
 
-    void _freeNode(shared_ptr<Node> node)
+    void _freeNode(NodeId node)
     {
-        node.reset();
+        if constexpr (detail::HasStateIndex<UserState>::value)
+        {
+            const size_t index = m_states[node].getStateIndex();
+            if (index < m_stateNodes.size() && m_stateNodes[index] == node)
+            {
+                m_stateNodes[index] = NO_NODE;
+            }
+        }
+        else if constexpr (detail::HasStateKey<UserState>::value)
+        {
+            const auto found = m_keyNodes.find(m_states[node].getStateKey());
+            if (found != m_keyNodes.end() && found->second == node)
+            {
+                m_keyNodes.erase(found);
+            }
+        }
+        if (m_nodeLimit > 0)
+        {
+            _releaseForgotten(node, false);
+        }
+        m_parent[node] = NO_NODE;
+        m_freeNodes.push_back(node);
     }
 
-    using iterator_t = typename deque<shared_ptr<Node>>::iterator;
+    // Node pool as structure of arrays indexed by NodeId
+    std::vector<UserState> m_states;
+    std::vector<CostT> m_g;      // cost of this node + it's predecessors
+    std::vector<CostT> m_h;      // heuristic estimate of distance to goal
+    std::vector<NodeId> m_parent; // used during the search to record the parent of successor nodes
+    std::vector<uint32_t> m_openPosition; // index in m_openNodes or NOT_OPEN
+    std::vector<NodeId> m_freeNodes;
+
+    // Binary heap ordered by NodeComparator, positions of nodes are kept in m_openPosition
+    std::vector<NodeId> m_openNodes;
 
-    // Heap (simple vector but used as a heap)
-    deque<shared_ptr<Node>> m_openNodes;
+    // Node of every state in open or closed list by getStateIndex(), if UserState has it
+    std::vector<NodeId> m_stateNodes;
+    // Same by getStateKey() for state spaces too large or sparse for a table
+    std::unordered_map<uint64_t, NodeId> m_keyNodes;
 
     // Closed list is a vector.
-    deque<shared_ptr<Node>> m_expandedNodes;
+    std::vector<NodeId> m_expandedNodes;
 
     // Successors is a vector filled out by the user each type successors to a node
     // are generated
-    deque<shared_ptr<Node>> m_successors;
+    deque<NodeId> m_successors;
 
     SearchState m_state;
 
-    // Start and goal state pointers
-    shared_ptr<Node> m_start;
-    shared_ptr<Node> m_goal;
+    // Start and goal state nodes
+    NodeId m_start;
+    NodeId m_goal;
+    NodeId m_found = NO_NODE; // goal node popped from open list
+
+    Observer *m_observer = nullptr;
+
+    // Memory bounded mode
+    size_t m_nodeLimit = 0;
+    size_t m_maxBranching = 0;
+    size_t m_peakNodes = 0;
+    size_t m_prunedNodes = 0;
+    size_t m_cutNodes = 0;                  // nodes forgotten because path to their successors doesn't fit into the limit
+    std::vector<CostT> m_forgottenF;        // lowest finite f of forgotten children of node or NO_COST
+    std::vector<uint32_t> m_forgottenHead;  // list of forgotten children of node in m_forgotten or NO_RECORD
+    std::vector<uint32_t> m_depth;          // number of nodes on the path to node without it
+    std::vector<uint32_t> m_childCount;     // open and closed nodes that have node as parent
+    std::vector<uint32_t> m_closedPosition; // index in m_expandedNodes or NOT_CLOSED
+    std::vector<CostT> m_parentG;           // g of parent when node got it, parent g may go down later
+    std::vector<LeafEntry> m_leaves;        // heap of open leaves, the next one to forget on top
+    std::vector<NodeId> m_deadEnds;         // closed nodes that were left without children
+    std::vector<ForgottenChild> m_forgotten;
+    std::vector<uint32_t> m_freeRecords;
+    std::vector<uint32_t> m_stateRecords; // forgotten child of every state by getStateIndex(), if UserState has it
+    std::unordered_map<uint64_t, uint32_t> m_keyRecords; // same by getStateKey()
 };
 
 namespace detail
@@ -448,5 +1355,8 @@ namespace detail
          * @brief Returns true if this node is the same as the rhs node
          */
         virtual bool isSameState(T &rhs) = 0;
+        // Optional bool isReachable(T &nodeGoal). If it returns false search fails without expanding any node
+        // Optional size_t getStateIndex() const. Dense index of the state, lets search find open and closed nodes in O(1)
+        // Optional uint64_t getStateKey() const. Unique key of the state for a hash table when dense index is too large
     };
 }
@@ -1,5 +1,9 @@
 #pragma once
 #include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "Trace.hpp"
 
 class ArrayMap
 {
@@ -17,6 +21,43 @@ public:
         CLOSE_PATH_POS = 104,
     };
 
+    /**
+     * @brief Allowed movement on the grid. With EIGHT diagonal moves are allowed
+     * only if both orthogonal cells next to them are passable (no corner cutting)
+     */
+    enum class Connectivity
+    {
+        FOUR = 4,
+        EIGHT = 8,
+    };
+
+    // Directions in order of bits in neighbor mask. Orthogonal moves go first
+    // so 4-connected search visits successors in the same order as before
+    static constexpr int DIRECTION_COUNT = 8;
+    static constexpr int DIRECTION_DX[DIRECTION_COUNT] = {-1, 0, 1, 0, -1, 1, 1, -1};
+    static constexpr int DIRECTION_DY[DIRECTION_COUNT] = {0, -1, 0, 1, -1, -1, 1, 1};
+    static constexpr uint8_t ORTHOGONAL_MASK = 0x0F;
+    static constexpr uint8_t DIAGONAL_MASK = 0xF0;
+
+    // Component label of walls and cells outside of the map
+    static constexpr uint32_t NO_COMPONENT = UINT32_MAX;
+
+    /**
+     * @brief Returns bit of neighbor mask for move (dx, dy) or 0 if cells are not adjacent
+     */
+    static uint8_t directionBit(int dx, int dy)
+    {
+        // Indexed by (dy + 1) * 3 + (dx + 1)
+        static constexpr uint8_t bits[9] = {1 << 4, 1 << 1, 1 << 5,
+                                            1 << 0, 0, 1 << 2,
+                                            1 << 7, 1 << 3, 1 << 6};
+        if (dx < -1 || dx > 1 || dy < -1 || dy > 1)
+        {
+            return 0;
+        }
+        return bits[(dy + 1) * 3 + (dx + 1)];
+    }
+
     // map helper functions
     CellType getPoint(int x, int y) const
     {
@@ -29,6 +70,148 @@ public:
         return static_cast<CellType>(m_logicalMap[y][x]);
     }
 
+    bool isPassable(int x, int y) const
+    {
+        if (x < 0 || x >= getWidth() ||
+            y < 0 || y >= getHeight())
+        {
+            return false;
+        }
+        return m_passable[y * getWidth() + x];
+    }
+
+    /**
+     * @brief Flat row-major buffer with 1 for passable cells and 0 for walls.
+     * Use it in hot loops where bounds are checked by caller
+     */
+    const uint8_t *getPassabilityData() const
+    {
+        return m_passable.data();
+    }
+
+    /**
+     * @brief Get mask of directions that are allowed to move from cell (x, y)
+     * with current connectivity. Bit i corresponds to DIRECTION_DX[i], DIRECTION_DY[i].
+     * Cells outside the map have no neighbours, as they are walls for getPoint
+     */
+    uint8_t getNeighborMask(int x, int y) const
+    {
+        if (x < 0 || x >= getWidth() || y < 0 || y >= getHeight())
+        {
+            return 0;
+        }
+        return m_neighborMask[y * getWidth() + x] & m_movementMask;
+    }
+
+    /**
+     * @brief Same as above but for explicitly given connectivity instead of current one
+     */
+    uint8_t getNeighborMask(int x, int y, Connectivity connectivity) const
+    {
+        if (x < 0 || x >= getWidth() || y < 0 || y >= getHeight())
+        {
+            return 0;
+        }
+        const uint8_t movementMask = connectivity == Connectivity::EIGHT ? ORTHOGONAL_MASK | DIAGONAL_MASK : ORTHOGONAL_MASK;
+        return m_neighborMask[y * getWidth() + x] & movementMask;
+    }
+
+    /**
+     * @brief Label of connected component of passable cell or NO_COMPONENT.
+     * Diagonal moves never cut corners, so components are the same for both connectivities
+     */
+    uint32_t getComponent(int x, int y) const
+    {
+        if (x < 0 || x >= getWidth() ||
+            y < 0 || y >= getHeight())
+        {
+            return NO_COMPONENT;
+        }
+        return m_component[y * getWidth() + x];
+    }
+
+    /**
+     * @brief Number of cells in component of cell (x, y), 0 for walls
+     */
+    uint32_t getComponentSize(int x, int y) const
+    {
+        const uint32_t component = getComponent(x, y);
+        return component == NO_COMPONENT ? 0 : m_componentSize[component];
+    }
+
+    /**
+     * @brief O(1) check that path between two cells exists
+     */
+    bool isConnected(int x0, int y0, int x1, int y1) const
+    {
+        const uint32_t component = getComponent(x0, y0);
+        return component != NO_COMPONENT && component == getComponent(x1, y1);
+    }
+
+    /**
+     * @brief Change cell of logical map. Neighbor masks of the cell and cells around it are updated,
+     * as well as component labels when passability of the cell changes
+     */
+    void setLogicalCell(const int x, const int y, CellType mark)
+    {
+        m_logicalMap[y][x] = static_cast<int>(mark);
+        m_viewMap[y][x] = static_cast<int>(mark);
+        const uint8_t wasPassable = m_passable[y * getWidth() + x];
+        m_passable[y * getWidth() + x] = mark < CellType::WALL_POS;
+        for (int ny = y - 1; ny <= y + 1; ++ny)
+        {
+            for (int nx = x - 1; nx <= x + 1; ++nx)
+            {
+                if (nx >= 0 && nx < getWidth() && ny >= 0 && ny < getHeight())
+                {
+                    m_neighborMask[ny * getWidth() + nx] = _computeNeighborMask(nx, ny);
+                }
+            }
+        }
+        if (wasPassable && !m_passable[y * getWidth() + x])
+        {
+            _removeFromComponent(x, y);
+        }
+        else if (!wasPassable && m_passable[y * getWidth() + x])
+        {
+            _addToComponent(x, y);
+        }
+    }
+
+    void setConnectivity(Connectivity connectivity)
+    {
+        m_connectivity = connectivity;
+        m_movementMask = connectivity == Connectivity::EIGHT ? ORTHOGONAL_MASK | DIAGONAL_MASK : ORTHOGONAL_MASK;
+    }
+
+    Connectivity getConnectivity() const
+    {
+        return m_connectivity;
+    }
+
+    /**
+     * @brief FNV-1a hash of size and cells of logical map. Precomputed indices saved to disk
+     * keep it to detect that they were built for other map
+     */
+    uint64_t getContentHash() const
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        auto add = [&hash](uint32_t value)
+        {
+            hash = (hash ^ value) * 0x100000001B3ull;
+        };
+        add(getWidth());
+        add(getHeight());
+        for (const auto &row : m_logicalMap)
+        {
+            for (int cell : row)
+            {
+                add(cell);
+            }
+        }
+        return hash;
+    }
+
     void setCell(const int x, const int y, CellType mark)
     {
         m_viewMap[y][x] = static_cast<int>(mark);
@@ -86,8 +269,10 @@ public:
 
     void setMap(const ArrayT &newMap)
     {
+        ASTAR_TRACE_SPAN("map rebuild");
         m_logicalMap = newMap;
         m_viewMap = newMap;
+        _rebuildNeighborMasks();
     }
 
     // Singletone used as MapSearchNode depends oh this object
@@ -104,11 +289,213 @@ public:
     void operator=(ArrayMap const &) = delete; // Don't implement
 
 private:
-    ArrayMap(){};
+    ArrayMap()
+    {
+        _rebuildNeighborMasks();
+    };
+
+    void _rebuildNeighborMasks()
+    {
+        m_passable.assign(getWidth() * getHeight(), 0);
+        for (int y = 0; y < getHeight(); ++y)
+        {
+            for (int x = 0; x < getWidth(); ++x)
+            {
+                m_passable[y * getWidth() + x] = getPoint(x, y) < CellType::WALL_POS;
+            }
+        }
+
+        m_neighborMask.assign(getWidth() * getHeight(), 0);
+        for (int y = 0; y < getHeight(); ++y)
+        {
+            for (int x = 0; x < getWidth(); ++x)
+            {
+                m_neighborMask[y * getWidth() + x] = _computeNeighborMask(x, y);
+            }
+        }
+        _rebuildComponents();
+    }
+
+    void _rebuildComponents()
+    {
+        m_component.assign(getWidth() * getHeight(), NO_COMPONENT);
+        m_componentSize.clear();
+        m_freeComponents.clear();
+        for (int cell = 0; cell < getWidth() * getHeight(); ++cell)
+        {
+            if (m_passable[cell] && m_component[cell] == NO_COMPONENT)
+            {
+                _fillComponent(cell, _newComponent());
+            }
+        }
+    }
+
+    uint32_t _newComponent()
+    {
+        if (!m_freeComponents.empty())
+        {
+            const uint32_t component = m_freeComponents.back();
+            m_freeComponents.pop_back();
+            return component;
+        }
+        m_componentSize.push_back(0);
+        return m_componentSize.size() - 1;
+    }
+
+    /**
+     * @brief Move all cells reachable from cell to component, returns number of moved cells
+     */
+    uint32_t _fillComponent(int cell, uint32_t component)
+    {
+        const uint32_t oldComponent = m_component[cell];
+        uint32_t count = 0;
+        m_fillStack.clear();
+        m_fillStack.push_back(cell);
+        m_component[cell] = component;
+        while (!m_fillStack.empty())
+        {
+            const int current = m_fillStack.back();
+            m_fillStack.pop_back();
+            ++count;
+            const int x = current % getWidth();
+            const int y = current / getWidth();
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                const int nx = x + DIRECTION_DX[dir];
+                const int ny = y + DIRECTION_DY[dir];
+                if (isPassable(nx, ny) && m_component[ny * getWidth() + nx] == oldComponent)
+                {
+                    m_component[ny * getWidth() + nx] = component;
+                    m_fillStack.push_back(ny * getWidth() + nx);
+                }
+            }
+        }
+        m_componentSize[component] += count;
+        if (oldComponent != NO_COMPONENT)
+        {
+            m_componentSize[oldComponent] -= count;
+            if (m_componentSize[oldComponent] == 0)
+            {
+                m_freeComponents.push_back(oldComponent);
+            }
+        }
+        return count;
+    }
+
+    /**
+     * @brief Cell became passable: join it to neighbouring components, smaller ones are relabelled
+     */
+    void _addToComponent(int x, int y)
+    {
+        uint32_t largest = NO_COMPONENT;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const uint32_t component = getComponent(x + DIRECTION_DX[dir], y + DIRECTION_DY[dir]);
+            if (component != NO_COMPONENT && (largest == NO_COMPONENT || m_componentSize[component] > m_componentSize[largest]))
+            {
+                largest = component;
+            }
+        }
+        const int cell = y * getWidth() + x;
+        if (largest == NO_COMPONENT)
+        {
+            largest = _newComponent();
+        }
+        m_component[cell] = largest;
+        m_componentSize[largest]++;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const int nx = x + DIRECTION_DX[dir];
+            const int ny = y + DIRECTION_DY[dir];
+            if (getComponent(nx, ny) != NO_COMPONENT && getComponent(nx, ny) != largest)
+            {
+                _fillComponent(ny * getWidth() + nx, largest);
+            }
+        }
+    }
+
+    /**
+     * @brief Cell became wall: its component may split. If passable neighbours stay connected
+     * through the ring of 8 cells around it, split is impossible and nothing is relabelled
+     */
+    void _removeFromComponent(int x, int y)
+    {
+        const int cell = y * getWidth() + x;
+        const uint32_t component = m_component[cell];
+        m_component[cell] = NO_COMPONENT;
+        if (--m_componentSize[component] == 0)
+        {
+            m_freeComponents.push_back(component);
+            return;
+        }
+
+        // Ring around the cell in circular order starting from west neighbour, orthogonal cells are even
+        static constexpr int RING_DX[8] = {-1, -1, 0, 1, 1, 1, 0, -1};
+        static constexpr int RING_DY[8] = {0, -1, -1, -1, 0, 1, 1, 1};
+        int runs = 0;
+        bool isRunWithNeighbor = false;
+        int first = 0;
+        while (first < 8 && isPassable(x + RING_DX[first], y + RING_DY[first]))
+        {
+            ++first;
+        }
+        if (first == 8)
+        {
+            return;
+        }
+        for (int i = 1; i <= 8; ++i)
+        {
+            const int index = (first + i) % 8;
+            if (isPassable(x + RING_DX[index], y + RING_DY[index]))
+            {
+                isRunWithNeighbor = isRunWithNeighbor || index % 2 == 0;
+            }
+            else
+            {
+                runs += isRunWithNeighbor;
+                isRunWithNeighbor = false;
+            }
+        }
+        if (runs <= 1)
+        {
+            return;
+        }
+
+        // Relabel regions of all neighbours but the last one, the rest keeps old label
+        int lastNeighbor = -1;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            if (getComponent(x + DIRECTION_DX[dir], y + DIRECTION_DY[dir]) == component)
+            {
+                if (lastNeighbor >= 0)
+                {
+                    _fillComponent(lastNeighbor, _newComponent());
+                }
+                lastNeighbor = (y + DIRECTION_DY[dir]) * getWidth() + x + DIRECTION_DX[dir];
+            }
+        }
+    }
+
+    uint8_t _computeNeighborMask(int x, int y) const
+    {
+        uint8_t mask = 0;
+        for (int dir = 0; dir < DIRECTION_COUNT; ++dir)
+        {
+            if (isPassable(x + DIRECTION_DX[dir], y + DIRECTION_DY[dir]))
+            {
+                mask |= 1 << dir;
+            }
+        }
+        // Diagonal bit i + 4 lies between orthogonal bits i and (i + 1) % 4,
+        // so allowed corners are pairs of passable neighbouring orthogonal cells
+        const uint8_t orthogonal = mask & ORTHOGONAL_MASK;
+        const uint8_t corners = orthogonal & ((orthogonal >> 1) | (orthogonal << 3));
+        return mask & (ORTHOGONAL_MASK | (corners << 4));
+    }
 
 private:
     // Instance of actual map that will be used in search. Nobody is allowed
-    // to change this variable.
+    // to change this variable except setMap and setLogicalCell that keep neighbor masks in sync.
     ArrayT m_logicalMap =
         {{1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
          {1, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 9, 1},
@@ -154,4 +541,17 @@ private:
          {1, 1, 9, 9, 9, 9, 9, 9, 9, 1, 1, 1, 9, 9, 9, 1, 9, 9, 9, 9},
          {1, 9, 1, 1, 1, 1, 1, 1, 1, 1, 1, 9, 1, 1, 1, 1, 1, 1, 1, 1},
          {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1}};
+
+    // Passability of each cell and packed passability of its 8 neighbours in row-major order
+    std::vector<uint8_t> m_passable;
+    std::vector<uint8_t> m_neighborMask;
+
+    // Connected component of each cell, size of each component and labels of empty components
+    std::vector<uint32_t> m_component;
+    std::vector<uint32_t> m_componentSize;
+    std::vector<uint32_t> m_freeComponents;
+    std::vector<int> m_fillStack;
+
+    Connectivity m_connectivity = Connectivity::FOUR;
+    uint8_t m_movementMask = ORTHOGONAL_MASK;
 };
@@ -0,0 +1,513 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "CompressedPathDatabase.hpp"
+#include "MapIO.hpp"
+#include "MapSearchNode.hpp"
+#include "ParallelAStarSearch.hpp"
+#include "RectangleMap.hpp"
+#include "RectangleSearch.hpp"
+#include "ThetaStarSearch.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Headless mode: runs list of queries against map loaded from file
+ * and streams one result per query to stdout, summary goes to stderr
+ */
+class BatchRunner
+{
+public:
+    enum class Engine
+    {
+        ASTAR,
+        THETA,
+        LAZY_THETA,
+        HDA,
+        CPD,
+        RSR
+    };
+
+    struct Options
+    {
+        Engine engine = Engine::ASTAR;
+        std::string mapFile;
+        std::string queryFile = "-"; // "-" means stdin
+        unsigned int threads = 1;
+        unsigned int searchThreads = 1; // threads of one query for HDA engine
+        std::string databaseFile;       // path database for CPD engine, built and saved if missing
+        size_t nodeLimit = 0;           // node budget of one A* search, 0 means no limit
+        std::string traceFile;          // Chrome trace of the batch, needs ASTAR_WITH_TRACING build
+        bool binary = false;
+        bool diagonal = false;
+    };
+
+    struct Query
+    {
+        uint32_t id;
+        int startX;
+        int startY;
+        int goalX;
+        int goalY;
+    };
+
+    /**
+     * @brief Result of one query. In binary mode it is written to stdout as is (host byte order)
+     */
+#pragma pack(push, 1)
+    struct Result
+    {
+        uint32_t id;
+        uint8_t state; // 'S' succeeded, 'F' failed, 'M' out of memory, 'I' invalid query
+        uint32_t pathLength;
+        uint32_t expandedNodes;
+        float cost;
+        uint32_t latencyMicros;
+    };
+#pragma pack(pop)
+
+    static void printUsage(std::ostream &out, const char *program)
+    {
+        out << "Usage: " << program << " --batch --map <file> [--queries <file>|-] [--threads N] [--binary] [--diagonal]\n"
+            << "       [--engine astar|theta|lazytheta|hda|cpd|rsr] [--search-threads N]\n"
+            << "       [--cpd-file database.cpd] [--node-limit N] [--trace trace.json]\n"
+            << "  Query line: <startX> <startY> <goalX> <goalY>\n"
+            << "  Text result line: <id> <S|F|M|I> <cost> <path length> <expanded nodes> <latency us>\n";
+    }
+
+    /**
+     * @brief Parse command line arguments that follow --batch
+     *
+     * @return false If arguments are wrong, error describes the reason
+     */
+    static bool parseOptions(int argc, char *argv[], Options &options, std::string &error)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--batch")
+            {
+                continue;
+            }
+            else if (arg == "--map" && hasValue)
+            {
+                options.mapFile = argv[++i];
+            }
+            else if (arg == "--queries" && hasValue)
+            {
+                options.queryFile = argv[++i];
+            }
+            else if (arg == "--threads" && hasValue)
+            {
+                options.threads = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--search-threads" && hasValue)
+            {
+                options.searchThreads = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--node-limit" && hasValue)
+            {
+                options.nodeLimit = std::max(0, atoi(argv[++i]));
+            }
+            else if (arg == "--cpd-file" && hasValue)
+            {
+                options.databaseFile = argv[++i];
+            }
+            else if (arg == "--trace" && hasValue)
+            {
+                if (!Trace::isEnabled())
+                {
+                    error = "tracing is not compiled in, configure with -DASTAR_WITH_TRACING=ON";
+                    return false;
+                }
+                options.traceFile = argv[++i];
+            }
+            else if (arg == "--binary")
+            {
+                options.binary = true;
+            }
+            else if (arg == "--diagonal")
+            {
+                options.diagonal = true;
+            }
+            else if (arg == "--engine" && hasValue)
+            {
+                const std::string engine = argv[++i];
+                if (engine == "astar")
+                {
+                    options.engine = Engine::ASTAR;
+                }
+                else if (engine == "theta")
+                {
+                    options.engine = Engine::THETA;
+                }
+                else if (engine == "lazytheta")
+                {
+                    options.engine = Engine::LAZY_THETA;
+                }
+                else if (engine == "hda")
+                {
+                    options.engine = Engine::HDA;
+                }
+                else if (engine == "cpd")
+                {
+                    options.engine = Engine::CPD;
+                }
+                else if (engine == "rsr")
+                {
+                    options.engine = Engine::RSR;
+                }
+                else
+                {
+                    error = "unknown engine " + engine;
+                    return false;
+                }
+            }
+            else
+            {
+                error = "unknown or incomplete argument " + arg;
+                return false;
+            }
+        }
+        if (options.mapFile.empty())
+        {
+            error = "map file is required";
+            return false;
+        }
+        if (options.engine == Engine::RSR && options.diagonal)
+        {
+            error = "rsr engine is slower than astar with --diagonal, use it on 4-connected maps";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Load map into ArrayMap and build data of the engine, errors are reported to stderr
+     *
+     * @return false If map or engine data can't be loaded
+     */
+    bool prepare(const Options &options)
+    {
+        std::ifstream mapStream(options.mapFile);
+        ArrayMap::ArrayT grid;
+        std::string error;
+        if (!mapStream || !MapIO::load(mapStream, grid, error))
+        {
+            std::cerr << "Failed to load map " << options.mapFile << ": " << (mapStream ? error : "can't open file") << std::endl;
+            return false;
+        }
+        ArrayMap &map = ArrayMap::getInstance();
+        map.setMap(grid);
+        map.setConnectivity(options.diagonal ? ArrayMap::Connectivity::EIGHT : ArrayMap::Connectivity::FOUR);
+
+        if (options.engine == Engine::CPD && !_prepareDatabase(options))
+        {
+            return false;
+        }
+        if (options.engine == Engine::RSR)
+        {
+            m_rectangles.build(map);
+            std::cerr << "rectangles " << m_rectangles.getRectangleCount() << ", perimeter cells " << m_rectangles.getPerimeterCellCount() << std::endl;
+        }
+
+        m_binary = options.binary;
+        m_engine = options.engine;
+        m_searchThreads = options.searchThreads;
+        m_nodeLimit = options.nodeLimit;
+        m_expandedTotal = 0;
+        m_lineOfSightTotal = 0;
+        m_peakMemory = 0;
+        return true;
+    }
+
+    /**
+     * @brief Answer one query on prepared map, safe to call from many threads while the map is not changed
+     */
+    void runQuery(const Query &query, Result &result)
+    {
+        const ArrayMap &map = ArrayMap::getInstance();
+        result = Result{query.id, 'I', 0, 0, -1.0f, 0};
+        const auto queryStart = std::chrono::steady_clock::now();
+        if (_isValidPoint(map, query.startX, query.startY) && _isValidPoint(map, query.goalX, query.goalY))
+        {
+            _runQuery(query, result);
+        }
+        result.latencyMicros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - queryStart).count();
+    }
+
+    static void readQueries(std::istream &in, std::vector<Query> &queries)
+    {
+        Query query;
+        query.id = 0;
+        while (in >> query.startX >> query.startY >> query.goalX >> query.goalY)
+        {
+            queries.push_back(query);
+            query.id++;
+        }
+    }
+
+    /**
+     * @brief Run whole batch
+     *
+     * @return Process exit code
+     */
+    int run(const Options &options)
+    {
+        if (!prepare(options))
+        {
+            return 1;
+        }
+
+        std::vector<Query> queries;
+        if (options.queryFile == "-")
+        {
+            readQueries(std::cin, queries);
+        }
+        else
+        {
+            std::ifstream queryStream(options.queryFile);
+            if (!queryStream)
+            {
+                std::cerr << "Failed to open query file " << options.queryFile << std::endl;
+                return 1;
+            }
+            readQueries(queryStream, queries);
+        }
+        m_nextQuery = 0;
+
+        const unsigned int threadCount = std::min<size_t>(options.threads, std::max<size_t>(1, queries.size()));
+        std::vector<std::vector<uint32_t>> latencies(threadCount);
+        std::vector<std::thread> workers;
+
+        const auto batchStart = std::chrono::steady_clock::now();
+        for (unsigned int i = 1; i < threadCount; ++i)
+        {
+            workers.emplace_back([this, &queries, &latencies, i]()
+                                 { _worker(queries, latencies[i]); });
+        }
+        _worker(queries, latencies[0]);
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        const double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count();
+
+        std::vector<uint32_t> allLatencies;
+        for (const auto &workerLatencies : latencies)
+        {
+            allLatencies.insert(allLatencies.end(), workerLatencies.begin(), workerLatencies.end());
+        }
+        _printSummary(allLatencies, totalSeconds, threadCount);
+
+        if (!options.traceFile.empty())
+        {
+            std::string error;
+            if (!Trace::save(options.traceFile, error))
+            {
+                std::cerr << "Failed to save trace: " << error << std::endl;
+                return 1;
+            }
+            std::cerr << "Trace with " << Trace::getEventCount() << " spans saved to " << options.traceFile << std::endl;
+        }
+        return 0;
+    }
+
+private:
+    // Worker output is flushed to stdout in chunks of this size
+    static constexpr size_t OUTPUT_CHUNK_SIZE = 64 * 1024;
+
+    bool _prepareDatabase(const Options &options)
+    {
+        std::string error;
+        if (!options.databaseFile.empty())
+        {
+            if (m_database.load(options.databaseFile, error))
+            {
+                return true;
+            }
+            std::cerr << "Rebuilding path database: " << error << std::endl;
+        }
+        const auto buildStart = std::chrono::steady_clock::now();
+        m_database.build(options.threads);
+        const double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+        std::cerr << "Built path database in " << buildSeconds << " s, " << m_database.getSizeInBytes() << " bytes" << std::endl;
+        if (!options.databaseFile.empty() && !m_database.save(options.databaseFile, error))
+        {
+            std::cerr << "Failed to save path database: " << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool _isValidPoint(const ArrayMap &map, int x, int y)
+    {
+        return x >= 0 && x < map.getWidth() && y >= 0 && y < map.getHeight() && map.isPassable(x, y);
+    }
+
+    void _worker(const std::vector<Query> &queries, std::vector<uint32_t> &latencies)
+    {
+        // ArrayMap is only read during the batch so searches in different threads don't interfere
+        std::string output;
+        output.reserve(OUTPUT_CHUNK_SIZE + 256);
+
+        for (size_t index = m_nextQuery++; index < queries.size(); index = m_nextQuery++)
+        {
+            Result result;
+            runQuery(queries[index], result);
+            latencies.push_back(result.latencyMicros);
+
+            _appendResult(output, result);
+            if (output.size() >= OUTPUT_CHUNK_SIZE)
+            {
+                _flush(output);
+            }
+        }
+        _flush(output);
+    }
+
+    void _runQuery(const Query &query, Result &result)
+    {
+        ASTAR_TRACE_QUERY(query.id);
+        ASTAR_TRACE_SPAN("query");
+        MapSearchNode nodeStart(query.startX, query.startY);
+        MapSearchNode nodeGoal(query.goalX, query.goalY);
+        SearchState state;
+        if (m_engine == Engine::ASTAR)
+        {
+            AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+            astarsearch.setNodeLimit(m_nodeLimit);
+            state = astarsearch.preformSearch();
+            result.expandedNodes = astarsearch.getStepCount();
+            result.cost = astarsearch.getSolutionCost();
+            result.pathLength = astarsearch.linearizeSolution().size();
+            size_t peak = m_peakMemory;
+            while (peak < astarsearch.getPeakMemoryBytes() && !m_peakMemory.compare_exchange_weak(peak, astarsearch.getPeakMemoryBytes()))
+            {
+            }
+        }
+        else if (m_engine == Engine::CPD)
+        {
+            std::deque<MapSearchNode> solution;
+            state = m_database.findPath(nodeStart, nodeGoal, solution) ? SearchState::SUCCEEDED : SearchState::FAILED;
+            result.cost = 0.0f;
+            for (size_t i = 1; i < solution.size(); ++i)
+            {
+                result.cost += solution[i - 1].getCost(solution[i]);
+            }
+            result.pathLength = solution.size();
+        }
+        else if (m_engine == Engine::RSR)
+        {
+            RectangleSearch rectangle(m_rectangles, nodeStart, nodeGoal);
+            state = rectangle.preformSearch();
+            result.expandedNodes = rectangle.getStepCount();
+            result.cost = rectangle.getSolutionCost();
+            result.pathLength = rectangle.linearizeSolution().size();
+        }
+        else if (m_engine == Engine::HDA)
+        {
+            ParallelAStarSearch parallel(nodeStart, nodeGoal, m_searchThreads);
+            state = parallel.preformSearch();
+            result.expandedNodes = parallel.getStepCount();
+            result.cost = parallel.getSolutionCost();
+            result.pathLength = parallel.linearizeSolution().size();
+        }
+        else
+        {
+            ThetaStarSearch theta(nodeStart, nodeGoal, m_engine == Engine::THETA ? ThetaStarSearch::Mode::THETA : ThetaStarSearch::Mode::LAZY_THETA);
+            state = theta.preformSearch();
+            result.expandedNodes = theta.getStepCount();
+            result.cost = theta.getSolutionCost();
+            result.pathLength = theta.linearizeSolution().size();
+            m_lineOfSightTotal += theta.getLineOfSightCount();
+        }
+        m_expandedTotal += result.expandedNodes;
+
+        if (state == SearchState::SUCCEEDED)
+        {
+            result.state = 'S';
+        }
+        else
+        {
+            result.state = state == SearchState::OUT_OF_MEMORY ? 'M' : 'F';
+            result.cost = -1.0f;
+            result.pathLength = 0;
+        }
+    }
+
+    void _appendResult(std::string &output, const Result &result) const
+    {
+        if (m_binary)
+        {
+            output.append(reinterpret_cast<const char *>(&result), sizeof(result));
+            return;
+        }
+        char line[128];
+        const int length = snprintf(line, sizeof(line), "%u %c %.3f %u %u %u\n", result.id, result.state,
+                                    result.cost, result.pathLength, result.expandedNodes, result.latencyMicros);
+        output.append(line, length);
+    }
+
+    void _flush(std::string &output)
+    {
+        if (output.empty())
+        {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_outputMutex);
+        fwrite(output.data(), 1, output.size(), stdout);
+        fflush(stdout);
+        output.clear();
+    }
+
+    void _printSummary(std::vector<uint32_t> &latencies, double totalSeconds, unsigned int threadCount) const
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p) -> uint32_t
+        {
+            if (latencies.empty())
+            {
+                return 0;
+            }
+            return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+        };
+
+        char summary[512];
+        snprintf(summary, sizeof(summary),
+                 "queries %zu, threads %u, total %.3f s, throughput %.1f queries/s\n"
+                 "latency us: p50 %u, p90 %u, p99 %u, max %u\n"
+                 "expanded nodes %llu, line of sight checks %llu, peak search memory %zu bytes\n",
+                 latencies.size(), threadCount, totalSeconds,
+                 totalSeconds > 0 ? latencies.size() / totalSeconds : 0.0,
+                 percentile(0.5), percentile(0.9), percentile(0.99), latencies.empty() ? 0 : latencies.back(),
+                 static_cast<unsigned long long>(m_expandedTotal.load()), static_cast<unsigned long long>(m_lineOfSightTotal.load()), m_peakMemory.load());
+        std::cerr << summary;
+    }
+
+    bool m_binary = false;
+    Engine m_engine = Engine::ASTAR;
+    unsigned int m_searchThreads = 1;
+    size_t m_nodeLimit = 0;
+    CompressedPathDatabase m_database;
+    RectangleMap m_rectangles;
+    std::atomic<uint64_t> m_expandedTotal{0};
+    std::atomic<uint64_t> m_lineOfSightTotal{0};
+    std::atomic<size_t> m_peakMemory{0}; // largest A* search, see AStarSearch::getPeakMemoryBytes
+    std::atomic<size_t> m_nextQuery{0};
+    std::mutex m_outputMutex;
+};
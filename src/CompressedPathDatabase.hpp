@@ -0,0 +1,439 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ArrayMap.hpp"
+#include "IndexSnapshot.hpp"
+#include "MapSearchNode.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Compressed path database for static ArrayMap. For every pair of passable cells it keeps
+ * the first move of an optimal path, so a query is just repeated table lookups without any search.
+ *
+ * Targets of each source row are sorted in DFS order of the map, where nearby cells usually share
+ * the first move, and the row is run-length encoded. Run is packed as (target order << 4) | move.
+ * Database is saved as IndexSnapshot and used right from the mapped file, without any parsing
+ */
+class CompressedPathDatabase
+{
+public:
+    // Snapshot sections
+    static constexpr uint32_t SECTION_HEADER = IndexSnapshot::makeId('C', 'P', 'D', 'H');
+    static constexpr uint32_t SECTION_ORDER = IndexSnapshot::makeId('C', 'P', 'D', 'O');
+    static constexpr uint32_t SECTION_OFFSETS = IndexSnapshot::makeId('C', 'P', 'D', 'F');
+    static constexpr uint32_t SECTION_RUNS = IndexSnapshot::makeId('C', 'P', 'D', 'R');
+    // Move symbol for target equal to source or unreachable target
+    static constexpr uint8_t NO_MOVE = 0x0F;
+
+    CompressedPathDatabase() = default;
+    CompressedPathDatabase(CompressedPathDatabase const &) = delete;
+    void operator=(CompressedPathDatabase const &) = delete;
+
+    /**
+     * @brief Build database for current content and connectivity of ArrayMap.
+     * Runs one Dijkstra per passable cell, sources are spread over threadCount threads
+     */
+    void build(unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        ASTAR_TRACE_SPAN("cpd build");
+        _reset();
+        const ArrayMap &map = ArrayMap::getInstance();
+        m_mapHash = map.getContentHash();
+        m_header = Header();
+        m_header.width = map.getWidth();
+        m_header.height = map.getHeight();
+        m_header.connectivity = static_cast<uint32_t>(map.getConnectivity());
+
+        _buildOrder(map);
+        const uint32_t freeCount = m_orderToCell.size();
+        m_header.freeCount = freeCount;
+
+        std::vector<std::vector<uint32_t>> rows(freeCount);
+        std::atomic<uint32_t> nextSource{0};
+        auto worker = [this, &rows, &nextSource, freeCount]()
+        {
+            DijkstraBuffers buffers;
+            for (uint32_t source = nextSource++; source < freeCount; source = nextSource++)
+            {
+                rows[source] = _buildRow(source, buffers);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < std::max(1u, threadCount); ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        m_ownedRowOffsets.assign(1, 0);
+        m_ownedRuns.clear();
+        for (const auto &row : rows)
+        {
+            m_ownedRuns.insert(m_ownedRuns.end(), row.begin(), row.end());
+            m_ownedRowOffsets.push_back(m_ownedRuns.size());
+        }
+        m_header.runCount = m_ownedRuns.size();
+
+        m_cellOrder = m_ownedCellOrder.data();
+        m_rowOffsets = m_ownedRowOffsets.data();
+        m_runs = m_ownedRuns.data();
+    }
+
+    /**
+     * @brief Write database to snapshot file tied to content of the map it was built for
+     */
+    bool save(const std::string &path, std::string &error) const
+    {
+        if (!m_cellOrder)
+        {
+            error = "database is empty";
+            return false;
+        }
+        IndexSnapshot::Writer writer;
+        writer.addSection(SECTION_HEADER, &m_header, sizeof(m_header));
+        writer.addSection(SECTION_ORDER, m_cellOrder, sizeof(int32_t) * m_header.width * m_header.height);
+        writer.addSection(SECTION_OFFSETS, m_rowOffsets, sizeof(uint64_t) * (m_header.freeCount + 1));
+        writer.addSection(SECTION_RUNS, m_runs, sizeof(uint32_t) * m_header.runCount);
+        return writer.write(path, m_mapHash, error);
+    }
+
+    /**
+     * @brief Map database from snapshot file. Tables are used right from the mapping
+     *
+     * @return false If file is missing or broken, or was built for other map content or connectivity.
+     * Caller is expected to build() database again in this case
+     */
+    bool load(const std::string &path, std::string &error)
+    {
+        ASTAR_TRACE_SPAN("cpd load");
+        _reset();
+        const ArrayMap &map = ArrayMap::getInstance();
+        if (!m_snapshot.open(path, map.getContentHash(), error))
+        {
+            return false;
+        }
+        size_t headerSize = 0;
+        const void *header = m_snapshot.getSection(SECTION_HEADER, headerSize);
+        if (!header || headerSize != sizeof(Header))
+        {
+            m_snapshot.close();
+            error = path + " has no path database";
+            return false;
+        }
+        memcpy(&m_header, header, sizeof(Header));
+        if (m_header.connectivity != static_cast<uint32_t>(map.getConnectivity()))
+        {
+            _reset();
+            error = path + " was built for other connectivity";
+            return false;
+        }
+
+        size_t orderSize = 0;
+        size_t offsetsSize = 0;
+        size_t runsSize = 0;
+        m_cellOrder = static_cast<const int32_t *>(m_snapshot.getSection(SECTION_ORDER, orderSize));
+        m_rowOffsets = static_cast<const uint64_t *>(m_snapshot.getSection(SECTION_OFFSETS, offsetsSize));
+        m_runs = static_cast<const uint32_t *>(m_snapshot.getSection(SECTION_RUNS, runsSize));
+        if (!m_cellOrder || !m_rowOffsets || (!m_runs && m_header.runCount > 0) ||
+            m_header.width != static_cast<uint32_t>(map.getWidth()) || m_header.height != static_cast<uint32_t>(map.getHeight()) ||
+            orderSize != sizeof(int32_t) * m_header.width * m_header.height ||
+            offsetsSize != sizeof(uint64_t) * (m_header.freeCount + 1) ||
+            runsSize != sizeof(uint32_t) * m_header.runCount || !_isValidTables(map))
+        {
+            _reset();
+            error = path + " has inconsistent path database tables";
+            return false;
+        }
+        m_mapHash = map.getContentHash();
+        return true;
+    }
+
+    /**
+     * @brief First move from start cell towards goal cell as index in ArrayMap::DIRECTION_DX/DY or NO_MOVE
+     */
+    uint8_t getFirstMove(int startX, int startY, int goalX, int goalY) const
+    {
+        const int32_t source = m_cellOrder[startY * static_cast<int>(m_header.width) + startX];
+        const int32_t target = m_cellOrder[goalY * static_cast<int>(m_header.width) + goalX];
+        if (source < 0 || target < 0)
+        {
+            return NO_MOVE;
+        }
+        const uint32_t *begin = m_runs + m_rowOffsets[source];
+        const uint32_t *end = m_runs + m_rowOffsets[source + 1];
+        // Last run that starts at or before target
+        const uint32_t key = (static_cast<uint32_t>(target) << 4) | 0x0F;
+        const uint32_t *run = std::upper_bound(begin, end, key) - 1;
+        return *run & 0x0F;
+    }
+
+    /**
+     * @brief Restore optimal path by following first moves
+     *
+     * @return false If goal is not reachable from start
+     */
+    bool findPath(const MapSearchNode &start, const MapSearchNode &goal, std::deque<MapSearchNode> &path) const
+    {
+        path.clear();
+        if (!_isInside(start.x, start.y) || !_isInside(goal.x, goal.y))
+        {
+            return false;
+        }
+        MapSearchNode current = start;
+        path.push_back(current);
+        // Path can't be longer than number of free cells
+        for (uint32_t step = 0; step <= m_header.freeCount; ++step)
+        {
+            if (current.x == goal.x && current.y == goal.y)
+            {
+                return true;
+            }
+            const uint8_t move = getFirstMove(current.x, current.y, goal.x, goal.y);
+            if (move == NO_MOVE)
+            {
+                break;
+            }
+            current = MapSearchNode(current.x + ArrayMap::DIRECTION_DX[move], current.y + ArrayMap::DIRECTION_DY[move]);
+            path.push_back(current);
+        }
+        path.clear();
+        return false;
+    }
+
+    bool isEmpty() const { return m_cellOrder == nullptr; }
+
+    uint32_t getFreeCellCount() const { return m_header.freeCount; }
+
+    uint64_t getRunCount() const { return m_header.runCount; }
+
+    ArrayMap::Connectivity getConnectivity() const { return static_cast<ArrayMap::Connectivity>(m_header.connectivity); }
+
+    /**
+     * @brief Size of tables in bytes
+     */
+    size_t getSizeInBytes() const
+    {
+        const size_t cellCount = static_cast<size_t>(m_header.width) * m_header.height;
+        return sizeof(Header) + cellCount * sizeof(int32_t) +
+               (m_header.freeCount + 1) * sizeof(uint64_t) + m_header.runCount * sizeof(uint32_t);
+    }
+
+private:
+    struct Header
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t connectivity = 0;
+        uint32_t freeCount = 0;
+        uint64_t runCount = 0;
+    };
+
+    struct DijkstraBuffers
+    {
+        std::vector<float> distances;
+        std::vector<uint8_t> firstMoves;
+    };
+
+    bool _isInside(int x, int y) const
+    {
+        return x >= 0 && x < static_cast<int>(m_header.width) && y >= 0 && y < static_cast<int>(m_header.height);
+    }
+
+    /**
+     * @brief Number passable cells in depth-first order so cells close on the map are close in order
+     */
+    void _buildOrder(const ArrayMap &map)
+    {
+        const int width = map.getWidth();
+        const size_t cellCount = static_cast<size_t>(width) * map.getHeight();
+        m_ownedCellOrder.assign(cellCount, -1);
+        m_orderToCell.clear();
+        std::vector<int> stack;
+        for (size_t root = 0; root < cellCount; ++root)
+        {
+            if (m_ownedCellOrder[root] >= 0 || !map.isPassable(root % width, root / width))
+            {
+                continue;
+            }
+            stack.push_back(root);
+            while (!stack.empty())
+            {
+                const int cell = stack.back();
+                stack.pop_back();
+                if (m_ownedCellOrder[cell] >= 0)
+                {
+                    continue;
+                }
+                m_ownedCellOrder[cell] = m_orderToCell.size();
+                m_orderToCell.push_back(cell);
+                const int x = cell % width;
+                const int y = cell / width;
+                unsigned int mask = map.getNeighborMask(x, y);
+                for (int dir = ArrayMap::DIRECTION_COUNT - 1; dir >= 0; --dir)
+                {
+                    const int neighbor = (y + ArrayMap::DIRECTION_DY[dir]) * width + x + ArrayMap::DIRECTION_DX[dir];
+                    if ((mask >> dir) & 1 && m_ownedCellOrder[neighbor] < 0)
+                    {
+                        stack.push_back(neighbor);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Dijkstra from one source with MapSearchNode costs, first move of each target is inherited from its parent
+     */
+    std::vector<uint32_t> _buildRow(uint32_t source, DijkstraBuffers &buffers) const
+    {
+        const ArrayMap &map = ArrayMap::getInstance();
+        const int width = map.getWidth();
+        const size_t cellCount = static_cast<size_t>(width) * map.getHeight();
+        buffers.distances.assign(cellCount, FLT_MAX);
+        buffers.firstMoves.assign(cellCount, NO_MOVE);
+
+        using Entry = std::pair<float, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        const int sourceCell = m_orderToCell[source];
+        buffers.distances[sourceCell] = 0.0f;
+        open.push(Entry(0.0f, sourceCell));
+        while (!open.empty())
+        {
+            const Entry entry = open.top();
+            open.pop();
+            const int cell = entry.second;
+            if (entry.first > buffers.distances[cell])
+            {
+                continue;
+            }
+            const int x = cell % width;
+            const int y = cell / width;
+            MapSearchNode from(x, y);
+            unsigned int mask = map.getNeighborMask(x, y);
+            for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+            {
+                if (mask & 1)
+                {
+                    MapSearchNode to(x + ArrayMap::DIRECTION_DX[dir], y + ArrayMap::DIRECTION_DY[dir]);
+                    const int neighbor = to.y * width + to.x;
+                    const float distance = entry.first + from.getCost(to);
+                    if (distance < buffers.distances[neighbor])
+                    {
+                        buffers.distances[neighbor] = distance;
+                        buffers.firstMoves[neighbor] = cell == sourceCell ? dir : buffers.firstMoves[cell];
+                        open.push(Entry(distance, neighbor));
+                    }
+                }
+            }
+        }
+
+        std::vector<uint32_t> row;
+        uint8_t previous = 0xFF;
+        for (uint32_t target = 0; target < m_orderToCell.size(); ++target)
+        {
+            const uint8_t move = buffers.firstMoves[m_orderToCell[target]];
+            if (move != previous)
+            {
+                row.push_back((target << 4) | move);
+                previous = move;
+            }
+        }
+        return row;
+    }
+
+    /**
+     * @brief Cell order numbers passable cells from 0 to freeCount, row offsets go from 0 to runCount without going down,
+     * every row starts at target 0 with increasing targets, and every move stays on the map
+     */
+    bool _isValidTables(const ArrayMap &map) const
+    {
+        const int width = m_header.width;
+        const size_t cellCount = static_cast<size_t>(width) * m_header.height;
+        if (m_rowOffsets[0] != 0 || m_rowOffsets[m_header.freeCount] != m_header.runCount)
+        {
+            return false;
+        }
+        std::vector<uint8_t> isUsed(m_header.freeCount, 0);
+        uint32_t usedCount = 0;
+        for (size_t cell = 0; cell < cellCount; ++cell)
+        {
+            const int32_t source = m_cellOrder[cell];
+            const int x = cell % width;
+            const int y = cell / width;
+            if (source < 0)
+            {
+                if (source != -1 || map.isPassable(x, y))
+                {
+                    return false;
+                }
+                continue;
+            }
+            if (static_cast<uint32_t>(source) >= m_header.freeCount || isUsed[source] || !map.isPassable(x, y))
+            {
+                return false;
+            }
+            isUsed[source] = 1;
+            ++usedCount;
+            const uint64_t begin = m_rowOffsets[source];
+            const uint64_t end = m_rowOffsets[source + 1];
+            if (begin >= end || end > m_header.runCount || (m_runs[begin] >> 4) != 0)
+            {
+                return false;
+            }
+            for (uint64_t index = begin; index < end; ++index)
+            {
+                const uint32_t target = m_runs[index] >> 4;
+                const uint8_t move = m_runs[index] & 0x0F;
+                if (target >= m_header.freeCount || (index > begin && target <= (m_runs[index - 1] >> 4)))
+                {
+                    return false;
+                }
+                if (move != NO_MOVE &&
+                    (move >= ArrayMap::DIRECTION_COUNT || !_isInside(x + ArrayMap::DIRECTION_DX[move], y + ArrayMap::DIRECTION_DY[move])))
+                {
+                    return false;
+                }
+            }
+        }
+        return usedCount == m_header.freeCount;
+    }
+
+    void _reset()
+    {
+        m_snapshot.close();
+        m_header = Header();
+        m_cellOrder = nullptr;
+        m_rowOffsets = nullptr;
+        m_runs = nullptr;
+    }
+
+    Header m_header;
+    uint64_t m_mapHash = 0;
+
+    // Tables used by queries. Point either to owned vectors after build or into snapshot after load
+    const int32_t *m_cellOrder = nullptr;   // order of each cell or -1 for walls
+    const uint64_t *m_rowOffsets = nullptr; // first run of each source, freeCount + 1 entries
+    const uint32_t *m_runs = nullptr;
+
+    std::vector<int32_t> m_ownedCellOrder;
+    std::vector<int> m_orderToCell;
+    std::vector<uint64_t> m_ownedRowOffsets;
+    std::vector<uint32_t> m_ownedRuns;
+
+    IndexSnapshot m_snapshot;
+};
@@ -1,46 +1,208 @@
 #pragma once
+#include <algorithm>
+#include <deque>
 #include <iostream>
 #include <memory>
+#include <string>
+
+#include <unistd.h>
 
 #include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+#include "Trace.hpp"
 
 class ConsoleFrontend
 {
 public:
+    /**
+     * @brief Rectangle of map cells to be rendered
+     */
+    struct Viewport
+    {
+        int left;
+        int top;
+        int width;
+        int height;
+    };
+
     void draw(ArrayMap &map) const
     {
-        for (size_t i = 0; i < map.getHeight(); ++i)
+        _write(renderFrame(map, fullViewport(map), 1));
+    }
+
+    /**
+     * @brief Draw only part of the map, e.g. from pathViewport()
+     */
+    void drawViewport(ArrayMap &map, const Viewport &viewport) const
+    {
+        _write(renderFrame(map, viewport, 1));
+    }
+
+    /**
+     * @brief Draw whole map shrunk to fit in maxColumns characters. Each character
+     * stands for a square block of cells and shows the most important cell inside it
+     */
+    void drawOverview(ArrayMap &map, int maxColumns) const
+    {
+        maxColumns = std::max(1, maxColumns);
+        const int blockSize = std::max(1, (map.getWidth() + maxColumns - 1) / maxColumns);
+        _write(renderFrame(map, fullViewport(map), blockSize));
+    }
+
+    static Viewport fullViewport(const ArrayMap &map)
+    {
+        return Viewport{0, 0, map.getWidth(), map.getHeight()};
+    }
+
+    /**
+     * @brief Bounding box of the path extended by margin cells and clipped by map borders
+     */
+    static Viewport pathViewport(const ArrayMap &map, const std::deque<MapSearchNode> &path, int margin)
+    {
+        if (path.empty())
+        {
+            return fullViewport(map);
+        }
+        int minX = path.front().x, maxX = path.front().x;
+        int minY = path.front().y, maxY = path.front().y;
+        for (const auto &node : path)
+        {
+            minX = std::min(minX, node.x);
+            maxX = std::max(maxX, node.x);
+            minY = std::min(minY, node.y);
+            maxY = std::max(maxY, node.y);
+        }
+        const int left = std::max(0, minX - margin);
+        const int top = std::max(0, minY - margin);
+        const int right = std::min(map.getWidth() - 1, maxX + margin);
+        const int bottom = std::min(map.getHeight() - 1, maxY + margin);
+        return Viewport{left, top, right - left + 1, bottom - top + 1};
+    }
+
+    /**
+     * @brief Build whole frame in one string so it can be written at once
+     *
+     * @param blockSize Side of square block of cells represented by one character, values below 1 are taken as 1
+     */
+    std::string renderFrame(ArrayMap &map, const Viewport &viewport, int blockSize) const
+    {
+        ASTAR_TRACE_SPAN("console render");
+        blockSize = std::max(1, blockSize);
+        const auto &viewMap = map.getViewMap();
+        const int left = std::max(0, viewport.left);
+        const int top = std::max(0, viewport.top);
+        const int right = std::min(map.getWidth(), viewport.left + viewport.width);
+        const int bottom = std::min(map.getHeight(), viewport.top + viewport.height);
+        if (left >= right || top >= bottom)
+        {
+            return std::string();
+        }
+
+        const int columns = (right - left + blockSize - 1) / blockSize;
+        const int rows = (bottom - top + blockSize - 1) / blockSize;
+        std::string frame;
+        frame.reserve(static_cast<size_t>(rows) * (columns + 3));
+
+        for (int y = top; y < bottom; y += blockSize)
         {
-            std::cout << "|";
-            for (size_t j = 0; j < map.getWidth(); ++j)
+            frame.push_back('|');
+            for (int x = left; x < right; x += blockSize)
             {
-                auto currentCell = static_cast<ArrayMap::CellType>(map.getViewMap()[i][j]);
-                switch (currentCell)
+                if (blockSize == 1)
+                {
+                    frame.push_back(_cellSymbol(static_cast<ArrayMap::CellType>(viewMap[y][x])));
+                    continue;
+                }
+
+                // Pick the most important mark in block. Walls are shown only if they fill at least half of it
+                int bestPriority = 0;
+                char bestSymbol = ' ';
+                int wallCount = 0;
+                int cellCount = 0;
+                for (int by = y; by < std::min(y + blockSize, bottom); ++by)
+                {
+                    for (int bx = x; bx < std::min(x + blockSize, right); ++bx)
+                    {
+                        auto cell = static_cast<ArrayMap::CellType>(viewMap[by][bx]);
+                        cellCount++;
+                        if (cell == ArrayMap::CellType::WALL_POS)
+                        {
+                            wallCount++;
+                        }
+                        else if (_cellPriority(cell) > bestPriority)
+                        {
+                            bestPriority = _cellPriority(cell);
+                            bestSymbol = _cellSymbol(cell);
+                        }
+                    }
+                }
+                if (bestPriority == 0 && wallCount * 2 >= cellCount)
                 {
-                case ArrayMap::CellType::WALL_POS:
-                    std::cout << "X";
-                    break;
-                case ArrayMap::CellType::PATH_POS:
-                    std::cout << "*";
-                    break;
-                case ArrayMap::CellType::START_POS:
-                    std::cout << "s";
-                    break;
-                case ArrayMap::CellType::GOAL_POS:
-                    std::cout << "g";
-                    break;
-                case ArrayMap::CellType::OPEN_PATH_POS:
-                    std::cout << "+";
-                    break;
-                case ArrayMap::CellType::CLOSE_PATH_POS:
-                    std::cout << "-";
-                    break;
-                default:
-                    std::cout << " ";
-                    break;
+                    bestSymbol = _cellSymbol(ArrayMap::CellType::WALL_POS);
                 }
+                frame.push_back(bestSymbol);
+            }
+            frame.append("|\n");
+        }
+        return frame;
+    }
+
+private:
+    static char _cellSymbol(ArrayMap::CellType cell)
+    {
+        switch (cell)
+        {
+        case ArrayMap::CellType::WALL_POS:
+            return 'X';
+        case ArrayMap::CellType::PATH_POS:
+            return '*';
+        case ArrayMap::CellType::START_POS:
+            return 's';
+        case ArrayMap::CellType::GOAL_POS:
+            return 'g';
+        case ArrayMap::CellType::OPEN_PATH_POS:
+            return '+';
+        case ArrayMap::CellType::CLOSE_PATH_POS:
+            return '-';
+        default:
+            return ' ';
+        }
+    }
+
+    static int _cellPriority(ArrayMap::CellType cell)
+    {
+        switch (cell)
+        {
+        case ArrayMap::CellType::START_POS:
+        case ArrayMap::CellType::GOAL_POS:
+            return 4;
+        case ArrayMap::CellType::PATH_POS:
+            return 3;
+        case ArrayMap::CellType::OPEN_PATH_POS:
+            return 2;
+        case ArrayMap::CellType::CLOSE_PATH_POS:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Write frame straight to stdout descriptor, normally with a single syscall
+     */
+    static void _write(const std::string &frame)
+    {
+        // Anything already buffered in std::cout has to go first
+        std::cout.flush();
+        size_t written = 0;
+        while (written < frame.size())
+        {
+            const ssize_t result = ::write(STDOUT_FILENO, frame.data() + written, frame.size() - written);
+            if (result <= 0)
+            {
+                break;
             }
-            std::cout << "|" << std::endl;
+            written += result;
         }
     }
 };
@@ -0,0 +1,883 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "CsrGraph.hpp"
+#include "IndexSnapshot.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Contraction Hierarchies for static CsrGraph.
+ *
+ * Preprocessing contracts vertices from least to most important and adds shortcut edges that keep
+ * distances between remaining vertices. Every round contracts a set of vertices that are local minima
+ * of priority among their neighbours, witness searches of the round run in parallel and don't pass through
+ * vertices of the round. Query is bidirectional Dijkstra that only goes up in the hierarchy,
+ * shortcuts of the found path are unpacked into original edges
+ */
+class ContractionHierarchy
+{
+public:
+    using VertexId = CsrGraph::VertexId;
+    static constexpr uint64_t NO_PATH = UINT64_MAX;
+
+    // Snapshot sections
+    static constexpr uint32_t SECTION_HEADER = IndexSnapshot::makeId('C', 'H', 'H', 'D');
+    static constexpr uint32_t SECTION_RANKS = IndexSnapshot::makeId('C', 'H', 'R', 'K');
+    static constexpr uint32_t SECTION_FORWARD_OFFSETS = IndexSnapshot::makeId('C', 'H', 'F', 'O');
+    static constexpr uint32_t SECTION_FORWARD_ARCS = IndexSnapshot::makeId('C', 'H', 'F', 'A');
+    static constexpr uint32_t SECTION_BACKWARD_OFFSETS = IndexSnapshot::makeId('C', 'H', 'B', 'O');
+    static constexpr uint32_t SECTION_BACKWARD_ARCS = IndexSnapshot::makeId('C', 'H', 'B', 'A');
+
+    /**
+     * @brief Edge of upward graph. Middle is the contracted vertex of shortcut or NO_VERTEX for original edge
+     */
+    struct Arc
+    {
+        VertexId target;
+        uint32_t weight;
+        VertexId middle;
+    };
+
+    struct Stats
+    {
+        uint32_t rounds = 0;
+        uint64_t shortcuts = 0;
+        double seconds = 0.0;
+    };
+
+    ContractionHierarchy() = default;
+    ContractionHierarchy(ContractionHierarchy const &) = delete;
+    void operator=(ContractionHierarchy const &) = delete;
+
+    /**
+     * @brief Contract whole graph using threadCount threads for witness searches
+     */
+    void build(const CsrGraph &graph, unsigned int threadCount = std::thread::hardware_concurrency())
+    {
+        ASTAR_TRACE_SPAN("ch build");
+        const auto buildStart = std::chrono::steady_clock::now();
+        _reset();
+        m_stats = Stats();
+        m_graphHash = graph.getContentHash();
+        const uint32_t vertexCount = graph.getVertexCount();
+        threadCount = std::max(1u, threadCount);
+
+        Contraction contraction;
+        contraction.out.resize(vertexCount);
+        contraction.in.resize(vertexCount);
+        contraction.upwardOut.resize(vertexCount);
+        contraction.upwardIn.resize(vertexCount);
+        contraction.outPosition.assign(vertexCount, NO_POSITION);
+        for (VertexId v = 0; v < vertexCount; ++v)
+        {
+            for (uint32_t edge = graph.getEdgeBegin(v); edge < graph.getEdgeEnd(v); ++edge)
+            {
+                if (graph.getTarget(edge) != v)
+                {
+                    _insertArc(contraction, v, graph.getTarget(edge), graph.getWeight(edge), CsrGraph::NO_VERTEX);
+                }
+            }
+        }
+        _forgetPositions(contraction);
+        contraction.state.assign(vertexCount, ACTIVE);
+        contraction.priority.assign(vertexCount, 0);
+        contraction.contractedNeighbors.assign(vertexCount, 0);
+        contraction.isStale.assign(vertexCount, 0);
+        m_ownedRanks.assign(vertexCount, 0);
+
+        // Vertices whose priority or neighbours changed, only they can become local minima
+        std::vector<VertexId> checks(vertexCount);
+        for (VertexId v = 0; v < vertexCount; ++v)
+        {
+            checks[v] = v;
+        }
+        _parallelFor(checks.size(), threadCount, [&](size_t index, WitnessSearch &search)
+                     { contraction.priority[checks[index]] = _priority(contraction, checks[index], search, nullptr); });
+        std::vector<uint8_t> isChecked(vertexCount, 1);
+
+        uint32_t nextRank = 0;
+        std::vector<VertexId> candidates;
+        std::vector<VertexId> stale;
+        std::vector<VertexId> batch;
+        std::vector<std::vector<Shortcut>> shortcuts;
+        std::vector<VertexId> nextChecks;
+        const auto check = [&](VertexId v)
+        {
+            if (!isChecked[v] && contraction.state[v] == ACTIVE)
+            {
+                isChecked[v] = 1;
+                nextChecks.push_back(v);
+            }
+        };
+        while (nextRank < vertexCount)
+        {
+            // Independent set of local minima, ties are broken by id. Priorities of neighbours of contracted
+            // vertices are updated lazily: only candidates get the new one and have to stay local minima with it
+            candidates.clear();
+            stale.clear();
+            for (const VertexId v : checks)
+            {
+                isChecked[v] = 0;
+                if (contraction.state[v] == ACTIVE && _isLocalMinimum(contraction, v))
+                {
+                    candidates.push_back(v);
+                    if (contraction.isStale[v])
+                    {
+                        stale.push_back(v);
+                    }
+                }
+            }
+            nextChecks.clear();
+            std::vector<int64_t> oldPriorities(stale.size());
+            for (size_t index = 0; index < stale.size(); ++index)
+            {
+                oldPriorities[index] = contraction.priority[stale[index]];
+            }
+            _parallelFor(stale.size(), threadCount, [&](size_t index, WitnessSearch &search)
+                         { contraction.priority[stale[index]] = _priority(contraction, stale[index], search, nullptr); });
+            for (size_t index = 0; index < stale.size(); ++index)
+            {
+                const VertexId v = stale[index];
+                contraction.isStale[v] = 0;
+                if (contraction.priority[v] != oldPriorities[index])
+                {
+                    check(v);
+                    for (const auto *arcs : {&contraction.out[v], &contraction.in[v]})
+                    {
+                        for (const Arc &arc : *arcs)
+                        {
+                            check(arc.target);
+                        }
+                    }
+                }
+            }
+            batch.clear();
+            for (const VertexId v : candidates)
+            {
+                if (stale.empty() || _isLocalMinimum(contraction, v))
+                {
+                    batch.push_back(v);
+                }
+            }
+            for (const VertexId v : batch)
+            {
+                contraction.state[v] = IN_BATCH;
+            }
+
+            shortcuts.assign(batch.size(), std::vector<Shortcut>());
+            _parallelFor(batch.size(), threadCount, [&](size_t index, WitnessSearch &search)
+                         { _priority(contraction, batch[index], search, &shortcuts[index]); });
+
+            for (size_t index = 0; index < batch.size(); ++index)
+            {
+                const VertexId v = batch[index];
+                m_ownedRanks[v] = nextRank++;
+                contraction.state[v] = CONTRACTED;
+                for (const Shortcut &shortcut : shortcuts[index])
+                {
+                    _insertArc(contraction, shortcut.from, shortcut.to, shortcut.weight, v);
+                }
+                _forgetPositions(contraction);
+                m_stats.shortcuts += shortcuts[index].size();
+
+                // All neighbours are contracted later, so arcs of v are its upward arcs.
+                // They are removed from the remaining graph to keep its degrees low
+                contraction.upwardOut[v] = std::move(contraction.out[v]);
+                contraction.upwardIn[v] = std::move(contraction.in[v]);
+                contraction.out[v].clear();
+                contraction.in[v].clear();
+                for (const Arc &arc : contraction.upwardOut[v])
+                {
+                    _eraseArc(contraction.in[arc.target], v);
+                    contraction.contractedNeighbors[arc.target]++;
+                    contraction.isStale[arc.target] = 1;
+                }
+                for (const Arc &arc : contraction.upwardIn[v])
+                {
+                    _eraseArc(contraction.out[arc.target], v);
+                    contraction.contractedNeighbors[arc.target]++;
+                    contraction.isStale[arc.target] = 1;
+                }
+            }
+            // Neighbours of contracted vertices lost them and got shortcuts
+            for (const VertexId v : batch)
+            {
+                for (const auto *arcs : {&contraction.upwardOut[v], &contraction.upwardIn[v]})
+                {
+                    for (const Arc &arc : *arcs)
+                    {
+                        check(arc.target);
+                    }
+                }
+            }
+            checks.swap(nextChecks);
+            m_stats.rounds++;
+        }
+
+        m_ownedForwardOffsets.assign(vertexCount + 1, 0);
+        m_ownedBackwardOffsets.assign(vertexCount + 1, 0);
+        m_ownedForwardArcs.clear();
+        m_ownedBackwardArcs.clear();
+        for (VertexId v = 0; v < vertexCount; ++v)
+        {
+            m_ownedForwardArcs.insert(m_ownedForwardArcs.end(), contraction.upwardOut[v].begin(), contraction.upwardOut[v].end());
+            m_ownedBackwardArcs.insert(m_ownedBackwardArcs.end(), contraction.upwardIn[v].begin(), contraction.upwardIn[v].end());
+            m_ownedForwardOffsets[v + 1] = m_ownedForwardArcs.size();
+            m_ownedBackwardOffsets[v + 1] = m_ownedBackwardArcs.size();
+        }
+        m_header.vertexCount = vertexCount;
+        m_header.forwardArcCount = m_ownedForwardArcs.size();
+        m_header.backwardArcCount = m_ownedBackwardArcs.size();
+        _setViews(m_ownedRanks.data(), m_ownedForwardOffsets.data(), m_ownedForwardArcs.data(),
+                  m_ownedBackwardOffsets.data(), m_ownedBackwardArcs.data());
+        m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    }
+
+    /**
+     * @brief Write hierarchy as IndexSnapshot tied to content of the graph
+     */
+    bool save(const std::string &path, std::string &error) const
+    {
+        IndexSnapshot::Writer writer;
+        writer.addSection(SECTION_HEADER, &m_header, sizeof(m_header));
+        writer.addSection(SECTION_RANKS, m_ranks, sizeof(uint32_t) * m_header.vertexCount);
+        writer.addSection(SECTION_FORWARD_OFFSETS, m_forwardOffsets, sizeof(uint32_t) * (m_header.vertexCount + 1));
+        writer.addSection(SECTION_FORWARD_ARCS, m_forwardArcs, sizeof(Arc) * m_header.forwardArcCount);
+        writer.addSection(SECTION_BACKWARD_OFFSETS, m_backwardOffsets, sizeof(uint32_t) * (m_header.vertexCount + 1));
+        writer.addSection(SECTION_BACKWARD_ARCS, m_backwardArcs, sizeof(Arc) * m_header.backwardArcCount);
+        return writer.write(path, m_graphHash, error);
+    }
+
+    /**
+     * @brief Map hierarchy built for the same graph
+     *
+     * @return false If file is missing, broken or was built for other graph, then build() is needed
+     */
+    bool load(const std::string &path, const CsrGraph &graph, std::string &error)
+    {
+        _reset();
+        if (!m_snapshot.open(path, graph.getContentHash(), error))
+        {
+            return false;
+        }
+        size_t size = 0;
+        const void *header = m_snapshot.getSection(SECTION_HEADER, size);
+        if (!header || size != sizeof(Header))
+        {
+            _reset();
+            error = path + " has no contraction hierarchy";
+            return false;
+        }
+        memcpy(&m_header, header, sizeof(Header));
+        size_t ranksSize = 0, forwardOffsetsSize = 0, forwardArcsSize = 0, backwardOffsetsSize = 0, backwardArcsSize = 0;
+        const auto *ranks = static_cast<const uint32_t *>(m_snapshot.getSection(SECTION_RANKS, ranksSize));
+        const auto *forwardOffsets = static_cast<const uint32_t *>(m_snapshot.getSection(SECTION_FORWARD_OFFSETS, forwardOffsetsSize));
+        const auto *forwardArcs = static_cast<const Arc *>(m_snapshot.getSection(SECTION_FORWARD_ARCS, forwardArcsSize));
+        const auto *backwardOffsets = static_cast<const uint32_t *>(m_snapshot.getSection(SECTION_BACKWARD_OFFSETS, backwardOffsetsSize));
+        const auto *backwardArcs = static_cast<const Arc *>(m_snapshot.getSection(SECTION_BACKWARD_ARCS, backwardArcsSize));
+        const size_t offsetsSize = sizeof(uint32_t) * (m_header.vertexCount + 1);
+        if (m_header.vertexCount != graph.getVertexCount() || !forwardOffsets || !backwardOffsets ||
+            ranksSize != sizeof(uint32_t) * m_header.vertexCount || forwardOffsetsSize != offsetsSize || backwardOffsetsSize != offsetsSize ||
+            forwardArcsSize != sizeof(Arc) * m_header.forwardArcCount || backwardArcsSize != sizeof(Arc) * m_header.backwardArcCount)
+        {
+            _reset();
+            error = path + " has inconsistent hierarchy arrays";
+            return false;
+        }
+        // Queries and unpacking index arrays by offsets and targets, and unpacking ends only if middles go down
+        if (!_isValidRanks(ranks, m_header.vertexCount) ||
+            !_isValidUpwardArcs(ranks, forwardOffsets, forwardArcs, m_header.vertexCount, m_header.forwardArcCount) ||
+            !_isValidUpwardArcs(ranks, backwardOffsets, backwardArcs, m_header.vertexCount, m_header.backwardArcCount))
+        {
+            _reset();
+            error = path + " has broken hierarchy arcs";
+            return false;
+        }
+        m_graphHash = graph.getContentHash();
+        _setViews(ranks, forwardOffsets, forwardArcs, backwardOffsets, backwardArcs);
+        return true;
+    }
+
+    const Stats &getStats() const { return m_stats; }
+
+    uint32_t getVertexCount() const { return m_header.vertexCount; }
+
+    uint64_t getArcCount() const { return uint64_t(m_header.forwardArcCount) + m_header.backwardArcCount; }
+
+    uint32_t getRank(VertexId vertex) const { return m_ranks[vertex]; }
+
+    /**
+     * @brief Query with its own search buffers. Hierarchy is only read, so every thread can have its own query.
+     * Buffers are reset by generation stamp, so a query doesn't touch memory of vertices it doesn't visit
+     */
+    class Query
+    {
+    public:
+        explicit Query(const ContractionHierarchy &hierarchy)
+            : m_hierarchy(hierarchy)
+        {
+            for (auto &side : m_sides)
+            {
+                side.distance.resize(hierarchy.getVertexCount());
+                side.parent.resize(hierarchy.getVertexCount());
+                side.parentArc.resize(hierarchy.getVertexCount());
+                side.generation.assign(hierarchy.getVertexCount(), 0);
+            }
+        }
+
+        /**
+         * @brief Cost of shortest path from source to target or NO_PATH. If path is given it receives
+         * all vertices of the path with shortcuts unpacked
+         */
+        uint64_t findPath(VertexId source, VertexId target, std::vector<VertexId> *path = nullptr)
+        {
+            m_settledCount = 0;
+            if (path)
+            {
+                path->clear();
+            }
+            if (++m_generation == 0)
+            {
+                for (auto &side : m_sides)
+                {
+                    std::fill(side.generation.begin(), side.generation.end(), 0);
+                }
+                m_generation = 1;
+            }
+            const ArcView views[2] = {{m_hierarchy.m_forwardOffsets, m_hierarchy.m_forwardArcs},
+                                      {m_hierarchy.m_backwardOffsets, m_hierarchy.m_backwardArcs}};
+            _visit(m_sides[0], source, 0, CsrGraph::NO_VERTEX, nullptr);
+            _visit(m_sides[1], target, 0, CsrGraph::NO_VERTEX, nullptr);
+
+            uint64_t best = NO_PATH;
+            VertexId meeting = CsrGraph::NO_VERTEX;
+            while (true)
+            {
+                // Continue with the side that has smaller key, side is finished once its key reaches best
+                int sideIndex = -1;
+                for (int i = 0; i < 2; ++i)
+                {
+                    if (!m_sides[i].open.empty() && m_sides[i].open.top().first < best &&
+                        (sideIndex < 0 || m_sides[i].open.top().first < m_sides[sideIndex].open.top().first))
+                    {
+                        sideIndex = i;
+                    }
+                }
+                if (sideIndex < 0)
+                {
+                    break;
+                }
+                Side &side = m_sides[sideIndex];
+                Side &other = m_sides[1 - sideIndex];
+                const auto entry = side.open.top();
+                side.open.pop();
+                const VertexId vertex = entry.second;
+                if (entry.first > side.distance[vertex])
+                {
+                    continue;
+                }
+                ++m_settledCount;
+                if (other.generation[vertex] == m_generation && entry.first + other.distance[vertex] < best)
+                {
+                    best = entry.first + other.distance[vertex];
+                    meeting = vertex;
+                }
+                const ArcView &view = views[sideIndex];
+                for (uint32_t index = view.offsets[vertex]; index < view.offsets[vertex + 1]; ++index)
+                {
+                    const Arc &arc = view.arcs[index];
+                    _visit(side, arc.target, entry.first + arc.weight, vertex, &arc);
+                }
+            }
+            for (auto &side : m_sides)
+            {
+                side.open = OpenQueue();
+            }
+
+            if (path && best != NO_PATH)
+            {
+                // Forward half is collected backwards from meeting vertex, backward half goes in path order
+                std::vector<VertexId> up;
+                for (VertexId v = meeting; v != source; v = m_sides[0].parent[v])
+                {
+                    up.push_back(v);
+                }
+                path->push_back(source);
+                for (auto it = up.rbegin(); it != up.rend(); ++it)
+                {
+                    m_hierarchy._unpack(m_sides[0].parent[*it], *it, m_sides[0].parentArc[*it]->middle, *path);
+                }
+                // Backward arc of x to v is original direction edge v -> x
+                for (VertexId v = meeting; v != target; v = m_sides[1].parent[v])
+                {
+                    m_hierarchy._unpack(v, m_sides[1].parent[v], m_sides[1].parentArc[v]->middle, *path);
+                }
+            }
+            return best;
+        }
+
+        /**
+         * @brief Number of vertices settled by the last query in both directions
+         */
+        size_t getSettledCount() const { return m_settledCount; }
+
+    private:
+        using OpenEntry = std::pair<uint64_t, VertexId>;
+        using OpenQueue = std::priority_queue<OpenEntry, std::vector<OpenEntry>, std::greater<OpenEntry>>;
+
+        struct Side
+        {
+            std::vector<uint64_t> distance;
+            std::vector<VertexId> parent;
+            std::vector<const Arc *> parentArc;
+            std::vector<uint32_t> generation;
+            OpenQueue open;
+        };
+
+        struct ArcView
+        {
+            const uint32_t *offsets;
+            const Arc *arcs;
+        };
+
+        void _visit(Side &side, VertexId vertex, uint64_t distance, VertexId parent, const Arc *arc)
+        {
+            if (side.generation[vertex] != m_generation || distance < side.distance[vertex])
+            {
+                side.generation[vertex] = m_generation;
+                side.distance[vertex] = distance;
+                side.parent[vertex] = parent;
+                side.parentArc[vertex] = arc;
+                side.open.push(OpenEntry(distance, vertex));
+            }
+        }
+
+        const ContractionHierarchy &m_hierarchy;
+        Side m_sides[2];
+        uint32_t m_generation = 0;
+        size_t m_settledCount = 0;
+    };
+
+private:
+    enum VertexState : uint8_t
+    {
+        ACTIVE,
+        IN_BATCH,
+        CONTRACTED
+    };
+
+    // Witness search stops after this many settled vertices and adds shortcut, which is always safe.
+    // Priorities are only estimates, their searches also don't go further than a few arcs
+    static constexpr uint32_t WITNESS_SETTLE_LIMIT = 500;
+    static constexpr uint8_t PRIORITY_HOP_LIMIT = 5;
+    static constexpr uint8_t NO_HOP_LIMIT = UINT8_MAX;
+    static constexpr uint32_t NO_POSITION = UINT32_MAX;
+
+    struct Header
+    {
+        uint32_t vertexCount = 0;
+        uint32_t forwardArcCount = 0;
+        uint32_t backwardArcCount = 0;
+        uint32_t reserved = 0;
+    };
+
+    struct Shortcut
+    {
+        VertexId from;
+        VertexId to;
+        uint32_t weight;
+    };
+
+    /**
+     * @brief Graph during preprocessing. In-arcs store source vertex as target.
+     * Out and in hold arcs between not contracted vertices, upward arcs are moved out on contraction
+     */
+    struct Contraction
+    {
+        std::vector<std::vector<Arc>> out;
+        std::vector<std::vector<Arc>> in;
+        std::vector<std::vector<Arc>> upwardOut;
+        std::vector<std::vector<Arc>> upwardIn;
+        std::vector<uint8_t> state;
+        std::vector<int64_t> priority;
+        std::vector<uint32_t> contractedNeighbors;
+        std::vector<uint8_t> isStale; // neighbour was contracted since priority was computed
+        // Position of arc to every vertex in out arcs of indexedFrom or NO_POSITION
+        std::vector<uint32_t> outPosition;
+        VertexId indexedFrom = CsrGraph::NO_VERTEX;
+    };
+
+    struct WitnessSearch
+    {
+        std::vector<uint64_t> distance;
+        std::vector<uint8_t> hops;     // arcs on the path to vertex
+        std::vector<uint8_t> isTarget; // out neighbour of contracted vertex, search ends when all are settled
+        std::vector<VertexId> touched;
+    };
+
+    template <class Function>
+    void _parallelFor(size_t count, unsigned int threadCount, Function function) const
+    {
+        std::atomic<size_t> next{0};
+        auto worker = [&]()
+        {
+            WitnessSearch search;
+            for (size_t index = next++; index < count; index = next++)
+            {
+                function(index, search);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (unsigned int i = 1; i < std::min<size_t>(threadCount, count); ++i)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    /**
+     * @brief Add arc or lower weight of the existing one. Out arcs of the last source are indexed by target,
+     * so arcs and shortcuts that come in runs from one vertex are inserted in O(1).
+     * Call _forgetPositions before arcs are changed in other ways
+     */
+    static void _insertArc(Contraction &contraction, VertexId from, VertexId to, uint32_t weight, VertexId middle)
+    {
+        if (contraction.indexedFrom != from)
+        {
+            _forgetPositions(contraction);
+            contraction.indexedFrom = from;
+            for (uint32_t position = 0; position < contraction.out[from].size(); ++position)
+            {
+                contraction.outPosition[contraction.out[from][position].target] = position;
+            }
+        }
+        // Only the cheapest arc between two vertices is kept, so unpacking can find arcs by their ends
+        const uint32_t position = contraction.outPosition[to];
+        if (position != NO_POSITION)
+        {
+            Arc &arc = contraction.out[from][position];
+            if (weight < arc.weight)
+            {
+                arc.weight = weight;
+                arc.middle = middle;
+                for (Arc &reverse : contraction.in[to])
+                {
+                    if (reverse.target == from)
+                    {
+                        reverse.weight = weight;
+                        reverse.middle = middle;
+                    }
+                }
+            }
+            return;
+        }
+        contraction.outPosition[to] = contraction.out[from].size();
+        contraction.out[from].push_back(Arc{to, weight, middle});
+        contraction.in[to].push_back(Arc{from, weight, middle});
+    }
+
+    static void _forgetPositions(Contraction &contraction)
+    {
+        if (contraction.indexedFrom != CsrGraph::NO_VERTEX)
+        {
+            for (const Arc &arc : contraction.out[contraction.indexedFrom])
+            {
+                contraction.outPosition[arc.target] = NO_POSITION;
+            }
+            contraction.indexedFrom = CsrGraph::NO_VERTEX;
+        }
+    }
+
+    static void _eraseArc(std::vector<Arc> &arcs, VertexId target)
+    {
+        arcs.erase(std::remove_if(arcs.begin(), arcs.end(), [target](const Arc &arc)
+                                  { return arc.target == target; }),
+                   arcs.end());
+    }
+
+    static bool _isLocalMinimum(const Contraction &contraction, VertexId v)
+    {
+        const auto key = std::make_pair(contraction.priority[v], v);
+        for (const auto *arcs : {&contraction.out[v], &contraction.in[v]})
+        {
+            for (const Arc &arc : *arcs)
+            {
+                if (contraction.state[arc.target] != CONTRACTED &&
+                    std::make_pair(contraction.priority[arc.target], arc.target) < key)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Simulate contraction of v and return its priority: doubled edge difference plus contracted neighbours.
+     * Shortcuts are collected if requested
+     */
+    int64_t _priority(const Contraction &contraction, VertexId v, WitnessSearch &search, std::vector<Shortcut> *shortcuts) const
+    {
+        if (search.distance.size() != contraction.out.size())
+        {
+            search.distance.assign(contraction.out.size(), NO_PATH);
+            search.hops.assign(contraction.out.size(), 0);
+            search.isTarget.assign(contraction.out.size(), 0);
+        }
+        int64_t removedArcs = 0;
+        int64_t addedArcs = 0;
+        for (const Arc &inArc : contraction.in[v])
+        {
+            if (contraction.state[inArc.target] != ACTIVE)
+            {
+                continue;
+            }
+            ++removedArcs;
+            uint64_t maxWeight = 0;
+            uint32_t targetCount = 0;
+            for (const Arc &outArc : contraction.out[v])
+            {
+                if (contraction.state[outArc.target] == ACTIVE && outArc.target != inArc.target)
+                {
+                    maxWeight = std::max<uint64_t>(maxWeight, uint64_t(inArc.weight) + outArc.weight);
+                    targetCount += !search.isTarget[outArc.target];
+                    search.isTarget[outArc.target] = 1;
+                }
+            }
+            if (targetCount == 0)
+            {
+                continue;
+            }
+            _witnessSearch(contraction, inArc.target, v, maxWeight, targetCount, shortcuts ? NO_HOP_LIMIT : PRIORITY_HOP_LIMIT, search);
+            for (const Arc &outArc : contraction.out[v])
+            {
+                const uint64_t weight = uint64_t(inArc.weight) + outArc.weight;
+                if (contraction.state[outArc.target] == ACTIVE && outArc.target != inArc.target &&
+                    search.distance[outArc.target] > weight)
+                {
+                    ++addedArcs;
+                    if (shortcuts)
+                    {
+                        shortcuts->push_back(Shortcut{inArc.target, outArc.target, static_cast<uint32_t>(std::min<uint64_t>(weight, UINT32_MAX))});
+                    }
+                }
+            }
+            for (const VertexId touched : search.touched)
+            {
+                search.distance[touched] = NO_PATH;
+            }
+            search.touched.clear();
+            for (const Arc &outArc : contraction.out[v])
+            {
+                search.isTarget[outArc.target] = 0;
+            }
+        }
+        for (const Arc &outArc : contraction.out[v])
+        {
+            removedArcs += contraction.state[outArc.target] == ACTIVE;
+        }
+        return 2 * (addedArcs - removedArcs) + contraction.contractedNeighbors[v];
+    }
+
+    /**
+     * @brief Bounded Dijkstra from source over active vertices except the one being contracted.
+     * Stops when all targets are settled, after WITNESS_SETTLE_LIMIT vertices or past maxWeight,
+     * and doesn't go further than hopLimit arcs from source
+     */
+    static void _witnessSearch(const Contraction &contraction, VertexId source, VertexId excluded, uint64_t maxWeight,
+                               uint32_t targetCount, uint8_t hopLimit, WitnessSearch &search)
+    {
+        using Entry = std::pair<uint64_t, VertexId>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        search.distance[source] = 0;
+        search.hops[source] = 0;
+        search.touched.push_back(source);
+        open.push(Entry(0, source));
+        uint32_t settled = 0;
+        while (!open.empty() && settled < WITNESS_SETTLE_LIMIT)
+        {
+            const Entry entry = open.top();
+            open.pop();
+            if (entry.first > search.distance[entry.second])
+            {
+                continue;
+            }
+            if (entry.first > maxWeight)
+            {
+                break;
+            }
+            ++settled;
+            if (search.isTarget[entry.second] && --targetCount == 0)
+            {
+                break;
+            }
+            if (search.hops[entry.second] == hopLimit)
+            {
+                continue;
+            }
+            for (const Arc &arc : contraction.out[entry.second])
+            {
+                if (arc.target == excluded || contraction.state[arc.target] != ACTIVE)
+                {
+                    continue;
+                }
+                const uint64_t distance = entry.first + arc.weight;
+                if (distance < search.distance[arc.target])
+                {
+                    if (search.distance[arc.target] == NO_PATH)
+                    {
+                        search.touched.push_back(arc.target);
+                    }
+                    search.distance[arc.target] = distance;
+                    search.hops[arc.target] = search.hops[entry.second] + 1;
+                    open.push(Entry(distance, arc.target));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Ranks are a permutation of vertices
+     */
+    static bool _isValidRanks(const uint32_t *ranks, uint32_t vertexCount)
+    {
+        std::vector<uint8_t> isUsed(vertexCount, 0);
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            if (ranks[v] >= vertexCount || isUsed[ranks[v]])
+            {
+                return false;
+            }
+            isUsed[ranks[v]] = 1;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Offsets go from 0 to arcCount without going down, every arc goes to a higher vertex
+     * and its middle is an original edge or lower than the arc source
+     */
+    static bool _isValidUpwardArcs(const uint32_t *ranks, const uint32_t *offsets, const Arc *arcs, uint32_t vertexCount, uint32_t arcCount)
+    {
+        if (offsets[0] != 0 || offsets[vertexCount] != arcCount)
+        {
+            return false;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            if (offsets[v] > offsets[v + 1])
+            {
+                return false;
+            }
+            for (uint32_t index = offsets[v]; index < offsets[v + 1]; ++index)
+            {
+                const Arc &arc = arcs[index];
+                if (arc.target >= vertexCount || ranks[arc.target] <= ranks[v] ||
+                    (arc.middle != CsrGraph::NO_VERTEX && (arc.middle >= vertexCount || ranks[arc.middle] >= ranks[v])))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Arc from vertex a to vertex b, it is in upward graph of the lower of them.
+     * Missing half of a shortcut in a broken hierarchy is taken as original edge
+     */
+    const Arc &_findArc(VertexId a, VertexId b) const
+    {
+        const bool isForward = m_ranks[b] > m_ranks[a];
+        const VertexId lower = isForward ? a : b;
+        const VertexId other = isForward ? b : a;
+        const uint32_t *offsets = isForward ? m_forwardOffsets : m_backwardOffsets;
+        const Arc *arcs = isForward ? m_forwardArcs : m_backwardArcs;
+        for (uint32_t index = offsets[lower]; index < offsets[lower + 1]; ++index)
+        {
+            if (arcs[index].target == other)
+            {
+                return arcs[index];
+            }
+        }
+        static constexpr Arc NO_ARC{CsrGraph::NO_VERTEX, 0, CsrGraph::NO_VERTEX};
+        return NO_ARC;
+    }
+
+    /**
+     * @brief Append vertices of edge from -> to after 'from' with shortcuts replaced by original edges
+     */
+    void _unpack(VertexId from, VertexId to, VertexId middle, std::vector<VertexId> &path) const
+    {
+        struct Segment
+        {
+            VertexId from;
+            VertexId to;
+            VertexId middle;
+        };
+        // Top of the stack is the next segment in path order
+        std::vector<Segment> stack{{from, to, middle}};
+        while (!stack.empty())
+        {
+            const Segment segment = stack.back();
+            stack.pop_back();
+            if (segment.middle == CsrGraph::NO_VERTEX)
+            {
+                path.push_back(segment.to);
+                continue;
+            }
+            stack.push_back(Segment{segment.middle, segment.to, _findArc(segment.middle, segment.to).middle});
+            stack.push_back(Segment{segment.from, segment.middle, _findArc(segment.from, segment.middle).middle});
+        }
+    }
+
+    void _setViews(const uint32_t *ranks, const uint32_t *forwardOffsets, const Arc *forwardArcs,
+                   const uint32_t *backwardOffsets, const Arc *backwardArcs)
+    {
+        m_ranks = ranks;
+        m_forwardOffsets = forwardOffsets;
+        m_forwardArcs = forwardArcs;
+        m_backwardOffsets = backwardOffsets;
+        m_backwardArcs = backwardArcs;
+    }
+
+    void _reset()
+    {
+        m_snapshot.close();
+        m_header = Header();
+        _setViews(nullptr, nullptr, nullptr, nullptr, nullptr);
+    }
+
+    Header m_header;
+    uint64_t m_graphHash = 0;
+    Stats m_stats;
+
+    // Arrays used by queries. Point either to owned vectors after build or into snapshot after load
+    const uint32_t *m_ranks = nullptr;
+    const uint32_t *m_forwardOffsets = nullptr;
+    const Arc *m_forwardArcs = nullptr;
+    const uint32_t *m_backwardOffsets = nullptr;
+    const Arc *m_backwardArcs = nullptr;
+
+    std::vector<uint32_t> m_ownedRanks;
+    std::vector<uint32_t> m_ownedForwardOffsets;
+    std::vector<Arc> m_ownedForwardArcs;
+    std::vector<uint32_t> m_ownedBackwardOffsets;
+    std::vector<Arc> m_ownedBackwardArcs;
+
+    IndexSnapshot m_snapshot;
+};
@@ -0,0 +1,241 @@
+#pragma once
+#include <cfloat>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+#include "ReservationTable.hpp"
+#include "SpaceTimeNode.hpp"
+
+/**
+ * @brief Exact distance from every cell to the goal ignoring other agents.
+ * Computed once by backward Dijkstra with the same move costs as MapSearchNode
+ */
+class TrueDistanceHeuristic
+{
+public:
+    static std::vector<float> compute(int goalX, int goalY)
+    {
+        const ArrayMap &map = ArrayMap::getInstance();
+        const int width = map.getWidth();
+        std::vector<float> distances(static_cast<size_t>(width) * map.getHeight(), FLT_MAX);
+
+        using Entry = std::pair<float, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        distances[goalY * width + goalX] = 0.0f;
+        open.push(Entry(0.0f, goalY * width + goalX));
+        while (!open.empty())
+        {
+            const Entry entry = open.top();
+            open.pop();
+            const int cell = entry.second;
+            if (entry.first > distances[cell])
+            {
+                continue;
+            }
+            const int x = cell % width;
+            const int y = cell / width;
+            // Moves are symmetric so neighbours of cell are exactly cells that can move into it
+            unsigned int mask = map.getNeighborMask(x, y);
+            for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+            {
+                if (mask & 1)
+                {
+                    MapSearchNode from(x + ArrayMap::DIRECTION_DX[dir], y + ArrayMap::DIRECTION_DY[dir]);
+                    MapSearchNode to(x, y);
+                    const int fromCell = from.y * width + from.x;
+                    const float distance = entry.first + from.getCost(to);
+                    if (distance < distances[fromCell])
+                    {
+                        distances[fromCell] = distance;
+                        open.push(Entry(distance, fromCell));
+                    }
+                }
+            }
+        }
+        return distances;
+    }
+};
+
+/**
+ * @brief Windowed hierarchical cooperative A* (WHCA*). Agents are planned one by one in priority order
+ * for a limited time window, each agent reserves its space-time path so agents planned later avoid it.
+ * Plans are refreshed every replanInterval ticks
+ */
+class CooperativePlanner
+{
+public:
+    struct Stats
+    {
+        unsigned int ticks = 0;
+        unsigned int replans = 0;
+        unsigned int failedPlans = 0;
+        unsigned long long expandedNodes = 0;
+        double planningSeconds = 0.0;
+    };
+
+    CooperativePlanner(int window = 16, int replanInterval = 8)
+        : m_window(window),
+          m_replanInterval(std::max(1, std::min(replanInterval, window)))
+    {
+    }
+
+    /**
+     * @brief Add agent. Agents added earlier have higher priority in the first window
+     *
+     * @return Agent id
+     */
+    int addAgent(const MapSearchNode &start, const MapSearchNode &goal)
+    {
+        Agent agent;
+        agent.position = start;
+        agent.goal = goal;
+        const int goalCell = goal.y * ArrayMap::getInstance().getWidth() + goal.x;
+        auto cached = m_goalDistances.find(goalCell);
+        if (cached == m_goalDistances.end())
+        {
+            auto distances = std::make_shared<const std::vector<float>>(TrueDistanceHeuristic::compute(goal.x, goal.y));
+            cached = m_goalDistances.emplace(goalCell, distances).first;
+        }
+        agent.goalDistances = cached->second;
+        m_agents.push_back(agent);
+        m_needsReplan = true;
+        return m_agents.size() - 1;
+    }
+
+    /**
+     * @brief Move every agent one step along its plan, planning new window if needed
+     */
+    void tick()
+    {
+        if (m_needsReplan || m_time - m_planTime >= m_replanInterval)
+        {
+            _planWindow();
+        }
+        m_time++;
+        for (auto &agent : m_agents)
+        {
+            const size_t step = m_time - m_planTime;
+            if (step < agent.plan.size())
+            {
+                agent.position = MapSearchNode(agent.plan[step].x, agent.plan[step].y);
+            }
+        }
+        m_stats.ticks++;
+    }
+
+    const MapSearchNode &getPosition(int agent) const { return m_agents[agent].position; }
+
+    bool isArrived(int agent) const
+    {
+        return m_agents[agent].position.x == m_agents[agent].goal.x &&
+               m_agents[agent].position.y == m_agents[agent].goal.y;
+    }
+
+    bool isAllArrived() const
+    {
+        for (size_t i = 0; i < m_agents.size(); ++i)
+        {
+            if (!isArrived(i))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t getAgentCount() const { return m_agents.size(); }
+
+    int getTime() const { return m_time; }
+
+    /**
+     * @brief Number of distinct goals with precomputed true distance tables
+     */
+    size_t getHeuristicTableCount() const { return m_goalDistances.size(); }
+
+    const Stats &getStats() const { return m_stats; }
+
+private:
+    struct Agent
+    {
+        MapSearchNode position;
+        MapSearchNode goal;
+        std::shared_ptr<const std::vector<float>> goalDistances;
+        // Planned positions, plan[0] is position at m_planTime
+        std::vector<MapSearchNode> plan;
+    };
+
+    void _planWindow()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const int width = ArrayMap::getInstance().getWidth();
+        m_planTime = m_time;
+        m_needsReplan = false;
+        m_reservations.clear();
+        m_reservations.reserve(m_agents.size() * (m_window + 1));
+
+        // Current positions are taken by everybody before anyone plans
+        for (size_t i = 0; i < m_agents.size(); ++i)
+        {
+            m_reservations.reserve(m_agents[i].position.y * width + m_agents[i].position.x, m_time, i);
+        }
+
+        // Priorities rotate every window so no agent is blocked by the same higher priority agents forever
+        const size_t priorityShift = m_agents.empty() ? 0 : m_stats.replans % m_agents.size();
+        for (size_t order = 0; order < m_agents.size(); ++order)
+        {
+            const size_t i = (order + priorityShift) % m_agents.size();
+            Agent &agent = m_agents[i];
+            SpaceTimeContext context{&m_reservations, agent.goalDistances->data(), static_cast<int>(i), m_time + m_window};
+            SpaceTimeNode nodeStart(agent.position.x, agent.position.y, m_time, &context);
+            SpaceTimeNode nodeGoal(agent.goal.x, agent.goal.y, m_time + m_window, &context);
+
+            AStarSearch<SpaceTimeNode> astarsearch(nodeStart, nodeGoal);
+            const SearchState state = astarsearch.preformSearch();
+            m_stats.expandedNodes += astarsearch.getStepCount();
+
+            agent.plan.clear();
+            if (state == SearchState::SUCCEEDED)
+            {
+                for (const auto &node : astarsearch.linearizeSolution())
+                {
+                    agent.plan.push_back(MapSearchNode(node.x, node.y));
+                }
+            }
+            else
+            {
+                // Boxed in by agents with higher priority: stay and hope they pass by
+                agent.plan.assign(m_window + 1, agent.position);
+                m_stats.failedPlans++;
+            }
+            for (size_t step = 0; step < agent.plan.size(); ++step)
+            {
+                m_reservations.reserve(agent.plan[step].y * width + agent.plan[step].x, m_time + step, i);
+            }
+        }
+        m_stats.replans++;
+        m_stats.planningSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const int m_window;
+    const int m_replanInterval;
+
+    std::vector<Agent> m_agents;
+    // True distance tables are shared by agents with the same goal
+    std::unordered_map<int, std::shared_ptr<const std::vector<float>>> m_goalDistances;
+    ReservationTable m_reservations;
+
+    int m_time = 0;
+    int m_planTime = 0;
+    bool m_needsReplan = true;
+    Stats m_stats;
+};
@@ -0,0 +1,387 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "IndexSnapshot.hpp"
+
+/**
+ * @brief Directed weighted graph in compressed sparse row form for road network routing.
+ *
+ * Edges of vertex v are targets/weights in [offsets[v], offsets[v + 1]). Graph is imported from
+ * DIMACS shortest path challenge files (.gr and optional .co) and saved as IndexSnapshot, which is
+ * mapped back without parsing. Vertex and edge counts are limited to 32 bits
+ */
+class CsrGraph
+{
+public:
+    using VertexId = uint32_t;
+    static constexpr VertexId NO_VERTEX = UINT32_MAX;
+
+    enum class CoordinateKind : uint32_t
+    {
+        NONE,       // no coordinates, heuristic is zero
+        PLANAR,     // x and y in the same units, Euclidean distance
+        GEOGRAPHIC, // longitude and latitude in millionths of degree as in DIMACS .co, great-circle distance
+    };
+
+    struct Edge
+    {
+        VertexId from;
+        VertexId to;
+        uint32_t weight;
+    };
+
+    // Snapshot sections
+    static constexpr uint32_t SECTION_HEADER = IndexSnapshot::makeId('C', 'S', 'R', 'H');
+    static constexpr uint32_t SECTION_OFFSETS = IndexSnapshot::makeId('C', 'S', 'R', 'O');
+    static constexpr uint32_t SECTION_TARGETS = IndexSnapshot::makeId('C', 'S', 'R', 'T');
+    static constexpr uint32_t SECTION_WEIGHTS = IndexSnapshot::makeId('C', 'S', 'R', 'W');
+    static constexpr uint32_t SECTION_COORDINATES = IndexSnapshot::makeId('C', 'S', 'R', 'C');
+
+    CsrGraph() = default;
+    CsrGraph(CsrGraph const &) = delete;
+    void operator=(CsrGraph const &) = delete;
+
+    /**
+     * @brief Build graph from edge list. Coordinates are x, y pairs of each vertex or empty
+     */
+    void assign(uint32_t vertexCount, const std::vector<Edge> &edges, std::vector<int32_t> coordinates, CoordinateKind kind)
+    {
+        _reset();
+        m_header.vertexCount = vertexCount;
+        m_header.edgeCount = edges.size();
+
+        // Counting sort of edges by source vertex, order of edges of one vertex is kept
+        m_ownedOffsets.assign(vertexCount + 1, 0);
+        for (const auto &edge : edges)
+        {
+            m_ownedOffsets[edge.from + 1]++;
+        }
+        for (uint32_t v = 0; v < vertexCount; ++v)
+        {
+            m_ownedOffsets[v + 1] += m_ownedOffsets[v];
+        }
+        m_ownedTargets.resize(edges.size());
+        m_ownedWeights.resize(edges.size());
+        std::vector<uint32_t> fill(m_ownedOffsets.begin(), m_ownedOffsets.end() - 1);
+        for (const auto &edge : edges)
+        {
+            const uint32_t position = fill[edge.from]++;
+            m_ownedTargets[position] = edge.to;
+            m_ownedWeights[position] = edge.weight;
+        }
+
+        m_ownedCoordinates = std::move(coordinates);
+        m_header.coordinateKind = static_cast<uint32_t>(m_ownedCoordinates.size() == 2 * size_t(vertexCount) ? kind : CoordinateKind::NONE);
+        _setViews(m_ownedOffsets.data(), m_ownedTargets.data(), m_ownedWeights.data(), m_ownedCoordinates.data());
+        m_header.heuristicScale = _computeHeuristicScale();
+    }
+
+    /**
+     * @brief Import DIMACS graph. Lines are "p sp <n> <m>" and "a <from> <to> <weight>" with 1-based ids,
+     * coordinates are "v <id> <x> <y>". Coordinate stream may be null
+     *
+     * @return false If input is not valid, error describes the reason
+     */
+    bool loadDimacs(std::istream &graph, std::istream *coordinates, CoordinateKind kind, std::string &error)
+    {
+        uint64_t vertexCount = 0;
+        std::vector<Edge> edges;
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(graph, line))
+        {
+            ++lineNumber;
+            if (line.empty() || line[0] == 'c')
+            {
+                continue;
+            }
+            std::istringstream in(line);
+            char type;
+            in >> type;
+            if (type == 'p')
+            {
+                std::string format;
+                uint64_t edgeCount = 0;
+                if (!(in >> format >> vertexCount >> edgeCount) || vertexCount >= NO_VERTEX || edgeCount >= UINT32_MAX)
+                {
+                    error = "bad problem line " + std::to_string(lineNumber);
+                    return false;
+                }
+                edges.reserve(edgeCount);
+            }
+            else if (type == 'a')
+            {
+                uint64_t from, to, weight;
+                if (!(in >> from >> to >> weight) || from == 0 || to == 0 || from > vertexCount || to > vertexCount || weight > UINT32_MAX)
+                {
+                    error = "bad arc at line " + std::to_string(lineNumber);
+                    return false;
+                }
+                edges.push_back(Edge{static_cast<VertexId>(from - 1), static_cast<VertexId>(to - 1), static_cast<uint32_t>(weight)});
+            }
+        }
+        if (vertexCount == 0)
+        {
+            error = "graph has no problem line";
+            return false;
+        }
+        if (edges.size() >= UINT32_MAX)
+        {
+            error = "graph has too many arcs";
+            return false;
+        }
+
+        std::vector<int32_t> points;
+        if (coordinates)
+        {
+            points.assign(2 * vertexCount, 0);
+            lineNumber = 0;
+            while (std::getline(*coordinates, line))
+            {
+                ++lineNumber;
+                if (line.empty() || line[0] != 'v')
+                {
+                    continue;
+                }
+                std::istringstream in(line.substr(1));
+                uint64_t id;
+                int64_t x, y;
+                if (!(in >> id >> x >> y) || id == 0 || id > vertexCount)
+                {
+                    error = "bad coordinate at line " + std::to_string(lineNumber);
+                    return false;
+                }
+                points[2 * (id - 1)] = static_cast<int32_t>(x);
+                points[2 * (id - 1) + 1] = static_cast<int32_t>(y);
+            }
+        }
+        assign(vertexCount, edges, std::move(points), coordinates ? kind : CoordinateKind::NONE);
+        return true;
+    }
+
+    /**
+     * @brief Write graph as IndexSnapshot. Graph files are not tied to ArrayMap, so map hash is zero
+     */
+    bool save(const std::string &path, std::string &error) const
+    {
+        IndexSnapshot::Writer writer;
+        writer.addSection(SECTION_HEADER, &m_header, sizeof(m_header));
+        writer.addSection(SECTION_OFFSETS, m_offsets, sizeof(uint32_t) * (m_header.vertexCount + 1));
+        writer.addSection(SECTION_TARGETS, m_targets, sizeof(VertexId) * m_header.edgeCount);
+        writer.addSection(SECTION_WEIGHTS, m_weights, sizeof(uint32_t) * m_header.edgeCount);
+        if (_hasCoordinates())
+        {
+            writer.addSection(SECTION_COORDINATES, m_coordinates, sizeof(int32_t) * 2 * m_header.vertexCount);
+        }
+        return writer.write(path, 0, error);
+    }
+
+    /**
+     * @brief Map graph saved by save(). Arrays are used right from the mapping
+     */
+    bool load(const std::string &path, std::string &error)
+    {
+        _reset();
+        if (!m_snapshot.open(path, 0, error))
+        {
+            return false;
+        }
+        size_t size = 0;
+        const void *header = m_snapshot.getSection(SECTION_HEADER, size);
+        if (!header || size != sizeof(Header))
+        {
+            _reset();
+            error = path + " has no graph";
+            return false;
+        }
+        memcpy(&m_header, header, sizeof(Header));
+
+        size_t offsetsSize = 0, targetsSize = 0, weightsSize = 0, coordinatesSize = 0;
+        const auto *offsets = static_cast<const uint32_t *>(m_snapshot.getSection(SECTION_OFFSETS, offsetsSize));
+        const auto *targets = static_cast<const VertexId *>(m_snapshot.getSection(SECTION_TARGETS, targetsSize));
+        const auto *weights = static_cast<const uint32_t *>(m_snapshot.getSection(SECTION_WEIGHTS, weightsSize));
+        const auto *points = static_cast<const int32_t *>(m_snapshot.getSection(SECTION_COORDINATES, coordinatesSize));
+        const bool hasCoordinates = m_header.coordinateKind != static_cast<uint32_t>(CoordinateKind::NONE);
+        if (!offsets || offsetsSize != sizeof(uint32_t) * (m_header.vertexCount + 1) ||
+            targetsSize != sizeof(VertexId) * m_header.edgeCount || weightsSize != sizeof(uint32_t) * m_header.edgeCount ||
+            (hasCoordinates && coordinatesSize != sizeof(int32_t) * 2 * m_header.vertexCount) ||
+            offsets[m_header.vertexCount] != m_header.edgeCount)
+        {
+            _reset();
+            error = path + " has inconsistent graph arrays";
+            return false;
+        }
+        if (!_isValidStructure(offsets, targets))
+        {
+            _reset();
+            error = path + " has arcs out of graph bounds";
+            return false;
+        }
+        _setViews(offsets, targets, weights, points);
+        return true;
+    }
+
+    uint32_t getVertexCount() const { return m_header.vertexCount; }
+
+    uint32_t getEdgeCount() const { return m_header.edgeCount; }
+
+    CoordinateKind getCoordinateKind() const { return static_cast<CoordinateKind>(m_header.coordinateKind); }
+
+    // Edges of vertex are indices in [getEdgeBegin(v), getEdgeEnd(v))
+    uint32_t getEdgeBegin(VertexId vertex) const { return m_offsets[vertex]; }
+
+    uint32_t getEdgeEnd(VertexId vertex) const { return m_offsets[vertex + 1]; }
+
+    VertexId getTarget(uint32_t edge) const { return m_targets[edge]; }
+
+    uint32_t getWeight(uint32_t edge) const { return m_weights[edge]; }
+
+    /**
+     * @brief Checksum of vertices, edges and weights. Indices built for the graph keep it in their snapshot
+     */
+    uint64_t getContentHash() const
+    {
+        uint64_t hash = IndexSnapshot::checksum(m_offsets, sizeof(uint32_t) * (m_header.vertexCount + 1));
+        hash ^= IndexSnapshot::checksum(m_targets, sizeof(VertexId) * m_header.edgeCount) * 31;
+        hash ^= IndexSnapshot::checksum(m_weights, sizeof(uint32_t) * m_header.edgeCount) * 37;
+        return hash;
+    }
+
+    /**
+     * @brief Lower bound of path cost between two vertices. Geometric distance is scaled by the smallest
+     * weight per unit of distance over all edges, so estimate is admissible and consistent for any weights
+     */
+    float distanceEstimate(VertexId from, VertexId to) const
+    {
+        if (!_hasCoordinates())
+        {
+            return 0.0f;
+        }
+        return static_cast<float>(m_header.heuristicScale * _distance(from, to));
+    }
+
+private:
+    struct Header
+    {
+        uint32_t vertexCount = 0;
+        uint32_t edgeCount = 0;
+        uint32_t coordinateKind = 0;
+        uint32_t reserved = 0;
+        double heuristicScale = 0.0;
+    };
+
+    bool _hasCoordinates() const
+    {
+        return m_header.coordinateKind != static_cast<uint32_t>(CoordinateKind::NONE);
+    }
+
+    double _distance(VertexId from, VertexId to) const
+    {
+        const double x0 = m_coordinates[2 * from];
+        const double y0 = m_coordinates[2 * from + 1];
+        const double x1 = m_coordinates[2 * to];
+        const double y1 = m_coordinates[2 * to + 1];
+        if (getCoordinateKind() == CoordinateKind::PLANAR)
+        {
+            return std::hypot(x1 - x0, y1 - y0);
+        }
+        // Haversine distance in meters, coordinates are millionths of degree
+        static constexpr double EARTH_RADIUS = 6371000.0;
+        static constexpr double TO_RADIANS = 3.14159265358979323846 / 180.0 / 1e6;
+        const double sinLatitude = std::sin((y1 - y0) * TO_RADIANS / 2);
+        const double sinLongitude = std::sin((x1 - x0) * TO_RADIANS / 2);
+        const double a = sinLatitude * sinLatitude + std::cos(y0 * TO_RADIANS) * std::cos(y1 * TO_RADIANS) * sinLongitude * sinLongitude;
+        return 2 * EARTH_RADIUS * std::asin(std::min(1.0, std::sqrt(a)));
+    }
+
+    /**
+     * @brief Offsets start at 0 and never decrease, targets are existing vertices. Checksums can't tell it,
+     * a snapshot written by other code may be consistent but still index out of arrays in getSuccessors
+     */
+    bool _isValidStructure(const uint32_t *offsets, const VertexId *targets) const
+    {
+        if (offsets[0] != 0)
+        {
+            return false;
+        }
+        for (uint32_t v = 0; v < m_header.vertexCount; ++v)
+        {
+            if (offsets[v] > offsets[v + 1])
+            {
+                return false;
+            }
+        }
+        for (uint32_t edge = 0; edge < m_header.edgeCount; ++edge)
+        {
+            if (targets[edge] >= m_header.vertexCount)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double _computeHeuristicScale() const
+    {
+        if (!_hasCoordinates())
+        {
+            return 0.0;
+        }
+        double scale = DBL_MAX;
+        for (VertexId v = 0; v < m_header.vertexCount; ++v)
+        {
+            for (uint32_t edge = m_offsets[v]; edge < m_offsets[v + 1]; ++edge)
+            {
+                const double distance = _distance(v, m_targets[edge]);
+                if (distance > 0)
+                {
+                    scale = std::min(scale, m_weights[edge] / distance);
+                }
+            }
+        }
+        // Keep estimate below true cost after float rounding
+        return scale == DBL_MAX ? 0.0 : scale * (1.0 - 1e-6);
+    }
+
+    void _setViews(const uint32_t *offsets, const VertexId *targets, const uint32_t *weights, const int32_t *coordinates)
+    {
+        m_offsets = offsets;
+        m_targets = targets;
+        m_weights = weights;
+        m_coordinates = coordinates;
+    }
+
+    void _reset()
+    {
+        m_snapshot.close();
+        m_header = Header();
+        m_ownedOffsets.assign(1, 0);
+        m_ownedTargets.clear();
+        m_ownedWeights.clear();
+        m_ownedCoordinates.clear();
+        _setViews(m_ownedOffsets.data(), nullptr, nullptr, nullptr);
+    }
+
+    Header m_header;
+
+    // Arrays used by search. Point either to owned vectors or into snapshot after load
+    const uint32_t *m_offsets = nullptr;
+    const VertexId *m_targets = nullptr;
+    const uint32_t *m_weights = nullptr;
+    const int32_t *m_coordinates = nullptr;
+
+    std::vector<uint32_t> m_ownedOffsets{0};
+    std::vector<VertexId> m_ownedTargets;
+    std::vector<uint32_t> m_ownedWeights;
+    std::vector<int32_t> m_ownedCoordinates;
+
+    IndexSnapshot m_snapshot;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+
+#include "AStarSearch.hpp"
+#include "CsrGraph.hpp"
+
+/**
+ * @brief UserState for search on CsrGraph. Node is a vertex id, weight of the edge it was reached by
+ * and a pointer to the graph, successors are read straight from CSR arrays without any allocation
+ */
+class CsrGraphSearchNode
+{
+public:
+    CsrGraph::VertexId vertex;
+    uint32_t weight; // weight of the edge from the node this one was generated by
+    const CsrGraph *graph;
+
+    CsrGraphSearchNode() : vertex(CsrGraph::NO_VERTEX), weight(0), graph(nullptr) {}
+    CsrGraphSearchNode(CsrGraph::VertexId id, const CsrGraph *csrGraph) : vertex(id), weight(0), graph(csrGraph) {}
+
+    float goalDistanceEstimate(CsrGraphSearchNode &nodeGoal) const
+    {
+        return graph->distanceEstimate(vertex, nodeGoal.vertex);
+    }
+
+    bool isGoal(CsrGraphSearchNode &nodeGoal) const
+    {
+        return vertex == nodeGoal.vertex;
+    }
+
+    template <class AStarSearchT>
+    bool getSuccessors(AStarSearchT *astarsearch, CsrGraphSearchNode *parent_node)
+    {
+        const CsrGraph::VertexId parent = parent_node ? parent_node->vertex : CsrGraph::NO_VERTEX;
+        CsrGraphSearchNode NewNode(CsrGraph::NO_VERTEX, graph);
+        const uint32_t end = graph->getEdgeEnd(vertex);
+        for (uint32_t edge = graph->getEdgeBegin(vertex); edge < end; ++edge)
+        {
+            NewNode.vertex = graph->getTarget(edge);
+            NewNode.weight = graph->getWeight(edge);
+            if (NewNode.vertex != parent)
+            {
+                astarsearch->addSuccessor(NewNode);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Weight of the edge successor was generated by. Parallel edges give one successor each,
+     * the cheapest of them wins in the search
+     */
+    float getCost(CsrGraphSearchNode &successor) const
+    {
+        return static_cast<float>(successor.weight);
+    }
+
+    size_t getStateIndex() const { return vertex; }
+
+    bool isSameState(CsrGraphSearchNode &rhs) const
+    {
+        return vertex == rhs.vertex;
+    }
+};
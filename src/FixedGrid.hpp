@@ -0,0 +1,119 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "ArrayMap.hpp"
+
+/**
+ * @brief Grid with size known at compile time for targets where map dimensions are fixed.
+ *
+ * Cells are stored in std::array with one cell wide wall border around the map, so neighbours of
+ * any inside cell are valid indices and successors are generated without bounds checks.
+ * Index math and neighbour offsets are constexpr, so loops over directions unroll
+ *
+ * @tparam Width Width of the map without border
+ * @tparam Height Height of the map without border
+ * @tparam CellT Type of cell, holds the same weights as ArrayMap cells
+ */
+template <int Width, int Height, class CellT = uint8_t>
+class FixedGrid
+{
+public:
+    static_assert(Width > 0 && Height > 0, "grid must not be empty");
+
+    static constexpr int WIDTH = Width;
+    static constexpr int HEIGHT = Height;
+    static constexpr int STRIDE = Width + 2;
+    static constexpr int SIZE = STRIDE * (Height + 2);
+    static constexpr CellT EMPTY = static_cast<CellT>(ArrayMap::CellType::EMPTY_POS);
+    static constexpr CellT WALL = static_cast<CellT>(ArrayMap::CellType::WALL_POS);
+
+    // Index offsets of neighbours in the order of ArrayMap::DIRECTION_DX/DY
+    static constexpr std::array<int, ArrayMap::DIRECTION_COUNT> OFFSETS = {
+        -1, -STRIDE, 1, STRIDE, -STRIDE - 1, -STRIDE + 1, STRIDE + 1, STRIDE - 1};
+
+    /**
+     * @brief Grid of empty cells surrounded by walls
+     */
+    constexpr FixedGrid() : m_cells()
+    {
+        for (int index = 0; index < SIZE; ++index)
+        {
+            m_cells[index] = isInside(getX(index), getY(index)) ? EMPTY : WALL;
+        }
+    }
+
+    static constexpr int index(int x, int y)
+    {
+        return (y + 1) * STRIDE + x + 1;
+    }
+
+    static constexpr int getX(int index)
+    {
+        return index % STRIDE - 1;
+    }
+
+    static constexpr int getY(int index)
+    {
+        return index / STRIDE - 1;
+    }
+
+    static constexpr bool isInside(int x, int y)
+    {
+        return x >= 0 && x < Width && y >= 0 && y < Height;
+    }
+
+    /**
+     * @brief Cell by index. Border cells are walls, indices outside of border are not allowed
+     */
+    constexpr CellT getPoint(int index) const
+    {
+        return m_cells[index];
+    }
+
+    constexpr CellT getPoint(int x, int y) const
+    {
+        return m_cells[index(x, y)];
+    }
+
+    constexpr bool isPassable(int index) const
+    {
+        return m_cells[index] < WALL;
+    }
+
+    constexpr void setPoint(int x, int y, CellT value)
+    {
+        m_cells[index(x, y)] = value;
+    }
+
+    /**
+     * @brief Copy map of the same size, e.g. ArrayMap::getLogicalMap()
+     *
+     * @return false If map size is different from grid size
+     */
+    bool assign(const ArrayMap::ArrayT &map)
+    {
+        if (static_cast<int>(map.size()) != Height)
+        {
+            return false;
+        }
+        for (const auto &row : map)
+        {
+            if (static_cast<int>(row.size()) != Width)
+            {
+                return false;
+            }
+        }
+        for (int y = 0; y < Height; ++y)
+        {
+            for (int x = 0; x < Width; ++x)
+            {
+                setPoint(x, y, static_cast<CellT>(map[y][x]));
+            }
+        }
+        return true;
+    }
+
+private:
+    std::array<CellT, SIZE> m_cells;
+};
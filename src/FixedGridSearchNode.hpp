@@ -0,0 +1,91 @@
+#pragma once
+#include <algorithm>
+#include <cstdlib>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "FixedGrid.hpp"
+
+/**
+ * @brief UserState for search on FixedGrid. Moves, costs and order of successors are the same as in
+ * MapSearchNode, but node is a single cell index and connectivity is a template parameter,
+ * so the direction loop has constant trip count and no bounds checks
+ *
+ * @tparam GridT FixedGrid instantiation
+ * @tparam Connectivity Movement rule, diagonal moves don't cut corners as in ArrayMap
+ */
+template <class GridT, ArrayMap::Connectivity Connectivity = ArrayMap::Connectivity::FOUR>
+class FixedGridSearchNode
+{
+public:
+    static constexpr float DIAGONAL_COST = 1.41421356f;
+    static constexpr int DIRECTION_COUNT = Connectivity == ArrayMap::Connectivity::EIGHT ? 8 : 4;
+
+    int index;
+    const GridT *grid;
+
+    FixedGridSearchNode() : index(0), grid(nullptr) {}
+    FixedGridSearchNode(int x, int y, const GridT *fixedGrid) : index(GridT::index(x, y)), grid(fixedGrid) {}
+
+    int getX() const { return GridT::getX(index); }
+    int getY() const { return GridT::getY(index); }
+
+    float goalDistanceEstimate(FixedGridSearchNode &nodeGoal) const
+    {
+        const int dx = abs(getX() - nodeGoal.getX());
+        const int dy = abs(getY() - nodeGoal.getY());
+        if (Connectivity == ArrayMap::Connectivity::EIGHT)
+        {
+            return (dx + dy) + (DIAGONAL_COST - 2.0f) * std::min(dx, dy);
+        }
+        return dx + dy;
+    }
+
+    bool isGoal(FixedGridSearchNode &nodeGoal) const
+    {
+        return index == nodeGoal.index;
+    }
+
+    template <class AStarSearchT>
+    bool getSuccessors(AStarSearchT *astarsearch, FixedGridSearchNode *parent_node)
+    {
+        const int parentIndex = parent_node ? parent_node->index : -1;
+        FixedGridSearchNode NewNode;
+        NewNode.grid = grid;
+        for (int dir = 0; dir < DIRECTION_COUNT; ++dir)
+        {
+            const int neighbor = index + GridT::OFFSETS[dir];
+            bool isAllowed = grid->isPassable(neighbor) && neighbor != parentIndex;
+            if (dir >= 4)
+            {
+                // Diagonal i + 4 lies between orthogonal directions i and (i + 1) % 4
+                isAllowed = isAllowed && grid->isPassable(index + GridT::OFFSETS[dir - 4]) &&
+                            grid->isPassable(index + GridT::OFFSETS[(dir - 3) % 4]);
+            }
+            if (isAllowed)
+            {
+                NewNode.index = neighbor;
+                astarsearch->addSuccessor(NewNode);
+            }
+        }
+        return true;
+    }
+
+    float getCost(FixedGridSearchNode &successor) const
+    {
+        const float cost = static_cast<float>(grid->getPoint(index));
+        const int offset = successor.index - index;
+        if (offset != 1 && offset != -1 && offset != GridT::STRIDE && offset != -GridT::STRIDE)
+        {
+            return cost * DIAGONAL_COST;
+        }
+        return cost;
+    }
+
+    size_t getStateIndex() const { return index; }
+
+    bool isSameState(FixedGridSearchNode &rhs) const
+    {
+        return index == rhs.index;
+    }
+};
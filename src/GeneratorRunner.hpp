@@ -0,0 +1,176 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MapGenerator.hpp"
+#include "MapIO.hpp"
+
+/**
+ * @brief Command line tool that writes generated map and query set in formats accepted by batch mode
+ */
+class GeneratorRunner
+{
+public:
+    struct Options
+    {
+        MapGenerator::Kind kind = MapGenerator::Kind::RANDOM;
+        int width = 1024;
+        int height = 1024;
+        uint64_t seed = 1;
+        double density = 0.3;
+        size_t queryCount = 0;
+        std::string mapFile = "-"; // "-" means stdout
+        std::string queryFile;
+    };
+
+    static void printUsage(std::ostream &out, const char *program)
+    {
+        out << "Usage: " << program << " --generate [--kind random|maze|rooms|terrain] [--width N] [--height N]\n"
+            << "       [--seed N] [--density D] [--map-out <file>|-] [--queries N --queries-out <file>]\n"
+            << "  Terrain map is written as rows of cell weights, other kinds in MovingAI format\n";
+    }
+
+    /**
+     * @brief Parse command line arguments that follow --generate
+     *
+     * @return false If arguments are wrong, error describes the reason
+     */
+    static bool parseOptions(int argc, char *argv[], Options &options, std::string &error)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--generate")
+            {
+                continue;
+            }
+            else if (arg == "--kind" && hasValue)
+            {
+                const std::string kind = argv[++i];
+                if (kind == "random")
+                {
+                    options.kind = MapGenerator::Kind::RANDOM;
+                }
+                else if (kind == "maze")
+                {
+                    options.kind = MapGenerator::Kind::MAZE;
+                }
+                else if (kind == "rooms")
+                {
+                    options.kind = MapGenerator::Kind::ROOMS;
+                }
+                else if (kind == "terrain")
+                {
+                    options.kind = MapGenerator::Kind::TERRAIN;
+                }
+                else
+                {
+                    error = "unknown map kind " + kind;
+                    return false;
+                }
+            }
+            else if (arg == "--width" && hasValue)
+            {
+                options.width = atoi(argv[++i]);
+            }
+            else if (arg == "--height" && hasValue)
+            {
+                options.height = atoi(argv[++i]);
+            }
+            else if (arg == "--seed" && hasValue)
+            {
+                options.seed = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--density" && hasValue)
+            {
+                options.density = atof(argv[++i]);
+            }
+            else if (arg == "--map-out" && hasValue)
+            {
+                options.mapFile = argv[++i];
+            }
+            else if (arg == "--queries" && hasValue)
+            {
+                options.queryCount = strtoull(argv[++i], nullptr, 10);
+            }
+            else if (arg == "--queries-out" && hasValue)
+            {
+                options.queryFile = argv[++i];
+            }
+            else
+            {
+                error = "unknown or incomplete argument " + arg;
+                return false;
+            }
+        }
+        if (options.width <= 0 || options.height <= 0)
+        {
+            error = "map size must be positive";
+            return false;
+        }
+        if (options.queryCount > 0 && options.queryFile.empty())
+        {
+            error = "--queries needs --queries-out";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @return Process exit code
+     */
+    static int run(const Options &options)
+    {
+        MapGenerator generator(options.seed);
+        const auto generationStart = std::chrono::steady_clock::now();
+        const ArrayMap::ArrayT map = generator.generate(options.kind, options.width, options.height, options.density);
+        const std::vector<MapGenerator::Query> queries = generator.queries(map, options.queryCount);
+        const double generationSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - generationStart).count();
+
+        std::ofstream mapFile;
+        if (options.mapFile != "-")
+        {
+            mapFile.open(options.mapFile);
+            if (!mapFile)
+            {
+                std::cerr << "Failed to open " << options.mapFile << std::endl;
+                return 1;
+            }
+        }
+        std::ostream &mapStream = options.mapFile == "-" ? std::cout : mapFile;
+        if (options.kind == MapGenerator::Kind::TERRAIN)
+        {
+            MapIO::saveRows(mapStream, map);
+        }
+        else
+        {
+            MapIO::saveMovingAI(mapStream, map);
+        }
+
+        if (!options.queryFile.empty())
+        {
+            std::ofstream queryStream(options.queryFile);
+            if (!queryStream)
+            {
+                std::cerr << "Failed to open " << options.queryFile << std::endl;
+                return 1;
+            }
+            std::string output;
+            for (const auto &query : queries)
+            {
+                output += std::to_string(query.startX) + ' ' + std::to_string(query.startY) + ' ' +
+                          std::to_string(query.goalX) + ' ' + std::to_string(query.goalY) + '\n';
+            }
+            queryStream << output;
+        }
+        std::cerr << "Generated " << options.width << "x" << options.height << " map and " << queries.size()
+                  << " queries in " << generationSeconds << " s" << std::endl;
+        return 0;
+    }
+};
@@ -0,0 +1,178 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+
+/**
+ * @brief Set of goal cells of a map. Membership is a flag per cell, goals are also kept in square buckets,
+ * so distance to the nearest goal visits only buckets that can hold something closer than found so far
+ */
+class GoalSet
+{
+public:
+    static constexpr int BUCKET_SIZE = 16;
+
+    GoalSet(int width, int height)
+        : m_width(width), m_height(height),
+          m_bucketColumns((width + BUCKET_SIZE - 1) / BUCKET_SIZE),
+          m_bucketRows((height + BUCKET_SIZE - 1) / BUCKET_SIZE),
+          m_isGoal(static_cast<size_t>(width) * height, 0),
+          m_buckets(static_cast<size_t>(m_bucketColumns) * m_bucketRows)
+    {
+    }
+
+    /**
+     * @brief Add goal cell
+     *
+     * @return false If cell is outside of the map or is already a goal
+     */
+    bool add(int x, int y)
+    {
+        if (!_isInside(x, y) || m_isGoal[_index(x, y)])
+        {
+            return false;
+        }
+        m_isGoal[_index(x, y)] = 1;
+        m_buckets[_bucket(x, y)].push_back(_index(x, y));
+        ++m_size;
+        return true;
+    }
+
+    bool remove(int x, int y)
+    {
+        if (!contains(x, y))
+        {
+            return false;
+        }
+        m_isGoal[_index(x, y)] = 0;
+        std::vector<uint32_t> &bucket = m_buckets[_bucket(x, y)];
+        *std::find(bucket.begin(), bucket.end(), _index(x, y)) = bucket.back();
+        bucket.pop_back();
+        --m_size;
+        return true;
+    }
+
+    bool contains(int x, int y) const
+    {
+        return _isInside(x, y) && m_isGoal[_index(x, y)];
+    }
+
+    size_t size() const { return m_size; }
+
+    bool empty() const { return m_size == 0; }
+
+    /**
+     * @brief Minimum of MapSearchNode heuristic over all goals, 0 for empty set.
+     * Buckets are visited in rings around the cell until ring can't hold a closer goal
+     */
+    float getNearestEstimate(int x, int y) const
+    {
+        if (m_size == 0)
+        {
+            return 0.0f;
+        }
+        const int bucketX = std::clamp(x, 0, m_width - 1) / BUCKET_SIZE;
+        const int bucketY = std::clamp(y, 0, m_height - 1) / BUCKET_SIZE;
+        const int maxRing = std::max({bucketX, bucketY, m_bucketColumns - 1 - bucketX, m_bucketRows - 1 - bucketY});
+        float best = FLT_MAX;
+        for (int ring = 0; ring <= maxRing; ++ring)
+        {
+            // Any cell of the ring is at least that far along one axis and heuristic is never less than max(dx, dy)
+            if (ring > 0 && static_cast<float>((ring - 1) * BUCKET_SIZE + 1) >= best)
+            {
+                break;
+            }
+            for (int by = bucketY - ring; by <= bucketY + ring; ++by)
+            {
+                if (by < 0 || by >= m_bucketRows)
+                {
+                    continue;
+                }
+                // Inner rows of the ring have only two buckets
+                const int step = (by == bucketY - ring || by == bucketY + ring) ? 1 : std::max(1, 2 * ring);
+                for (int bx = bucketX - ring; bx <= bucketX + ring; bx += step)
+                {
+                    if (bx >= 0 && bx < m_bucketColumns)
+                    {
+                        best = std::min(best, _bucketNearest(bx, by, x, y, best));
+                    }
+                }
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief Check by connected components that any goal can be reached from the cell
+     */
+    bool isReachableFrom(int x, int y) const
+    {
+        const ArrayMap &map = ArrayMap::getInstance();
+        for (const auto &bucket : m_buckets)
+        {
+            for (const uint32_t goal : bucket)
+            {
+                const int goalX = goal % m_width;
+                const int goalY = goal / m_width;
+                if ((goalX == x && goalY == y) || map.isConnected(x, y, goalX, goalY))
+                {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    bool _isInside(int x, int y) const
+    {
+        return x >= 0 && x < m_width && y >= 0 && y < m_height;
+    }
+
+    uint32_t _index(int x, int y) const
+    {
+        return static_cast<uint32_t>(y) * m_width + x;
+    }
+
+    size_t _bucket(int x, int y) const
+    {
+        return static_cast<size_t>(y / BUCKET_SIZE) * m_bucketColumns + x / BUCKET_SIZE;
+    }
+
+    float _bucketNearest(int bx, int by, int x, int y, float best) const
+    {
+        const std::vector<uint32_t> &bucket = m_buckets[static_cast<size_t>(by) * m_bucketColumns + bx];
+        if (bucket.empty())
+        {
+            return best;
+        }
+        // Lower bound by distance to the bucket rectangle
+        const int left = bx * BUCKET_SIZE;
+        const int top = by * BUCKET_SIZE;
+        const int dx = std::max({0, left - x, x - (left + BUCKET_SIZE - 1)});
+        const int dy = std::max({0, top - y, y - (top + BUCKET_SIZE - 1)});
+        if (MapSearchNode::distanceEstimate(dx, dy) >= best)
+        {
+            return best;
+        }
+        for (const uint32_t goal : bucket)
+        {
+            best = std::min(best, MapSearchNode::distanceEstimate(abs(static_cast<int>(goal % m_width) - x),
+                                                                  abs(static_cast<int>(goal / m_width) - y)));
+        }
+        return best;
+    }
+
+    int m_width;
+    int m_height;
+    int m_bucketColumns;
+    int m_bucketRows;
+    size_t m_size = 0;
+    std::vector<uint8_t> m_isGoal;
+    std::vector<std::vector<uint32_t>> m_buckets;
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+/**
+ * @brief Lock free histogram of non-negative values with power of two buckets.
+ * Bucket 0 counts zeros, bucket i counts values in [2^(i-1), 2^i). Percentiles are reported as bucket upper bound
+ */
+class Histogram
+{
+public:
+    static constexpr int BUCKET_COUNT = 65;
+
+    void record(uint64_t value)
+    {
+        m_buckets[_bucket(value)].fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t max = m_max.load(std::memory_order_relaxed);
+        while (max < value && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t getCount() const
+    {
+        uint64_t count = 0;
+        for (const auto &bucket : m_buckets)
+        {
+            count += bucket.load(std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    uint64_t getMax() const { return m_max.load(std::memory_order_relaxed); }
+
+    double getMean() const
+    {
+        const uint64_t count = getCount();
+        return count > 0 ? static_cast<double>(m_sum.load(std::memory_order_relaxed)) / count : 0.0;
+    }
+
+    /**
+     * @brief Smallest bucket bound that is not less than p of recorded values, capped by max value
+     */
+    uint64_t getPercentile(double p) const
+    {
+        const uint64_t count = getCount();
+        if (count == 0)
+        {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * count + 0.5));
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKET_COUNT; ++i)
+        {
+            seen += m_buckets[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+            {
+                return std::min(_upperBound(i), getMax());
+            }
+        }
+        return getMax();
+    }
+
+    /**
+     * @brief One line with percentiles followed by one line of non-empty buckets
+     */
+    void print(std::ostream &out, const char *name) const
+    {
+        char line[256];
+        snprintf(line, sizeof(line), "%s: count %llu, mean %.1f, p50 %llu, p90 %llu, p99 %llu, max %llu\n  ", name,
+                 static_cast<unsigned long long>(getCount()), getMean(), static_cast<unsigned long long>(getPercentile(0.5)),
+                 static_cast<unsigned long long>(getPercentile(0.9)), static_cast<unsigned long long>(getPercentile(0.99)),
+                 static_cast<unsigned long long>(getMax()));
+        out << line;
+        for (int i = 0; i < BUCKET_COUNT; ++i)
+        {
+            const uint64_t count = m_buckets[i].load(std::memory_order_relaxed);
+            if (count > 0)
+            {
+                snprintf(line, sizeof(line), "[%llu..%llu] %llu  ", static_cast<unsigned long long>(i == 0 ? 0 : _upperBound(i - 1) + 1),
+                         static_cast<unsigned long long>(_upperBound(i)), static_cast<unsigned long long>(count));
+                out << line;
+            }
+        }
+        out << "\n";
+    }
+
+    void clear()
+    {
+        for (auto &bucket : m_buckets)
+        {
+            bucket = 0;
+        }
+        m_sum = 0;
+        m_max = 0;
+    }
+
+private:
+    static int _bucket(uint64_t value)
+    {
+        int bucket = 0;
+        while (value != 0)
+        {
+            value >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    // Largest value of bucket
+    static uint64_t _upperBound(int bucket)
+    {
+        return bucket >= 64 ? UINT64_MAX : (uint64_t(1) << bucket) - 1;
+    }
+
+    std::atomic<uint64_t> m_buckets[BUCKET_COUNT] = {};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
@@ -0,0 +1,270 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @brief Versioned file of precomputed search indices, so they are mapped at startup instead of rebuilt.
+ *
+ * File is a header, a table of sections and the sections themselves, each aligned to SECTION_ALIGNMENT.
+ * Header holds hash of map content the indices were built for (see ArrayMap::getContentHash) and
+ * every section has its own checksum. Snapshot that doesn't match the map or fails any check is
+ * rejected by open(), and the owner of the index is expected to rebuild it
+ */
+class IndexSnapshot
+{
+public:
+    static constexpr char MAGIC[8] = {'A', 'S', 'S', 'N', 'A', 'P', '\0', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t SECTION_ALIGNMENT = 64;
+
+    /**
+     * @brief Section id from four characters, e.g. makeId('C', 'P', 'D', 'R')
+     */
+    static constexpr uint32_t makeId(char a, char b, char c, char d)
+    {
+        return uint32_t(uint8_t(a)) | uint32_t(uint8_t(b)) << 8 | uint32_t(uint8_t(c)) << 16 | uint32_t(uint8_t(d)) << 24;
+    }
+
+    /**
+     * @brief Collects sections and writes them to file. Section data is not copied and must stay alive until write()
+     */
+    class Writer
+    {
+    public:
+        void addSection(uint32_t id, const void *data, size_t size)
+        {
+            m_sections.push_back(PendingSection{id, data, size});
+        }
+
+        /**
+         * @brief Write snapshot to temporary file and rename it, so readers never see half written file
+         */
+        bool write(const std::string &path, uint64_t mapHash, std::string &error) const
+        {
+            Header header;
+            memcpy(header.magic, MAGIC, sizeof(MAGIC));
+            header.version = VERSION;
+            header.sectionCount = m_sections.size();
+            header.mapHash = mapHash;
+
+            std::vector<SectionEntry> table;
+            uint64_t offset = _align(sizeof(Header) + m_sections.size() * sizeof(SectionEntry));
+            for (const auto &section : m_sections)
+            {
+                // Empty sections point at the start, a trailing one would point past the file end
+                uint64_t sectionOffset = section.size ? offset : 0;
+                table.push_back(SectionEntry{section.id, 0, sectionOffset, section.size, checksum(section.data, section.size)});
+                offset = _align(offset + section.size);
+            }
+            header.tableChecksum = checksum(table.data(), table.size() * sizeof(SectionEntry));
+
+            const std::string temporaryPath = path + ".tmp";
+            FILE *file = fopen(temporaryPath.c_str(), "wb");
+            if (!file)
+            {
+                error = "can't open " + temporaryPath + " for writing";
+                return false;
+            }
+            bool isOk = fwrite(&header, sizeof(header), 1, file) == 1;
+            isOk = isOk && fwrite(table.data(), sizeof(SectionEntry), table.size(), file) == table.size();
+            for (size_t i = 0; i < m_sections.size() && isOk; ++i)
+            {
+                isOk = fseek(file, table[i].offset, SEEK_SET) == 0 &&
+                       fwrite(m_sections[i].data, 1, m_sections[i].size, file) == m_sections[i].size;
+            }
+            isOk = (fclose(file) == 0) && isOk;
+            if (!isOk || rename(temporaryPath.c_str(), path.c_str()) != 0)
+            {
+                std::remove(temporaryPath.c_str());
+                error = "failed to write " + path;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        struct PendingSection
+        {
+            uint32_t id;
+            const void *data;
+            size_t size;
+        };
+
+        std::vector<PendingSection> m_sections;
+    };
+
+    IndexSnapshot() = default;
+    IndexSnapshot(IndexSnapshot const &) = delete;
+    void operator=(IndexSnapshot const &) = delete;
+
+    ~IndexSnapshot()
+    {
+        close();
+    }
+
+    /**
+     * @brief Map snapshot file and validate it against hash of current map
+     *
+     * @return false If file is missing, broken, of other version or was built for other map
+     */
+    bool open(const std::string &path, uint64_t mapHash, std::string &error)
+    {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(Header))
+        {
+            ::close(fd);
+            error = path + " is too small";
+            return false;
+        }
+        void *data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            error = "mmap of " + path + " failed";
+            return false;
+        }
+        m_data = static_cast<const uint8_t *>(data);
+        m_size = fileStat.st_size;
+
+        const Header *header = reinterpret_cast<const Header *>(m_data);
+        const size_t tableSize = static_cast<size_t>(header->sectionCount) * sizeof(SectionEntry);
+        if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->version != VERSION ||
+            tableSize > m_size - sizeof(Header))
+        {
+            close();
+            error = path + " is not a valid snapshot of version " + std::to_string(VERSION);
+            return false;
+        }
+        if (header->mapHash != mapHash)
+        {
+            close();
+            error = path + " was built for other map";
+            return false;
+        }
+        const SectionEntry *table = reinterpret_cast<const SectionEntry *>(m_data + sizeof(Header));
+        if (checksum(table, tableSize) != header->tableChecksum)
+        {
+            close();
+            error = path + " has broken section table";
+            return false;
+        }
+        for (uint32_t i = 0; i < header->sectionCount; ++i)
+        {
+            const SectionEntry &section = table[i];
+            if (section.offset > m_size || section.size > m_size - section.offset ||
+                checksum(m_data + section.offset, section.size) != section.checksum)
+            {
+                close();
+                error = path + " has broken section " + std::to_string(i);
+                return false;
+            }
+        }
+        m_table = table;
+        m_sectionCount = header->sectionCount;
+        return true;
+    }
+
+    void close()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t *>(m_data), m_size);
+        }
+        m_data = nullptr;
+        m_size = 0;
+        m_table = nullptr;
+        m_sectionCount = 0;
+    }
+
+    bool isOpen() const
+    {
+        return m_data != nullptr;
+    }
+
+    /**
+     * @brief Mapped data of section, valid until snapshot is closed
+     *
+     * @return nullptr If there is no such section
+     */
+    const void *getSection(uint32_t id, size_t &size) const
+    {
+        for (uint32_t i = 0; i < m_sectionCount; ++i)
+        {
+            if (m_table[i].id == id)
+            {
+                size = m_table[i].size;
+                return m_data + m_table[i].offset;
+            }
+        }
+        size = 0;
+        return nullptr;
+    }
+
+    /**
+     * @brief 64-bit checksum, eight bytes per step
+     */
+    static uint64_t checksum(const void *data, size_t size)
+    {
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, sizeof(word));
+            hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+            hash ^= hash >> 32;
+        }
+        uint64_t tail = 0;
+        if (size > i)
+        {
+            memcpy(&tail, bytes + i, size - i);
+        }
+        hash = (hash ^ tail) * 0xC4CEB9FE1A85EC53ull;
+        return hash ^ (hash >> 29);
+    }
+
+private:
+    struct Header
+    {
+        char magic[8] = {0};
+        uint32_t version = 0;
+        uint32_t sectionCount = 0;
+        uint64_t mapHash = 0;
+        uint64_t tableChecksum = 0;
+    };
+
+    struct SectionEntry
+    {
+        uint32_t id;
+        uint32_t reserved;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    static uint64_t _align(uint64_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+    const SectionEntry *m_table = nullptr;
+    uint32_t m_sectionCount = 0;
+};
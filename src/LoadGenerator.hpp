@@ -0,0 +1,202 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchRunner.hpp"
+#include "Histogram.hpp"
+#include "PathClient.hpp"
+
+/**
+ * @brief Command line tool that measures PathServer throughput: every connection keeps up to depth queries
+ * in flight and reports round trip latency histogram
+ */
+class LoadGenerator
+{
+public:
+    struct Options
+    {
+        std::string socketPath;
+        std::string queryFile = "-"; // "-" means stdin
+        unsigned int connections = 1;
+        unsigned int depth = 16; // queries in flight on one connection
+        unsigned int repeat = 1; // times every connection sends whole query set
+    };
+
+    static void printUsage(std::ostream &out, const char *program)
+    {
+        out << "Usage: " << program << " --load --socket <path> [--queries <file>|-] [--connections N] [--depth N] [--repeat N]\n";
+    }
+
+    /**
+     * @brief Parse command line arguments that follow --load
+     *
+     * @return false If arguments are wrong, error describes the reason
+     */
+    static bool parseOptions(int argc, char *argv[], Options &options, std::string &error)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--load")
+            {
+                continue;
+            }
+            else if (arg == "--socket" && hasValue)
+            {
+                options.socketPath = argv[++i];
+            }
+            else if (arg == "--queries" && hasValue)
+            {
+                options.queryFile = argv[++i];
+            }
+            else if (arg == "--connections" && hasValue)
+            {
+                options.connections = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--depth" && hasValue)
+            {
+                options.depth = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--repeat" && hasValue)
+            {
+                options.repeat = std::max(1, atoi(argv[++i]));
+            }
+            else
+            {
+                error = "unknown or incomplete argument " + arg;
+                return false;
+            }
+        }
+        if (options.socketPath.empty())
+        {
+            error = "socket path is required";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Run load and print summary to stderr
+     *
+     * @return Process exit code
+     */
+    static int run(const Options &options)
+    {
+        std::vector<BatchRunner::Query> queries;
+        if (options.queryFile == "-")
+        {
+            BatchRunner::readQueries(std::cin, queries);
+        }
+        else
+        {
+            std::ifstream queryStream(options.queryFile);
+            if (!queryStream)
+            {
+                std::cerr << "Failed to open query file " << options.queryFile << std::endl;
+                return 1;
+            }
+            BatchRunner::readQueries(queryStream, queries);
+        }
+        if (queries.empty())
+        {
+            std::cerr << "No queries to send" << std::endl;
+            return 1;
+        }
+
+        Histogram latency;
+        std::atomic<uint64_t> failed{0};
+        std::atomic<bool> isBroken{false};
+        std::vector<std::thread> connections;
+        const auto loadStart = std::chrono::steady_clock::now();
+        for (unsigned int i = 0; i < options.connections; ++i)
+        {
+            connections.emplace_back([&]()
+                                     {
+                                         if (!_runConnection(options, queries, latency, failed))
+                                         {
+                                             isBroken = true;
+                                         } });
+        }
+        for (auto &connection : connections)
+        {
+            connection.join();
+        }
+        const double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+        if (isBroken)
+        {
+            std::cerr << "Connection to " << options.socketPath << " failed" << std::endl;
+            return 1;
+        }
+
+        char summary[256];
+        snprintf(summary, sizeof(summary), "queries %llu, connections %u, depth %u, total %.3f s, throughput %.1f queries/s, not succeeded %llu\n",
+                 static_cast<unsigned long long>(latency.getCount()), options.connections, options.depth, totalSeconds,
+                 totalSeconds > 0 ? latency.getCount() / totalSeconds : 0.0, static_cast<unsigned long long>(failed.load()));
+        std::cerr << summary;
+        latency.print(std::cerr, "round trip us");
+        return 0;
+    }
+
+private:
+    /**
+     * @brief Send query set repeat times keeping depth queries in flight. Query id is its index in the stream
+     */
+    static bool _runConnection(const Options &options, const std::vector<BatchRunner::Query> &queries, Histogram &latency, std::atomic<uint64_t> &failed)
+    {
+        PathClient client;
+        std::string error;
+        if (!client.connect(options.socketPath, error))
+        {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        const size_t total = queries.size() * options.repeat;
+        std::vector<std::chrono::steady_clock::time_point> sent(total);
+        size_t sentCount = 0;
+        size_t receivedCount = 0;
+        auto sendNext = [&]()
+        {
+            BatchRunner::Query query = queries[sentCount % queries.size()];
+            query.id = static_cast<uint32_t>(sentCount);
+            sent[sentCount++] = std::chrono::steady_clock::now();
+            return client.send(query);
+        };
+
+        while (sentCount < std::min<size_t>(options.depth, total))
+        {
+            if (!sendNext())
+            {
+                return false;
+            }
+        }
+        BatchRunner::Result result;
+        while (receivedCount < total)
+        {
+            if (!client.receive(result) || result.id >= sentCount)
+            {
+                return false;
+            }
+            latency.record(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent[result.id]).count());
+            if (result.state != 'S')
+            {
+                failed++;
+            }
+            receivedCount++;
+            if (sentCount < total && !sendNext())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
@@ -0,0 +1,322 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "ArrayMap.hpp"
+
+/**
+ * @brief Seeded generator of maps and query sets for tests and benchmarks.
+ *
+ * Own splitmix64 generator is used instead of std distributions, which differ between standard
+ * libraries, so the same seed gives the same map everywhere
+ */
+class MapGenerator
+{
+public:
+    enum class Kind
+    {
+        RANDOM,  // independent obstacles with given density
+        MAZE,    // perfect maze of 1 cell corridors made by recursive backtracker
+        ROOMS,   // rectangular rooms joined by corridors
+        TERRAIN, // no walls, cell weights from smooth value noise
+    };
+
+    struct Query
+    {
+        int startX;
+        int startY;
+        int goalX;
+        int goalY;
+    };
+
+    static constexpr int EMPTY = static_cast<int>(ArrayMap::CellType::EMPTY_POS);
+    static constexpr int WALL = static_cast<int>(ArrayMap::CellType::WALL_POS);
+    // Terrain weights are in [EMPTY, MAX_WEIGHT], right below wall
+    static constexpr int MAX_WEIGHT = WALL - 1;
+
+    explicit MapGenerator(uint64_t seed) : m_state(seed) {}
+
+    /**
+     * @brief Generate map of given kind. Density is used by RANDOM only
+     */
+    ArrayMap::ArrayT generate(Kind kind, int width, int height, double density = 0.3)
+    {
+        switch (kind)
+        {
+        case Kind::MAZE:
+            return maze(width, height);
+        case Kind::ROOMS:
+            return rooms(width, height);
+        case Kind::TERRAIN:
+            return terrain(width, height);
+        default:
+            return randomObstacles(width, height, density);
+        }
+    }
+
+    ArrayMap::ArrayT randomObstacles(int width, int height, double density)
+    {
+        ArrayMap::ArrayT map(height, std::vector<int>(width, EMPTY));
+        const uint64_t threshold = static_cast<uint64_t>(std::min(std::max(density, 0.0), 1.0) * 4294967296.0);
+        for (auto &row : map)
+        {
+            for (auto &cell : row)
+            {
+                if ((_next() >> 32) < threshold)
+                {
+                    cell = WALL;
+                }
+            }
+        }
+        return map;
+    }
+
+    /**
+     * @brief Maze cells are at odd coordinates, walls between them are removed by depth-first walk
+     */
+    ArrayMap::ArrayT maze(int width, int height)
+    {
+        ArrayMap::ArrayT map(height, std::vector<int>(width, WALL));
+        const int cellsX = (width - 1) / 2;
+        const int cellsY = (height - 1) / 2;
+        if (cellsX <= 0 || cellsY <= 0)
+        {
+            return map;
+        }
+        std::vector<uint8_t> visited(static_cast<size_t>(cellsX) * cellsY, 0);
+        std::vector<int> stack;
+        const int first = _uniform(cellsX * cellsY);
+        stack.push_back(first);
+        visited[first] = 1;
+        map[2 * (first / cellsX) + 1][2 * (first % cellsX) + 1] = EMPTY;
+        while (!stack.empty())
+        {
+            const int cell = stack.back();
+            const int x = cell % cellsX;
+            const int y = cell / cellsX;
+            int candidates[4];
+            int candidateCount = 0;
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                const int nx = x + ArrayMap::DIRECTION_DX[dir];
+                const int ny = y + ArrayMap::DIRECTION_DY[dir];
+                if (nx >= 0 && nx < cellsX && ny >= 0 && ny < cellsY && !visited[ny * cellsX + nx])
+                {
+                    candidates[candidateCount++] = dir;
+                }
+            }
+            if (candidateCount == 0)
+            {
+                stack.pop_back();
+                continue;
+            }
+            const int dir = candidates[_uniform(candidateCount)];
+            const int nx = x + ArrayMap::DIRECTION_DX[dir];
+            const int ny = y + ArrayMap::DIRECTION_DY[dir];
+            visited[ny * cellsX + nx] = 1;
+            map[2 * y + 1 + ArrayMap::DIRECTION_DY[dir]][2 * x + 1 + ArrayMap::DIRECTION_DX[dir]] = EMPTY;
+            map[2 * ny + 1][2 * nx + 1] = EMPTY;
+            stack.push_back(ny * cellsX + nx);
+        }
+        return map;
+    }
+
+    /**
+     * @brief One room per 400 cells, every room is joined to the previous one by L-shaped corridor
+     */
+    ArrayMap::ArrayT rooms(int width, int height)
+    {
+        ArrayMap::ArrayT map(height, std::vector<int>(width, WALL));
+        if (width < 3 || height < 3)
+        {
+            return map;
+        }
+        const int roomCount = std::max(1, width * height / 400);
+        int previousX = -1;
+        int previousY = -1;
+        for (int room = 0; room < roomCount; ++room)
+        {
+            const int roomWidth = std::min(width - 2, 4 + _uniform(13));
+            const int roomHeight = std::min(height - 2, 4 + _uniform(13));
+            const int left = 1 + _uniform(width - 1 - roomWidth);
+            const int top = 1 + _uniform(height - 1 - roomHeight);
+            for (int y = top; y < top + roomHeight; ++y)
+            {
+                std::fill(map[y].begin() + left, map[y].begin() + left + roomWidth, EMPTY);
+            }
+            const int centerX = left + roomWidth / 2;
+            const int centerY = top + roomHeight / 2;
+            if (previousX >= 0)
+            {
+                // Horizontal leg first or vertical leg first, chosen at random
+                const int cornerX = _uniform(2) ? centerX : previousX;
+                const int cornerY = cornerX == centerX ? previousY : centerY;
+                _carveLine(map, previousX, previousY, cornerX, cornerY);
+                _carveLine(map, cornerX, cornerY, centerX, centerY);
+            }
+            previousX = centerX;
+            previousY = centerY;
+        }
+        return map;
+    }
+
+    /**
+     * @brief Sum of three octaves of bilinear value noise mapped to weights EMPTY..MAX_WEIGHT
+     */
+    ArrayMap::ArrayT terrain(int width, int height)
+    {
+        ArrayMap::ArrayT map(height, std::vector<int>(width, EMPTY));
+        static constexpr int OCTAVE_COUNT = 3;
+        static constexpr int PERIODS[OCTAVE_COUNT] = {64, 16, 4};
+        static constexpr int AMPLITUDES[OCTAVE_COUNT] = {4, 2, 1};
+        std::vector<float> noise(static_cast<size_t>(width) * height, 0.0f);
+        int amplitudeSum = 0;
+        for (int octave = 0; octave < OCTAVE_COUNT; ++octave)
+        {
+            const int period = PERIODS[octave];
+            const int latticeWidth = width / period + 2;
+            const int latticeHeight = height / period + 2;
+            std::vector<float> lattice(static_cast<size_t>(latticeWidth) * latticeHeight);
+            for (auto &value : lattice)
+            {
+                value = (_next() >> 40) / 16777216.0f;
+            }
+            amplitudeSum += AMPLITUDES[octave];
+            for (int y = 0; y < height; ++y)
+            {
+                const int ly = y / period;
+                const float fy = float(y % period) / period;
+                const float *top = &lattice[ly * latticeWidth];
+                const float *bottom = top + latticeWidth;
+                float *out = &noise[static_cast<size_t>(y) * width];
+                for (int x = 0; x < width; ++x)
+                {
+                    const int lx = x / period;
+                    const float fx = float(x % period) / period;
+                    const float upper = top[lx] + (top[lx + 1] - top[lx]) * fx;
+                    const float lower = bottom[lx] + (bottom[lx + 1] - bottom[lx]) * fx;
+                    out[x] += AMPLITUDES[octave] * (upper + (lower - upper) * fy);
+                }
+            }
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            for (int x = 0; x < width; ++x)
+            {
+                const float value = noise[static_cast<size_t>(y) * width + x] / amplitudeSum;
+                map[y][x] = std::min(MAX_WEIGHT, EMPTY + static_cast<int>(value * (MAX_WEIGHT - EMPTY + 1)));
+            }
+        }
+        return map;
+    }
+
+    /**
+     * @brief Queries between random passable cells of the same connected component, so every query has a solution.
+     * Cells are bucketed by component once, then each query is O(1)
+     */
+    std::vector<Query> queries(const ArrayMap::ArrayT &map, size_t count)
+    {
+        std::vector<Query> result;
+        const int height = map.size();
+        const int width = height > 0 ? map.front().size() : 0;
+        std::vector<int> component(static_cast<size_t>(width) * height, -1);
+        std::vector<int> componentSize;
+        std::vector<int> stack;
+        for (int cell = 0; cell < width * height; ++cell)
+        {
+            if (component[cell] >= 0 || map[cell / width][cell % width] >= WALL)
+            {
+                continue;
+            }
+            const int label = componentSize.size();
+            componentSize.push_back(0);
+            component[cell] = label;
+            stack.push_back(cell);
+            while (!stack.empty())
+            {
+                const int current = stack.back();
+                stack.pop_back();
+                componentSize[label]++;
+                const int x = current % width;
+                const int y = current / width;
+                for (int dir = 0; dir < 4; ++dir)
+                {
+                    const int nx = x + ArrayMap::DIRECTION_DX[dir];
+                    const int ny = y + ArrayMap::DIRECTION_DY[dir];
+                    if (nx >= 0 && nx < width && ny >= 0 && ny < height && map[ny][nx] < WALL && component[ny * width + nx] < 0)
+                    {
+                        component[ny * width + nx] = label;
+                        stack.push_back(ny * width + nx);
+                    }
+                }
+            }
+        }
+        if (componentSize.empty())
+        {
+            return result;
+        }
+
+        // Counting sort of passable cells by component
+        std::vector<int> componentStart(componentSize.size() + 1, 0);
+        for (size_t label = 0; label < componentSize.size(); ++label)
+        {
+            componentStart[label + 1] = componentStart[label] + componentSize[label];
+        }
+        std::vector<int> cells(componentStart.back());
+        std::vector<int> fill(componentStart.begin(), componentStart.end() - 1);
+        for (int cell = 0; cell < width * height; ++cell)
+        {
+            if (component[cell] >= 0)
+            {
+                cells[fill[component[cell]]++] = cell;
+            }
+        }
+
+        result.reserve(count);
+        while (result.size() < count)
+        {
+            // Start is uniform over passable cells, so big components get most of the queries
+            const int start = cells[_uniform(cells.size())];
+            const int label = component[start];
+            const int goal = cells[componentStart[label] + _uniform(componentSize[label])];
+            result.push_back(Query{start % width, start / width, goal % width, goal / width});
+        }
+        return result;
+    }
+
+private:
+    uint64_t _next()
+    {
+        // splitmix64
+        uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * @brief Value in [0, bound) without modulo bias worth caring about for bound below 2^32
+     */
+    int _uniform(uint64_t bound)
+    {
+        return static_cast<int>(((_next() >> 32) * bound) >> 32);
+    }
+
+    static void _carveLine(ArrayMap::ArrayT &map, int x0, int y0, int x1, int y1)
+    {
+        const int dx = (x1 > x0) - (x1 < x0);
+        const int dy = (y1 > y0) - (y1 < y0);
+        for (int x = x0, y = y0;; x += dx, y += dy)
+        {
+            map[y][x] = EMPTY;
+            if (x == x1 && y == y1)
+            {
+                break;
+            }
+        }
+    }
+
+    uint64_t m_state;
+};
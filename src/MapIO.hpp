@@ -0,0 +1,151 @@
+#pragma once
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "ArrayMap.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Reading and writing maps from streams. Two formats are supported:
+ * - MovingAI benchmark format ("type octile" header, '.', 'G', 'S' are passable, everything else is wall)
+ * - Rows of whitespace separated cell values, the same as arrays in ArrayMap::reset()
+ */
+class MapIO
+{
+public:
+    /**
+     * @brief Load map from stream
+     *
+     * @return false If stream does not contain valid map, error describes the reason
+     */
+    static bool load(std::istream &in, ArrayMap::ArrayT &map, std::string &error)
+    {
+        ASTAR_TRACE_SPAN("map load");
+        map.clear();
+        std::string line;
+        while (std::getline(in, line) && line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+        }
+        if (!in)
+        {
+            error = "map is empty";
+            return false;
+        }
+        if (line.compare(0, 4, "type") == 0)
+        {
+            return _loadMovingAI(in, map, error);
+        }
+
+        do
+        {
+            std::istringstream row(line);
+            std::vector<int> cells;
+            int value;
+            while (row >> value)
+            {
+                cells.push_back(value);
+            }
+            if (cells.empty())
+            {
+                continue;
+            }
+            if (!map.empty() && cells.size() != map.front().size())
+            {
+                error = "row " + std::to_string(map.size() + 1) + " has " + std::to_string(cells.size()) +
+                        " cells instead of " + std::to_string(map.front().size());
+                return false;
+            }
+            map.push_back(std::move(cells));
+        } while (std::getline(in, line));
+        return true;
+    }
+
+    /**
+     * @brief Write map in MovingAI format. Cell weights other than wall and empty are lost
+     */
+    static void saveMovingAI(std::ostream &out, const ArrayMap::ArrayT &map)
+    {
+        const size_t width = map.empty() ? 0 : map.front().size();
+        out << "type octile\nheight " << map.size() << "\nwidth " << width << "\nmap\n";
+        std::string row;
+        for (const auto &cells : map)
+        {
+            row.clear();
+            for (int cell : cells)
+            {
+                row.push_back(cell < static_cast<int>(ArrayMap::CellType::WALL_POS) ? '.' : '@');
+            }
+            row.push_back('\n');
+            out << row;
+        }
+    }
+
+    /**
+     * @brief Write map as rows of cell values, keeps cell weights
+     */
+    static void saveRows(std::ostream &out, const ArrayMap::ArrayT &map)
+    {
+        std::string row;
+        for (const auto &cells : map)
+        {
+            row.clear();
+            for (size_t x = 0; x < cells.size(); ++x)
+            {
+                if (x > 0)
+                {
+                    row.push_back(' ');
+                }
+                row += std::to_string(cells[x]);
+            }
+            row.push_back('\n');
+            out << row;
+        }
+    }
+
+private:
+    static bool _loadMovingAI(std::istream &in, ArrayMap::ArrayT &map, std::string &error)
+    {
+        int height = -1;
+        int width = -1;
+        std::string key;
+        while (in >> key && key != "map")
+        {
+            if (key == "height")
+            {
+                in >> height;
+            }
+            else if (key == "width")
+            {
+                in >> width;
+            }
+        }
+        if (key != "map" || height <= 0 || width <= 0)
+        {
+            error = "broken MovingAI header";
+            return false;
+        }
+
+        map.assign(height, std::vector<int>(width, static_cast<int>(ArrayMap::CellType::WALL_POS)));
+        std::string line;
+        std::getline(in, line);
+        for (int y = 0; y < height; ++y)
+        {
+            if (!std::getline(in, line) || static_cast<int>(line.size()) < width)
+            {
+                error = "map row " + std::to_string(y + 1) + " is missing or too short";
+                return false;
+            }
+            for (int x = 0; x < width; ++x)
+            {
+                const char c = line[x];
+                if (c == '.' || c == 'G' || c == 'S')
+                {
+                    map[y][x] = static_cast<int>(ArrayMap::CellType::EMPTY_POS);
+                }
+            }
+        }
+        return true;
+    }
+};
@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <cstdlib>
+
 #include "AStarSearch.hpp"
 #include "ArrayMap.hpp"
 
@@ -8,6 +11,8 @@
 class MapSearchNode
 {
 public:
+    static constexpr float DIAGONAL_COST = 1.41421356f;
+
     int x; // the (x,y) positions of the node
     int y;
 
@@ -20,11 +25,23 @@ public:
 
     /**
      * @brief The heuristic function that estimates the distance from a Node
-     * to the Goal.
+     * to the Goal. Manhattan distance for 4-connected grid and octile distance for 8-connected one.
      */
     float goalDistanceEstimate(MapSearchNode &nodeGoal)
     {
-        return abs(x - nodeGoal.x) + abs(y - nodeGoal.y);
+        return distanceEstimate(abs(x - nodeGoal.x), abs(y - nodeGoal.y));
+    }
+
+    /**
+     * @brief Heuristic for absolute offsets. It is never less than max(dx, dy)
+     */
+    static float distanceEstimate(int dx, int dy)
+    {
+        if (ArrayMap::getInstance().getConnectivity() == ArrayMap::Connectivity::EIGHT)
+        {
+            return (dx + dy) + (DIAGONAL_COST - 2.0f) * std::min(dx, dy);
+        }
+        return dx + dy;
     }
 
     bool isGoal(MapSearchNode &nodeGoal) const
@@ -41,58 +58,58 @@ public:
     /**
      * @brief Function generates the successors to the given Node. It uses a helper function called
      * AddSuccessor to give the successors to the AStar class.
+     * Templated to work with AStarSearch with any cost type
      */
-    bool getSuccessors(AStarSearch<MapSearchNode> *astarsearch, MapSearchNode *parent_node)
+    template <class AStarSearchT>
+    bool getSuccessors(AStarSearchT *astarsearch, MapSearchNode *parent_node)
     {
-        int parent_x = -1;
-        int parent_y = -1;
+        ArrayMap &map = ArrayMap::getInstance();
+        unsigned int mask = map.getNeighborMask(x, y);
 
+        // push each possible move except allowing the search to go backwards
         if (parent_node)
         {
-            parent_x = parent_node->x;
-            parent_y = parent_node->y;
+            mask &= ~ArrayMap::directionBit(parent_node->x - x, parent_node->y - y);
         }
 
         MapSearchNode NewNode;
-
-        // push each possible move except allowing the search to go backwards
-
-        ArrayMap &map = ArrayMap::getInstance();
-
-        if ((map.getPoint(x - 1, y) < ArrayMap::CellType::WALL_POS) && !((parent_x == x - 1) && (parent_y == y)))
+        for (int dir = 0; mask != 0; ++dir, mask >>= 1)
         {
-            NewNode = MapSearchNode(x - 1, y);
-            astarsearch->addSuccessor(NewNode);
-        }
-
-        if ((map.getPoint(x, y - 1) < ArrayMap::CellType::WALL_POS) && !((parent_x == x) && (parent_y == y - 1)))
-        {
-            NewNode = MapSearchNode(x, y - 1);
-            astarsearch->addSuccessor(NewNode);
-        }
-
-        if ((map.getPoint(x + 1, y) < ArrayMap::CellType::WALL_POS) && !((parent_x == x + 1) && (parent_y == y)))
-        {
-            NewNode = MapSearchNode(x + 1, y);
-            astarsearch->addSuccessor(NewNode);
-        }
-
-        if ((map.getPoint(x, y + 1) < ArrayMap::CellType::WALL_POS) && !((parent_x == x) && (parent_y == y + 1)))
-        {
-            NewNode = MapSearchNode(x, y + 1);
-            astarsearch->addSuccessor(NewNode);
+            if (mask & 1)
+            {
+                NewNode = MapSearchNode(x + ArrayMap::DIRECTION_DX[dir], y + ArrayMap::DIRECTION_DY[dir]);
+                astarsearch->addSuccessor(NewNode);
+            }
         }
 
         return true;
     }
 
     /**
-     * @brief Returns the cost of movement for given node
+     * @brief Returns the cost of movement for given node. Diagonal moves cost sqrt(2) times more
      */
     float getCost(MapSearchNode &successor) const
     {
         ArrayMap &map = ArrayMap::getInstance();
-        return (float)map.getPoint(x, y);
+        const float cost = (float)map.getPoint(x, y);
+        if (successor.x != x && successor.y != y)
+        {
+            return cost * DIAGONAL_COST;
+        }
+        return cost;
+    }
+
+    /**
+     * @brief O(1) check by connected components of the map that search can reach goal at all
+     */
+    bool isReachable(MapSearchNode &nodeGoal) const
+    {
+        return (x == nodeGoal.x && y == nodeGoal.y) || ArrayMap::getInstance().isConnected(x, y, nodeGoal.x, nodeGoal.y);
+    }
+
+    size_t getStateIndex() const
+    {
+        return static_cast<size_t>(y) * ArrayMap::getInstance().getWidth() + x;
     }
 
     bool isSameState(MapSearchNode &rhs) const
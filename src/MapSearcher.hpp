@@ -1,11 +1,13 @@
 #pragma once
 #include <iostream>
+#include <thread>
 
 #include "AStarSearch.hpp"
 #include "ArrayMap.hpp"
 #include "SFML_Frontend.hpp"
 #include "ConsoleFrontend.hpp"
 #include "MapSearchNode.hpp"
+#include "SearchEventStream.hpp"
 
 /**
  * @brief Class that generates two random points on grid and starts A* search
@@ -13,6 +15,8 @@
 class MapSearcher
 {
 public:
+    static constexpr int MAX_CONSOLE_COLUMNS = 120;
+
     bool run()
     {
         ArrayMap &map = ArrayMap::getInstance();
@@ -22,11 +26,31 @@ public:
         // Define a start state
         MapSearchNode nodeStart = _generateRandomPoint();
         // Define the goal state
-        MapSearchNode nodeGoal = _generateRandomPoint();
+        MapSearchNode nodeGoal = _generateReachablePoint(nodeStart);
+
+        map.setCell(nodeStart.x, nodeStart.y, ArrayMap::CellType::START_POS);
+        map.setCell(nodeGoal.x, nodeGoal.y, ArrayMap::CellType::GOAL_POS);
 
         // Set Start and goal states
         AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        SearchEventStream eventStream;
+        astarsearch.setObserver(&eventStream);
+
+        // Renderer works in its own thread and only reads the view map, so view map
+        // must not be changed until the thread is joined
+        bool isShutDown = false;
+        std::thread renderThread([&]()
+                                 { isShutDown = prettyFrontend.liveDraw(map, eventStream); });
+
         SearchState searchResult = astarsearch.preformSearch();
+        renderThread.join();
+
+        if (eventStream.getDroppedCount() > 0)
+        {
+            std::cout << "Renderer dropped " << eventStream.getDroppedCount() << " of "
+                      << eventStream.getPublishedCount() << " search events\n";
+        }
+
         if (searchResult == SearchState::FAILED)
         {
             std::cout << "Search terminated. Did not find goal state" << std::endl;
@@ -56,11 +80,10 @@ public:
             // Display the number of loops the search went through
             std::cout << "Search Steps count " << astarsearch.getStepCount() << std::endl;
             std::cout << std::endl;
-            consoleFrontend.draw(map);
-            // prettyFrontend.instantDraw(map);
-            return prettyFrontend.stepByStepDraw(map, solutionNodes, visitedNodes);
+            // Big maps are shown as overview to fit in terminal
+            consoleFrontend.drawOverview(map, MAX_CONSOLE_COLUMNS);
         }
-        return false;
+        return isShutDown;
     }
 
     ~MapSearcher()
@@ -81,4 +104,26 @@ private:
         } while (map.getPoint(point.x, point.y) == ArrayMap::CellType::WALL_POS);
         return point;
     }
+
+    /**
+     * @brief Random cell of the same connected component as from, so the search always has a solution
+     */
+    MapSearchNode _generateReachablePoint(const MapSearchNode &from) const
+    {
+        ArrayMap &map = ArrayMap::getInstance();
+        const uint32_t component = map.getComponent(from.x, from.y);
+        // Index of cell in component is picked first, so small components don't need long rejection loop
+        uint32_t index = rand() % map.getComponentSize(from.x, from.y);
+        for (int y = 0; y < map.getHeight(); ++y)
+        {
+            for (int x = 0; x < map.getWidth(); ++x)
+            {
+                if (map.getComponent(x, y) == component && index-- == 0)
+                {
+                    return MapSearchNode(x, y);
+                }
+            }
+        }
+        return from;
+    }
 };
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "GoalSet.hpp"
+#include "MapSearchNode.hpp"
+
+/**
+ * @brief UserState for search from one cell to the nearest of many goal cells. Moves and costs are the same
+ * as in MapSearchNode. Goal state passed to AStarSearch only carries the GoalSet, heuristic is the distance
+ * to the nearest goal and search stops at the first goal popped from open list
+ */
+class MultiGoalSearchNode
+{
+public:
+    int x;
+    int y;
+    const GoalSet *goals;
+
+    /**
+     * @brief Path to one of the goals
+     */
+    struct GoalPath
+    {
+        int x;
+        int y;
+        float cost;
+        std::deque<MultiGoalSearchNode> path;
+    };
+
+    MultiGoalSearchNode() : x(0), y(0), goals(nullptr) {}
+    MultiGoalSearchNode(int px, int py, const GoalSet *goalSet) : x(px), y(py), goals(goalSet) {}
+    explicit MultiGoalSearchNode(const GoalSet *goalSet) : x(-1), y(-1), goals(goalSet) {}
+
+    float goalDistanceEstimate(MultiGoalSearchNode &nodeGoal) const
+    {
+        return nodeGoal.goals->getNearestEstimate(x, y);
+    }
+
+    bool isGoal(MultiGoalSearchNode &nodeGoal) const
+    {
+        return nodeGoal.goals->contains(x, y);
+    }
+
+    template <class AStarSearchT>
+    bool getSuccessors(AStarSearchT *astarsearch, MultiGoalSearchNode *parent_node)
+    {
+        ArrayMap &map = ArrayMap::getInstance();
+        unsigned int mask = map.getNeighborMask(x, y);
+        if (parent_node)
+        {
+            mask &= ~ArrayMap::directionBit(parent_node->x - x, parent_node->y - y);
+        }
+
+        MultiGoalSearchNode NewNode;
+        for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+        {
+            if (mask & 1)
+            {
+                NewNode = MultiGoalSearchNode(x + ArrayMap::DIRECTION_DX[dir], y + ArrayMap::DIRECTION_DY[dir], goals);
+                astarsearch->addSuccessor(NewNode);
+            }
+        }
+        return true;
+    }
+
+    float getCost(MultiGoalSearchNode &successor) const
+    {
+        const float cost = (float)ArrayMap::getInstance().getPoint(x, y);
+        if (successor.x != x && successor.y != y)
+        {
+            return cost * MapSearchNode::DIAGONAL_COST;
+        }
+        return cost;
+    }
+
+    bool isReachable(MultiGoalSearchNode &nodeGoal) const
+    {
+        return nodeGoal.goals->isReachableFrom(x, y);
+    }
+
+    size_t getStateIndex() const
+    {
+        return static_cast<size_t>(y) * ArrayMap::getInstance().getWidth() + x;
+    }
+
+    bool isSameState(MultiGoalSearchNode &rhs) const
+    {
+        return x == rhs.x && y == rhs.y;
+    }
+
+    /**
+     * @brief Paths to up to k nearest goals in order of cost, found by one search.
+     * Each found goal is taken out of the set and search is resumed, all goals are put back at the end
+     */
+    static std::vector<GoalPath> findNearest(int startX, int startY, GoalSet &goalSet, size_t k)
+    {
+        std::vector<GoalPath> found;
+        MultiGoalSearchNode nodeStart(startX, startY, &goalSet);
+        MultiGoalSearchNode nodeGoal(&goalSet);
+        AStarSearch<MultiGoalSearchNode> search(nodeStart, nodeGoal);
+        SearchState state = k > 0 ? search.preformSearch() : SearchState::FAILED;
+        while (state == SearchState::SUCCEEDED)
+        {
+            GoalPath goal;
+            goal.path = search.linearizeSolution();
+            goal.x = goal.path.back().x;
+            goal.y = goal.path.back().y;
+            goal.cost = search.getSolutionCost();
+            found.push_back(goal);
+            goalSet.remove(goal.x, goal.y);
+            if (found.size() == k || goalSet.empty())
+            {
+                break;
+            }
+            state = search.resumeSearch();
+        }
+        for (const GoalPath &goal : found)
+        {
+            goalSet.add(goal.x, goal.y);
+        }
+        return found;
+    }
+};
@@ -0,0 +1,353 @@
+#pragma once
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+#include "SpscRingBuffer.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Hash distributed A* (HDA*) for one query on ArrayMap. Every cell is owned by one thread
+ * chosen by hash of the cell. Owner keeps open list and g of its cells, successors of other owners
+ * are sent to them through lock-free single producer single consumer queues (one per pair of threads).
+ * Moves, costs and heuristic are the same as in MapSearchNode, so the solution cost is the same as AStarSearch finds
+ */
+class ParallelAStarSearch
+{
+public:
+    ParallelAStarSearch(const MapSearchNode &start, const MapSearchNode &goal, unsigned int threadCount)
+        : m_map(ArrayMap::getInstance()),
+          m_width(m_map.getWidth()),
+          m_start(start.y * m_width + start.x),
+          m_goal(goal.y * m_width + goal.x),
+          m_goalNode(goal),
+          m_threadCount(std::max(1u, threadCount))
+    {
+        const size_t cellCount = static_cast<size_t>(m_width) * m_map.getHeight();
+        m_g.assign(cellCount, FLT_MAX);
+        m_parent.assign(cellCount, -1);
+
+        m_workers.resize(m_threadCount);
+        for (auto &worker : m_workers)
+        {
+            worker.outbox.resize(m_threadCount);
+        }
+        for (unsigned int i = 0; i < m_threadCount * m_threadCount; ++i)
+        {
+            m_queues.emplace_back(new SpscRingBuffer<Message>(QUEUE_CAPACITY));
+        }
+    }
+
+    /**
+     * @brief Run search on threadCount threads, calling thread is one of them
+     */
+    SearchState preformSearch()
+    {
+        ASTAR_TRACE_SPAN("hda search");
+        if (m_start != m_goal && !m_map.isConnected(m_start % m_width, m_start / m_width, m_goalNode.x, m_goalNode.y))
+        {
+            m_state = SearchState::FAILED;
+            return m_state;
+        }
+        // Every thread starts active. Work counter is number of active threads plus messages in flight,
+        // search is over when it drops to zero
+        m_work = m_threadCount;
+        m_incumbent = FLT_MAX;
+        _insert(m_workers[_owner(m_start)], Message{m_start, m_start, 0.0f});
+
+        std::vector<std::thread> threads;
+        for (unsigned int id = 1; id < m_threadCount; ++id)
+        {
+            threads.emplace_back([this, id]()
+                                 { _run(id); });
+        }
+        _run(0);
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        m_state = m_incumbent.load() < FLT_MAX ? SearchState::SUCCEEDED : SearchState::FAILED;
+        return m_state;
+    }
+
+    deque<MapSearchNode> linearizeSolution() const
+    {
+        deque<MapSearchNode> solution;
+        if (m_state != SearchState::SUCCEEDED)
+        {
+            return solution;
+        }
+        for (int cell = m_goal;; cell = m_parent[cell])
+        {
+            solution.push_front(MapSearchNode(cell % m_width, cell / m_width));
+            if (cell == m_start)
+            {
+                break;
+            }
+        }
+        return solution;
+    }
+
+    float getSolutionCost() const
+    {
+        return m_state == SearchState::SUCCEEDED ? m_incumbent.load() : FLT_MAX;
+    }
+
+    /**
+     * @brief Get number of expanded nodes by all threads
+     */
+    unsigned int getStepCount() const
+    {
+        uint64_t expanded = 0;
+        for (const auto &worker : m_workers)
+        {
+            expanded += worker.expanded;
+        }
+        return expanded;
+    }
+
+    /**
+     * @brief Get number of nodes sent to other threads
+     */
+    uint64_t getMessageCount() const
+    {
+        uint64_t sent = 0;
+        for (const auto &worker : m_workers)
+        {
+            sent += worker.sent;
+        }
+        return sent;
+    }
+
+    unsigned int getThreadCount() const { return m_threadCount; }
+
+private:
+    static constexpr size_t QUEUE_CAPACITY = 4096;
+    // Nodes expanded between checks of incoming queues
+    static constexpr int EXPANSION_BATCH = 32;
+
+    struct Message
+    {
+        int cell;
+        int parent;
+        float g;
+    };
+
+    struct OpenEntry
+    {
+        float f;
+        float g;
+        int cell;
+
+        // Lower f first, ties broken in favour of bigger g (closer to goal)
+        bool operator<(const OpenEntry &rhs) const
+        {
+            return f > rhs.f || (f == rhs.f && g < rhs.g);
+        }
+    };
+
+    struct Worker
+    {
+        std::priority_queue<OpenEntry> open;
+        // Messages that did not fit into queue of receiver yet
+        std::vector<std::vector<Message>> outbox;
+        uint64_t expanded = 0;
+        uint64_t sent = 0;
+        // Keep workers of different threads on different cache lines
+        alignas(64) char padding[1];
+    };
+
+    unsigned int _owner(int cell) const
+    {
+        // Fibonacci hashing spreads neighbouring cells over threads
+        return static_cast<unsigned int>((static_cast<uint64_t>(static_cast<uint32_t>(cell) * 2654435769u) * m_threadCount) >> 32);
+    }
+
+    SpscRingBuffer<Message> &_queue(unsigned int from, unsigned int to)
+    {
+        return *m_queues[from * m_threadCount + to];
+    }
+
+    float _heuristic(int cell)
+    {
+        MapSearchNode node(cell % m_width, cell / m_width);
+        return node.goalDistanceEstimate(m_goalNode);
+    }
+
+    /**
+     * @brief Accept node into open list of its owner if it improves g and may improve incumbent
+     */
+    void _insert(Worker &worker, const Message &message)
+    {
+        if (message.g >= m_g[message.cell])
+        {
+            return;
+        }
+        const float f = message.g + _heuristic(message.cell);
+        if (f >= m_incumbent.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        m_g[message.cell] = message.g;
+        m_parent[message.cell] = message.parent;
+        worker.open.push(OpenEntry{f, message.g, message.cell});
+    }
+
+    void _send(Worker &worker, unsigned int id, const Message &message)
+    {
+        const unsigned int owner = _owner(message.cell);
+        if (owner == id)
+        {
+            _insert(worker, message);
+            return;
+        }
+        worker.sent++;
+        m_work.fetch_add(1, std::memory_order_acq_rel);
+        auto &outbox = worker.outbox[owner];
+        if (!outbox.empty() || !_queue(id, owner).tryPush(message))
+        {
+            outbox.push_back(message);
+        }
+    }
+
+    /**
+     * @brief Try to deliver postponed messages
+     *
+     * @return true If some messages are still waiting
+     */
+    bool _flush(Worker &worker, unsigned int id)
+    {
+        bool hasPending = false;
+        for (unsigned int owner = 0; owner < m_threadCount; ++owner)
+        {
+            auto &outbox = worker.outbox[owner];
+            size_t delivered = 0;
+            while (delivered < outbox.size() && _queue(id, owner).tryPush(outbox[delivered]))
+            {
+                delivered++;
+            }
+            outbox.erase(outbox.begin(), outbox.begin() + delivered);
+            hasPending = hasPending || !outbox.empty();
+        }
+        return hasPending;
+    }
+
+    void _updateIncumbent(float cost)
+    {
+        float current = m_incumbent.load();
+        while (cost < current && !m_incumbent.compare_exchange_weak(current, cost))
+        {
+        }
+    }
+
+    void _expand(Worker &worker, unsigned int id, int cell, float g)
+    {
+        worker.expanded++;
+        const int x = cell % m_width;
+        const int y = cell / m_width;
+        const float cellCost = static_cast<float>(m_map.getPoint(x, y));
+        unsigned int mask = m_map.getNeighborMask(x, y);
+        for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+        {
+            if (mask & 1)
+            {
+                const int dx = ArrayMap::DIRECTION_DX[dir];
+                const int dy = ArrayMap::DIRECTION_DY[dir];
+                // Same cost as MapSearchNode::getCost
+                const float cost = (dx != 0 && dy != 0) ? cellCost * MapSearchNode::DIAGONAL_COST : cellCost;
+                _send(worker, id, Message{cell + dy * m_width + dx, cell, g + cost});
+            }
+        }
+    }
+
+    void _run(unsigned int id)
+    {
+        Worker &worker = m_workers[id];
+        bool isActive = true;
+        while (true)
+        {
+            for (unsigned int from = 0; from < m_threadCount; ++from)
+            {
+                Message message;
+                while (_queue(from, id).tryPop(message))
+                {
+                    if (!isActive)
+                    {
+                        m_work.fetch_add(1, std::memory_order_acq_rel);
+                        isActive = true;
+                    }
+                    _insert(worker, message);
+                    // Message is consumed only after it is in open list, so work can't reach zero in between
+                    m_work.fetch_sub(1, std::memory_order_acq_rel);
+                }
+            }
+
+            if (!isActive)
+            {
+                if (m_work.load(std::memory_order_acquire) == 0)
+                {
+                    return;
+                }
+                std::this_thread::yield();
+                continue;
+            }
+
+            for (int i = 0; i < EXPANSION_BATCH && !worker.open.empty(); ++i)
+            {
+                const OpenEntry entry = worker.open.top();
+                if (entry.f >= m_incumbent.load(std::memory_order_relaxed))
+                {
+                    // Nothing in this open list can improve the solution any more
+                    worker.open = std::priority_queue<OpenEntry>();
+                    break;
+                }
+                worker.open.pop();
+                if (entry.g > m_g[entry.cell])
+                {
+                    continue;
+                }
+                if (entry.cell == m_goal)
+                {
+                    _updateIncumbent(entry.g);
+                    continue;
+                }
+                _expand(worker, id, entry.cell, entry.g);
+            }
+
+            const bool hasPending = _flush(worker, id);
+            if (worker.open.empty() && !hasPending)
+            {
+                isActive = false;
+                m_work.fetch_sub(1, std::memory_order_acq_rel);
+            }
+        }
+    }
+
+    const ArrayMap &m_map;
+    const int m_width;
+    const int m_start;
+    const int m_goal;
+    MapSearchNode m_goalNode;
+    const unsigned int m_threadCount;
+
+    // Per cell search data. Each cell is read and written only by its owner thread
+    std::vector<float> m_g;
+    std::vector<int> m_parent;
+
+    std::vector<Worker> m_workers;
+    std::vector<std::unique_ptr<SpscRingBuffer<Message>>> m_queues;
+    std::atomic<int64_t> m_work{0};
+    std::atomic<float> m_incumbent{FLT_MAX};
+    SearchState m_state = SearchState::SEARCHING;
+};
@@ -0,0 +1,122 @@
+#pragma once
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "BatchRunner.hpp"
+
+/**
+ * @brief Client of PathServer. Queries may be pipelined: send many and receive results as they come,
+ * results of one connection are matched to queries by id as the server may answer them out of order.
+ * Server stops reading queries of a connection whose results are not received, so a long pipeline
+ * has to be sent by one thread while other thread receives
+ */
+class PathClient
+{
+public:
+    PathClient() = default;
+    PathClient(const PathClient &) = delete;
+    PathClient &operator=(const PathClient &) = delete;
+    ~PathClient() { disconnect(); }
+
+    /**
+     * @brief Connect to server socket
+     *
+     * @return false If server is not running, error describes the reason
+     */
+    bool connect(const std::string &socketPath, std::string &error)
+    {
+        disconnect();
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+        {
+            error = "socket path is too long";
+            return false;
+        }
+        strcpy(address.sun_path, socketPath.c_str());
+        m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_fd < 0 || ::connect(m_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            error = "can't connect to " + socketPath + ": " + strerror(errno);
+            disconnect();
+            return false;
+        }
+        return true;
+    }
+
+    void disconnect()
+    {
+        if (m_fd >= 0)
+        {
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    bool isConnected() const { return m_fd >= 0; }
+
+    bool send(const BatchRunner::Query *queries, size_t count)
+    {
+        const char *data = reinterpret_cast<const char *>(queries);
+        size_t size = count * sizeof(BatchRunner::Query);
+        while (size > 0)
+        {
+            const ssize_t written = ::send(m_fd, data, size, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return false;
+            }
+            data += written;
+            size -= written;
+        }
+        return true;
+    }
+
+    bool send(const BatchRunner::Query &query) { return send(&query, 1); }
+
+    /**
+     * @brief Wait for next result of any query sent on this connection
+     *
+     * @return false If connection is closed
+     */
+    bool receive(BatchRunner::Result &result)
+    {
+        char *data = reinterpret_cast<char *>(&result);
+        size_t size = sizeof(result);
+        while (size > 0)
+        {
+            const ssize_t count = recv(m_fd, data, size, 0);
+            if (count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (count <= 0)
+            {
+                return false;
+            }
+            data += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Blocking query, must not be mixed with pipelined queries that are not received yet
+     */
+    bool query(const BatchRunner::Query &query, BatchRunner::Result &result)
+    {
+        return send(query) && receive(result);
+    }
+
+private:
+    int m_fd = -1;
+};
@@ -0,0 +1,568 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "BatchRunner.hpp"
+#include "Histogram.hpp"
+
+/**
+ * @brief Daemon mode: loads map once and answers path queries over Unix domain socket.
+ *
+ * Protocol is the one of batch mode --binary output: client writes BatchRunner::Query records (host byte order)
+ * and gets one packed BatchRunner::Result per query with the same id. Connections are pipelined, results of
+ * one connection may come in other order than queries. Queries of all connections are queued and taken by workers
+ * in batches of up to batchSize, a worker waits at most batchWaitMicros after the oldest query for batch to fill.
+ * Workers put results to outbox of the connection, its own thread writes them when socket is ready, so a client
+ * that doesn't read its results stalls only itself
+ */
+class PathServer
+{
+public:
+    struct Options
+    {
+        BatchRunner::Options search; // map, engine and worker threads, same as in batch mode
+        std::string socketPath;
+        size_t batchSize = 32;
+        unsigned int batchWaitMicros = 200;
+        unsigned int reportSeconds = 0; // period of stats report to stderr, 0 reports only on shutdown
+    };
+
+    // Readers stop taking queries from sockets while this many are waiting
+    static constexpr size_t MAX_QUEUE_SIZE = 1 << 16;
+    // Connection is not read while this many of its queries wait for results to be written
+    static constexpr size_t MAX_IN_FLIGHT = 1 << 10;
+
+    static_assert(sizeof(BatchRunner::Query) == 20, "Query record is part of socket protocol");
+    static_assert(sizeof(BatchRunner::Result) == 21, "Result record is part of socket protocol");
+
+    PathServer() = default;
+    PathServer(const PathServer &) = delete;
+    PathServer &operator=(const PathServer &) = delete;
+    ~PathServer() { stop(); }
+
+    static void printUsage(std::ostream &out, const char *program)
+    {
+        out << "Usage: " << program << " --serve --socket <path> --map <file> [--threads N] [--diagonal]\n"
+            << "       [--batch-size N] [--batch-wait-us N] [--report-seconds N] [engine options of --batch]\n"
+            << "  Stops on SIGINT or SIGTERM, queue depth and latency histograms go to stderr\n";
+    }
+
+    /**
+     * @brief Parse command line arguments that follow --serve, the rest is parsed as batch mode options
+     *
+     * @return false If arguments are wrong, error describes the reason
+     */
+    static bool parseOptions(int argc, char *argv[], Options &options, std::string &error)
+    {
+        std::vector<char *> searchArgs = {argv[0]};
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+            if (arg == "--serve")
+            {
+                continue;
+            }
+            else if (arg == "--socket" && hasValue)
+            {
+                options.socketPath = argv[++i];
+            }
+            else if (arg == "--batch-size" && hasValue)
+            {
+                options.batchSize = std::max(1, atoi(argv[++i]));
+            }
+            else if (arg == "--batch-wait-us" && hasValue)
+            {
+                options.batchWaitMicros = std::max(0, atoi(argv[++i]));
+            }
+            else if (arg == "--report-seconds" && hasValue)
+            {
+                options.reportSeconds = std::max(0, atoi(argv[++i]));
+            }
+            else
+            {
+                searchArgs.push_back(argv[i]);
+            }
+        }
+        if (options.socketPath.empty())
+        {
+            error = "socket path is required";
+            return false;
+        }
+        return BatchRunner::parseOptions(static_cast<int>(searchArgs.size()), searchArgs.data(), options.search, error);
+    }
+
+    /**
+     * @brief Serve until SIGINT or SIGTERM
+     *
+     * @return Process exit code
+     */
+    int run(const Options &options)
+    {
+        // Signals are taken by sigtimedwait below, worker threads inherit the mask
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        std::string error;
+        if (!start(options, error))
+        {
+            std::cerr << "Failed to start server: " << error << std::endl;
+            return 1;
+        }
+        std::cerr << "Serving " << options.search.mapFile << " on " << options.socketPath << std::endl;
+
+        const time_t period = options.reportSeconds > 0 ? options.reportSeconds : 3600;
+        while (true)
+        {
+            timespec timeout{period, 0};
+            const int signal = sigtimedwait(&signals, nullptr, &timeout);
+            if (signal == SIGINT || signal == SIGTERM)
+            {
+                break;
+            }
+            if (signal < 0 && errno == EAGAIN && options.reportSeconds > 0)
+            {
+                printStats(std::cerr);
+            }
+        }
+        stop();
+        printStats(std::cerr);
+        return 0;
+    }
+
+    /**
+     * @brief Load map, bind socket and start threads
+     *
+     * @return false If map can't be loaded or socket can't be bound
+     */
+    bool start(const Options &options, std::string &error)
+    {
+        if (m_listenFd >= 0)
+        {
+            error = "server is already running";
+            return false;
+        }
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.socketPath.size() >= sizeof(address.sun_path))
+        {
+            error = "socket path is too long";
+            return false;
+        }
+        strcpy(address.sun_path, options.socketPath.c_str());
+        if (!m_runner.prepare(options.search))
+        {
+            error = "can't prepare map " + options.search.mapFile;
+            return false;
+        }
+
+        // Socket left by killed server is replaced, other files are not touched
+        struct stat status;
+        if (lstat(options.socketPath.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+        {
+            unlink(options.socketPath.c_str());
+        }
+        m_listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listenFd < 0 || bind(m_listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(m_listenFd, SOMAXCONN) != 0)
+        {
+            error = "can't listen on " + options.socketPath + ": " + strerror(errno);
+            if (m_listenFd >= 0)
+            {
+                close(m_listenFd);
+                m_listenFd = -1;
+            }
+            return false;
+        }
+
+        m_options = options;
+        m_stopping = false;
+        m_closed = false;
+        m_isAnswered = false;
+        m_startTime = std::chrono::steady_clock::now();
+        m_servedCount = 0;
+        m_queueDepth.clear();
+        m_batchSizes.clear();
+        m_latency.clear();
+        m_acceptor = std::thread([this]()
+                                 { _acceptLoop(); });
+        for (unsigned int i = 0; i < options.search.threads; ++i)
+        {
+            m_workers.emplace_back([this]()
+                                   { _worker(); });
+        }
+        return true;
+    }
+
+    /**
+     * @brief Stop accepting queries, answer queued ones and join all threads
+     */
+    void stop()
+    {
+        if (m_listenFd < 0)
+        {
+            return;
+        }
+        m_stopping = true;
+        m_acceptor.join();
+        {
+            std::lock_guard<std::mutex> lock(m_queueMutex);
+            m_closed = true;
+            m_queueSpace.notify_all();
+            m_queueReady.notify_all();
+        }
+        for (auto &worker : m_workers)
+        {
+            worker.join();
+        }
+        // Connections write results that are left and close
+        m_isAnswered = true;
+        for (auto &reader : m_readers)
+        {
+            reader.thread.join();
+        }
+        m_readers.clear();
+        m_workers.clear();
+        close(m_listenFd);
+        m_listenFd = -1;
+        unlink(m_options.socketPath.c_str());
+    }
+
+    uint64_t getServedCount() const { return m_servedCount; }
+
+    /**
+     * @brief Queue depth seen by workers when taking a batch
+     */
+    const Histogram &getQueueDepth() const { return m_queueDepth; }
+    const Histogram &getBatchSizes() const { return m_batchSizes; }
+
+    /**
+     * @brief Microseconds from reading query out of socket to putting its result to connection outbox
+     */
+    const Histogram &getLatency() const { return m_latency; }
+
+    void printStats(std::ostream &out) const
+    {
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+        char line[128];
+        snprintf(line, sizeof(line), "served %llu queries in %.1f s, %.1f queries/s\n",
+                 static_cast<unsigned long long>(m_servedCount.load()), seconds, seconds > 0 ? m_servedCount / seconds : 0.0);
+        out << line;
+        m_queueDepth.print(out, "queue depth");
+        m_batchSizes.print(out, "batch size");
+        m_latency.print(out, "latency us");
+    }
+
+private:
+    struct Connection
+    {
+        explicit Connection(int socketFd) : fd(socketFd), wakeFd(eventfd(0, EFD_NONBLOCK)) {}
+        ~Connection()
+        {
+            close(fd);
+            close(wakeFd);
+        }
+
+        const int fd;
+        const int wakeFd; // signaled by workers when outbox becomes non-empty
+        std::mutex outboxMutex;
+        std::string outbox;                // results not taken for writing yet
+        std::atomic<bool> isClosed{false}; // set when connection thread is done with the socket
+    };
+
+    struct Reader
+    {
+        std::thread thread;
+        std::shared_ptr<Connection> connection;
+    };
+
+    // Queued query keeps its connection open until the result is put to outbox
+    struct Pending
+    {
+        BatchRunner::Query query;
+        std::shared_ptr<Connection> connection;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    void _acceptLoop()
+    {
+        pollfd listenPoll{m_listenFd, POLLIN, 0};
+        while (!m_stopping)
+        {
+            _joinClosedReaders();
+            if (poll(&listenPoll, 1, 100) <= 0)
+            {
+                continue;
+            }
+            const int fd = accept(m_listenFd, nullptr, nullptr);
+            if (fd < 0)
+            {
+                continue;
+            }
+            auto connection = std::make_shared<Connection>(fd);
+            if (connection->wakeFd < 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+            {
+                continue;
+            }
+            std::thread thread([this, connection]()
+                               { _connectionLoop(connection); });
+            m_readers.push_back(Reader{std::move(thread), connection});
+        }
+    }
+
+    // Socket of closed connection stays open until its queued queries are answered
+    void _joinClosedReaders()
+    {
+        for (auto reader = m_readers.begin(); reader != m_readers.end();)
+        {
+            if (reader->connection->isClosed)
+            {
+                reader->thread.join();
+                reader = m_readers.erase(reader);
+            }
+            else
+            {
+                ++reader;
+            }
+        }
+    }
+
+    /**
+     * @brief Read queries and write results of one connection with nonblocking socket. Queries are not read
+     * while MAX_IN_FLIGHT of them wait for results, so client that doesn't read results can't take all queue.
+     * Ends when client has closed the socket and every query read from it is answered, or when server stops
+     */
+    void _connectionLoop(std::shared_ptr<Connection> connection)
+    {
+        constexpr size_t QUERY_SIZE = sizeof(BatchRunner::Query);
+        char input[64 * QUERY_SIZE];
+        size_t inputSize = 0;    // bytes of incomplete query at input start
+        uint64_t readCount = 0;  // queries read
+        uint64_t writtenBytes = 0;
+        std::string output;      // results taken from outbox
+        size_t outputOffset = 0; // bytes of output written
+        bool canRead = true;
+        while (true)
+        {
+            if (outputOffset == output.size())
+            {
+                output.clear();
+                outputOffset = 0;
+                std::lock_guard<std::mutex> lock(connection->outboxMutex);
+                output.swap(connection->outbox);
+            }
+            const uint64_t inFlight = readCount - writtenBytes / sizeof(BatchRunner::Result);
+            canRead = canRead && !m_stopping;
+            if (!canRead && inFlight == 0)
+            {
+                break;
+            }
+
+            const bool isReading = canRead && inFlight < MAX_IN_FLIGHT;
+            const bool isWriting = outputOffset < output.size();
+            pollfd polls[2] = {{connection->fd, static_cast<short>((isReading ? POLLIN : 0) | (isWriting ? POLLOUT : 0)), 0},
+                               {connection->wakeFd, POLLIN, 0}};
+            const int ready = poll(polls, 2, 100);
+            if (ready == 0 && m_isAnswered)
+            {
+                break; // all results are in outbox and client doesn't take them
+            }
+            if (ready <= 0)
+            {
+                continue;
+            }
+            if (polls[1].revents & POLLIN)
+            {
+                eventfd_t signals;
+                eventfd_read(connection->wakeFd, &signals);
+            }
+            if (polls[0].revents & (POLLERR | POLLHUP))
+            {
+                break; // client has closed both directions, its results are dropped
+            }
+            if (isWriting && (polls[0].revents & POLLOUT))
+            {
+                const ssize_t count = send(connection->fd, output.data() + outputOffset, output.size() - outputOffset, MSG_NOSIGNAL);
+                if (count < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    break;
+                }
+                outputOffset += std::max<ssize_t>(count, 0);
+                writtenBytes += std::max<ssize_t>(count, 0);
+            }
+            if (isReading && (polls[0].revents & POLLIN))
+            {
+                // Not more than MAX_IN_FLIGHT queries are read
+                const size_t space = std::min(sizeof(input), (MAX_IN_FLIGHT - inFlight) * QUERY_SIZE) - inputSize;
+                const ssize_t count = recv(connection->fd, input + inputSize, space, 0);
+                if (count == 0 || (count < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK))
+                {
+                    canRead = false;
+                }
+                inputSize += std::max<ssize_t>(count, 0);
+                size_t offset = 0;
+                for (; canRead && inputSize - offset >= QUERY_SIZE; offset += QUERY_SIZE)
+                {
+                    BatchRunner::Query query;
+                    memcpy(&query, input + offset, QUERY_SIZE);
+                    canRead = _enqueue(query, connection);
+                    readCount += canRead ? 1 : 0;
+                }
+                inputSize -= offset;
+                memmove(input, input + offset, inputSize);
+            }
+        }
+        connection->isClosed = true;
+    }
+
+    /**
+     * @brief Wait for space in queue and put query to it
+     *
+     * @return false If server is stopping
+     */
+    bool _enqueue(const BatchRunner::Query &query, const std::shared_ptr<Connection> &connection)
+    {
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        m_queueSpace.wait(lock, [this]()
+                          { return m_queue.size() < MAX_QUEUE_SIZE || m_stopping; });
+        if (m_stopping)
+        {
+            return false;
+        }
+        m_queue.push_back(Pending{query, connection, std::chrono::steady_clock::now()});
+        if (m_queue.size() == 1 || m_queue.size() >= m_options.batchSize)
+        {
+            m_queueReady.notify_all();
+        }
+        return true;
+    }
+
+    void _worker()
+    {
+        std::vector<Pending> batch;
+        // Results of a batch are put to outbox of every connection at once
+        std::vector<std::pair<Connection *, std::string>> outputs;
+        while (_takeBatch(batch))
+        {
+            outputs.clear();
+            for (const Pending &pending : batch)
+            {
+                BatchRunner::Result result;
+                m_runner.runQuery(pending.query, result);
+                auto output = std::find_if(outputs.begin(), outputs.end(), [&pending](const std::pair<Connection *, std::string> &item)
+                                           { return item.first == pending.connection.get(); });
+                if (output == outputs.end())
+                {
+                    outputs.emplace_back(pending.connection.get(), std::string());
+                    output = outputs.end() - 1;
+                }
+                output->second.append(reinterpret_cast<const char *>(&result), sizeof(result));
+            }
+            for (auto &output : outputs)
+            {
+                bool wasEmpty;
+                {
+                    std::lock_guard<std::mutex> lock(output.first->outboxMutex);
+                    wasEmpty = output.first->outbox.empty();
+                    output.first->outbox += output.second;
+                }
+                if (wasEmpty)
+                {
+                    eventfd_write(output.first->wakeFd, 1);
+                }
+            }
+            const auto now = std::chrono::steady_clock::now();
+            for (const Pending &pending : batch)
+            {
+                m_latency.record(std::chrono::duration_cast<std::chrono::microseconds>(now - pending.received).count());
+            }
+            m_servedCount += batch.size();
+        }
+    }
+
+    /**
+     * @brief Wait for queries and take up to batchSize of them
+     *
+     * @return false If queue is closed and empty
+     */
+    bool _takeBatch(std::vector<Pending> &batch)
+    {
+        batch.clear();
+        std::unique_lock<std::mutex> lock(m_queueMutex);
+        while (true)
+        {
+            m_queueReady.wait(lock, [this]()
+                              { return !m_queue.empty() || m_closed; });
+            if (m_queue.empty())
+            {
+                return false;
+            }
+            if (m_queue.size() >= m_options.batchSize || m_options.batchWaitMicros == 0 || m_closed)
+            {
+                break;
+            }
+            const auto deadline = m_queue.front().received + std::chrono::microseconds(m_options.batchWaitMicros);
+            m_queueReady.wait_until(lock, deadline, [this]()
+                                    { return m_queue.size() >= m_options.batchSize || m_closed; });
+            // Queue is empty if other worker took the queries meanwhile
+            if (!m_queue.empty())
+            {
+                break;
+            }
+        }
+        m_queueDepth.record(m_queue.size());
+        const size_t count = std::min(m_queue.size(), m_options.batchSize);
+        std::move(m_queue.begin(), m_queue.begin() + count, std::back_inserter(batch));
+        m_queue.erase(m_queue.begin(), m_queue.begin() + count);
+        m_batchSizes.record(count);
+        m_queueSpace.notify_all();
+        return true;
+    }
+
+    Options m_options;
+    BatchRunner m_runner;
+    int m_listenFd = -1;
+    std::atomic<bool> m_stopping{false};
+    std::atomic<bool> m_isAnswered{false}; // workers have put results of all queued queries to outboxes
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::thread m_acceptor;
+    std::vector<std::thread> m_workers;
+    std::vector<Reader> m_readers; // thread of every connection, owned by acceptor thread until stop
+
+    std::mutex m_queueMutex;
+    std::condition_variable m_queueReady; // queue became non-empty, reached batch size or was closed
+    std::condition_variable m_queueSpace; // queue has space for readers or server is stopping
+    std::deque<Pending> m_queue;
+    bool m_closed = false;
+
+    std::atomic<uint64_t> m_servedCount{0};
+    Histogram m_queueDepth;
+    Histogram m_batchSizes;
+    Histogram m_latency;
+};
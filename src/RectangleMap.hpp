@@ -0,0 +1,130 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "ArrayMap.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Free space of ArrayMap split into rectangles of cells with equal weight.
+ * Rectangles are grown greedily in row-major order: first to the right, then down while the whole row fits.
+ * Decomposition is a snapshot, build it again after the map changes
+ */
+class RectangleMap
+{
+public:
+    static constexpr uint32_t NO_RECTANGLE = UINT32_MAX;
+
+    /**
+     * @brief Inclusive cell bounds of rectangle and weight of its cells
+     */
+    struct Rectangle
+    {
+        int left;
+        int top;
+        int right;
+        int bottom;
+        int weight;
+
+        bool isPerimeter(int x, int y) const
+        {
+            return x == left || x == right || y == top || y == bottom;
+        }
+    };
+
+    void build(const ArrayMap &map)
+    {
+        ASTAR_TRACE_SPAN("rectangle build");
+        m_width = map.getWidth();
+        m_height = map.getHeight();
+        m_rectangles.clear();
+        m_cellRectangle.assign(static_cast<size_t>(m_width) * m_height, NO_RECTANGLE);
+        for (int y = 0; y < m_height; ++y)
+        {
+            for (int x = 0; x < m_width; ++x)
+            {
+                if (_isFree(map, x, y, static_cast<int>(map.getPoint(x, y))))
+                {
+                    _grow(map, x, y);
+                }
+            }
+        }
+    }
+
+    uint32_t getRectangleId(int x, int y) const
+    {
+        if (x < 0 || x >= m_width || y < 0 || y >= m_height)
+        {
+            return NO_RECTANGLE;
+        }
+        return m_cellRectangle[static_cast<size_t>(y) * m_width + x];
+    }
+
+    const Rectangle &getRectangle(uint32_t id) const { return m_rectangles[id]; }
+
+    size_t getRectangleCount() const { return m_rectangles.size(); }
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+
+    /**
+     * @brief Number of cells on rectangle borders, only they are expanded by RectangleSearch
+     */
+    size_t getPerimeterCellCount() const
+    {
+        size_t count = 0;
+        for (const Rectangle &rectangle : m_rectangles)
+        {
+            const size_t width = rectangle.right - rectangle.left + 1;
+            const size_t height = rectangle.bottom - rectangle.top + 1;
+            count += width * height - (width > 2 && height > 2 ? (width - 2) * (height - 2) : 0);
+        }
+        return count;
+    }
+
+private:
+    bool _isFree(const ArrayMap &map, int x, int y, int weight) const
+    {
+        return map.isPassable(x, y) && static_cast<int>(map.getPoint(x, y)) == weight &&
+               m_cellRectangle[static_cast<size_t>(y) * m_width + x] == NO_RECTANGLE;
+    }
+
+    void _grow(const ArrayMap &map, int left, int top)
+    {
+        const int weight = static_cast<int>(map.getPoint(left, top));
+        int right = left;
+        while (right + 1 < m_width && _isFree(map, right + 1, top, weight))
+        {
+            ++right;
+        }
+        int bottom = top;
+        while (bottom + 1 < m_height)
+        {
+            bool isRowFree = true;
+            for (int x = left; x <= right && isRowFree; ++x)
+            {
+                isRowFree = _isFree(map, x, bottom + 1, weight);
+            }
+            if (!isRowFree)
+            {
+                break;
+            }
+            ++bottom;
+        }
+
+        const uint32_t id = m_rectangles.size();
+        m_rectangles.push_back(Rectangle{left, top, right, bottom, weight});
+        for (int y = top; y <= bottom; ++y)
+        {
+            for (int x = left; x <= right; ++x)
+            {
+                m_cellRectangle[static_cast<size_t>(y) * m_width + x] = id;
+            }
+        }
+    }
+
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<Rectangle> m_rectangles;
+    std::vector<uint32_t> m_cellRectangle; // rectangle of every cell in row-major order
+};
@@ -0,0 +1,332 @@
+#pragma once
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+#include "RectangleMap.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief A* over borders of RectangleMap rectangles (Rectangular Symmetry Reduction).
+ * Interior cells are never expanded: a border cell moves to cells of other rectangles as MapSearchNode does
+ * and jumps inside its own rectangle with the cost of the shortest path there, which is exact as all cells
+ * of rectangle are free and have the same weight. With 4-connected moves jumps go to the border neighbours
+ * and straight across to the opposite side. With 8-connected moves octile path between border cells goes through
+ * the interior, so jumps go straight to exits: border cells with a move to another rectangle. Any other border cell
+ * would only lead to another jump in the same rectangle, which is never shorter than the direct one.
+ * Exits on long sides shared with other rectangles still make far more jumps than A* makes moves, so 8-connected
+ * search is slower than A* on maps with large rooms.
+ * Start and goal inside rectangle are joined with all border cells, with 8-connected moves with exits. Cost is the same as of A* on MapSearchNode
+ * and the solution is expanded back to cells
+ */
+class RectangleSearch
+{
+public:
+    RectangleSearch(const RectangleMap &rectangles, const MapSearchNode &start, const MapSearchNode &goal)
+        : m_map(ArrayMap::getInstance()),
+          m_rectangles(rectangles),
+          m_width(m_map.getWidth()),
+          m_start(start.y * m_width + start.x),
+          m_goal(goal.y * m_width + goal.x),
+          m_goalX(goal.x),
+          m_goalY(goal.y),
+          m_isEight(m_map.getConnectivity() == ArrayMap::Connectivity::EIGHT)
+    {
+        ASTAR_TRACE_SPAN("rectangle setup");
+        const size_t cellCount = static_cast<size_t>(m_width) * m_map.getHeight();
+        m_g.assign(cellCount, FLT_MAX);
+        m_parent.assign(cellCount, -1);
+        m_closed.assign(cellCount, 0);
+        if (m_isEight)
+        {
+            m_exits.resize(m_rectangles.getRectangleCount());
+            m_hasExits.assign(m_rectangles.getRectangleCount(), 0);
+        }
+
+        m_g[m_start] = 0.0f;
+        m_parent[m_start] = m_start;
+        // Unreachable goal leaves open list empty and search fails without expansions
+        if (m_start == m_goal || m_map.isConnected(start.x, start.y, goal.x, goal.y))
+        {
+            m_open.push(OpenEntry{_heuristic(m_start), 0.0f, m_start});
+        }
+    }
+
+    /**
+     * @brief Function to run search and get result state in terms of SearchState enum
+     */
+    SearchState preformSearch()
+    {
+        ASTAR_TRACE_SPAN("rectangle search");
+        while (!m_open.empty())
+        {
+            const OpenEntry entry = m_open.top();
+            m_open.pop();
+            const int current = entry.index;
+            // Skip stale duplicates left in the heap after g improvement
+            if (m_closed[current] || entry.g > m_g[current])
+            {
+                continue;
+            }
+            if (current == m_goal)
+            {
+                m_state = SearchState::SUCCEEDED;
+                return m_state;
+            }
+            m_closed[current] = 1;
+            m_expandedCount++;
+            _expand(current);
+        }
+        m_state = SearchState::FAILED;
+        return m_state;
+    }
+
+    /**
+     * @brief Cells of the solution from start to goal, jumps inside rectangles are filled with cells
+     */
+    std::deque<MapSearchNode> linearizeSolution() const
+    {
+        std::deque<MapSearchNode> solution;
+        if (m_state != SearchState::SUCCEEDED)
+        {
+            return solution;
+        }
+        for (int node = m_goal; node != m_start; node = m_parent[node])
+        {
+            _appendJump(m_parent[node], node, solution);
+        }
+        solution.push_front(MapSearchNode(m_start % m_width, m_start / m_width));
+        return solution;
+    }
+
+    float getSolutionCost() const
+    {
+        return m_state == SearchState::SUCCEEDED ? m_g[m_goal] : FLT_MAX;
+    }
+
+    /**
+     * @brief Get number of expanded nodes
+     */
+    unsigned int getStepCount() const { return m_expandedCount; }
+
+    /**
+     * @brief Get number of nodes pushed to open list, including jumps
+     */
+    unsigned int getGeneratedCount() const { return m_generatedCount; }
+
+private:
+    struct OpenEntry
+    {
+        float f;
+        float g;
+        int index;
+
+        // Lower f first, ties broken in favour of bigger g (closer to goal)
+        bool operator<(const OpenEntry &rhs) const
+        {
+            return f > rhs.f || (f == rhs.f && g < rhs.g);
+        }
+    };
+
+    float _heuristic(int index) const
+    {
+        return MapSearchNode::distanceEstimate(abs(index % m_width - m_goalX), abs(index / m_width - m_goalY));
+    }
+
+    void _relax(int current, int successor, float cost)
+    {
+        const float newG = m_g[current] + cost;
+        if (!m_closed[successor] && newG < m_g[successor])
+        {
+            m_g[successor] = newG;
+            m_parent[successor] = current;
+            m_open.push(OpenEntry{newG + _heuristic(successor), newG, successor});
+            m_generatedCount++;
+        }
+    }
+
+    /**
+     * @brief Jump inside rectangle with cost of the shortest path between cells
+     */
+    void _jump(int current, int x, int y, const RectangleMap::Rectangle &rectangle)
+    {
+        const int successor = y * m_width + x;
+        if (successor != current)
+        {
+            _relax(current, successor, rectangle.weight * MapSearchNode::distanceEstimate(abs(x - current % m_width), abs(y - current / m_width)));
+        }
+    }
+
+    void _expand(int current)
+    {
+        const int x = current % m_width;
+        const int y = current / m_width;
+        const uint32_t id = m_rectangles.getRectangleId(x, y);
+        const RectangleMap::Rectangle &rectangle = m_rectangles.getRectangle(id);
+
+        // Moves to other rectangles are the same as in MapSearchNode
+        unsigned int mask = m_map.getNeighborMask(x, y);
+        for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+        {
+            const int nx = x + ArrayMap::DIRECTION_DX[dir];
+            const int ny = y + ArrayMap::DIRECTION_DY[dir];
+            if ((mask & 1) && m_rectangles.getRectangleId(nx, ny) != id)
+            {
+                _relax(current, ny * m_width + nx, rectangle.weight * (dir >= 4 ? MapSearchNode::DIAGONAL_COST : 1.0f));
+            }
+        }
+
+        if (m_rectangles.getRectangleId(m_goalX, m_goalY) == id)
+        {
+            _jump(current, m_goalX, m_goalY, rectangle);
+        }
+        if (m_isEight)
+        {
+            for (const int exit : _getExits(id))
+            {
+                _jump(current, exit % m_width, exit / m_width, rectangle);
+            }
+            return;
+        }
+        if (current == m_start)
+        {
+            _forEachBorderCell(rectangle, [&](int bx, int by)
+                               { _jump(current, bx, by, rectangle); });
+            return;
+        }
+
+        // Border neighbours and the opposite side
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const int nx = x + ArrayMap::DIRECTION_DX[dir];
+            const int ny = y + ArrayMap::DIRECTION_DY[dir];
+            if (m_rectangles.getRectangleId(nx, ny) == id && rectangle.isPerimeter(nx, ny))
+            {
+                _jump(current, nx, ny, rectangle);
+            }
+        }
+        if (x == rectangle.left)
+        {
+            _jump(current, rectangle.right, y, rectangle);
+        }
+        if (x == rectangle.right)
+        {
+            _jump(current, rectangle.left, y, rectangle);
+        }
+        if (y == rectangle.top)
+        {
+            _jump(current, x, rectangle.bottom, rectangle);
+        }
+        if (y == rectangle.bottom)
+        {
+            _jump(current, x, rectangle.top, rectangle);
+        }
+    }
+
+    /**
+     * @brief Border cells of rectangle with a move to another rectangle, found on first use
+     */
+    const std::vector<int> &_getExits(uint32_t id)
+    {
+        std::vector<int> &exits = m_exits[id];
+        if (!m_hasExits[id])
+        {
+            m_hasExits[id] = 1;
+            _forEachBorderCell(m_rectangles.getRectangle(id), [&](int x, int y)
+                               {
+                unsigned int mask = m_map.getNeighborMask(x, y);
+                for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+                {
+                    if ((mask & 1) && m_rectangles.getRectangleId(x + ArrayMap::DIRECTION_DX[dir], y + ArrayMap::DIRECTION_DY[dir]) != id)
+                    {
+                        exits.push_back(y * m_width + x);
+                        break;
+                    }
+                } });
+        }
+        return exits;
+    }
+
+    template <class FunctionT>
+    static void _forEachBorderCell(const RectangleMap::Rectangle &rectangle, FunctionT function)
+    {
+        for (int x = rectangle.left; x <= rectangle.right; ++x)
+        {
+            function(x, rectangle.top);
+            if (rectangle.bottom != rectangle.top)
+            {
+                function(x, rectangle.bottom);
+            }
+        }
+        for (int y = rectangle.top + 1; y < rectangle.bottom; ++y)
+        {
+            function(rectangle.left, y);
+            if (rectangle.right != rectangle.left)
+            {
+                function(rectangle.right, y);
+            }
+        }
+    }
+
+    /**
+     * @brief Put cells of the jump to the front of solution, excluding from cell.
+     * Diagonal steps go first, both cells are in one free rectangle so no corner is cut
+     */
+    void _appendJump(int from, int to, std::deque<MapSearchNode> &solution) const
+    {
+        int x = to % m_width;
+        int y = to / m_width;
+        const int fromX = from % m_width;
+        const int fromY = from / m_width;
+        std::deque<MapSearchNode> cells;
+        while (x != fromX || y != fromY)
+        {
+            cells.push_front(MapSearchNode(x, y));
+            const int stepX = fromX > x ? 1 : (fromX < x ? -1 : 0);
+            const int stepY = fromY > y ? 1 : (fromY < y ? -1 : 0);
+            if (m_isEight && stepX != 0 && stepY != 0)
+            {
+                x += stepX;
+                y += stepY;
+            }
+            else if (stepX != 0)
+            {
+                x += stepX;
+            }
+            else
+            {
+                y += stepY;
+            }
+        }
+        solution.insert(solution.begin(), cells.begin(), cells.end());
+    }
+
+    const ArrayMap &m_map;
+    const RectangleMap &m_rectangles;
+    const int m_width;
+    const int m_start;
+    const int m_goal;
+    const int m_goalX;
+    const int m_goalY;
+    const bool m_isEight;
+
+    // Per cell search data in row-major order, only border cells, start and goal are touched
+    std::vector<float> m_g;
+    std::vector<int> m_parent;
+    std::vector<uint8_t> m_closed;
+    // Exits of rectangles with 8-connected moves, by rectangle id
+    std::vector<std::vector<int>> m_exits;
+    std::vector<uint8_t> m_hasExits;
+
+    std::priority_queue<OpenEntry> m_open;
+    SearchState m_state = SearchState::SEARCHING;
+    unsigned int m_expandedCount = 0;
+    unsigned int m_generatedCount = 0;
+};
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Space-time reservations of map cells by agents. Open addressing hash table with
+ * linear probing. Clearing is O(1): entries of previous generation are treated as empty
+ */
+class ReservationTable
+{
+public:
+    static constexpr int NO_AGENT = -1;
+
+    explicit ReservationTable(size_t expectedReservations = 1024)
+    {
+        reserve(expectedReservations);
+    }
+
+    /**
+     * @brief Make sure table fits given number of reservations without rehashing
+     */
+    void reserve(size_t expectedReservations)
+    {
+        size_t capacity = 16;
+        // Keep load factor under 1/2 so probe sequences stay short
+        while (capacity < expectedReservations * 2)
+        {
+            capacity <<= 1;
+        }
+        if (capacity > m_entries.size())
+        {
+            _rehash(capacity);
+        }
+    }
+
+    void clear()
+    {
+        m_size = 0;
+        if (++m_generation == 0)
+        {
+            // Generation counter wrapped, old entries have to be wiped for real
+            m_entries.assign(m_entries.size(), Entry{0, 0, NO_AGENT});
+            m_generation = 1;
+        }
+    }
+
+    /**
+     * @brief Reserve cell for agent at time t. Existing reservation is overwritten
+     */
+    void reserve(int cellIndex, int t, int agent)
+    {
+        if ((m_size + 1) * 2 > m_entries.size())
+        {
+            _rehash(m_entries.size() * 2);
+        }
+        const uint64_t key = _key(cellIndex, t);
+        for (size_t slot = _hash(key) & m_mask;; slot = (slot + 1) & m_mask)
+        {
+            Entry &entry = m_entries[slot];
+            if (entry.generation != m_generation)
+            {
+                entry = Entry{key, m_generation, agent};
+                m_size++;
+                return;
+            }
+            if (entry.key == key)
+            {
+                entry.agent = agent;
+                return;
+            }
+        }
+    }
+
+    /**
+     * @brief Get agent that reserved cell at time t or NO_AGENT
+     */
+    int getAgent(int cellIndex, int t) const
+    {
+        const uint64_t key = _key(cellIndex, t);
+        for (size_t slot = _hash(key) & m_mask;; slot = (slot + 1) & m_mask)
+        {
+            const Entry &entry = m_entries[slot];
+            if (entry.generation != m_generation)
+            {
+                return NO_AGENT;
+            }
+            if (entry.key == key)
+            {
+                return entry.agent;
+            }
+        }
+    }
+
+    size_t size() const { return m_size; }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        uint32_t generation;
+        int32_t agent;
+    };
+
+    static uint64_t _key(int cellIndex, int t)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(t)) << 32) | static_cast<uint32_t>(cellIndex);
+    }
+
+    static size_t _hash(uint64_t key)
+    {
+        // splitmix64 finalizer
+        key ^= key >> 30;
+        key *= 0xbf58476d1ce4e5b9ULL;
+        key ^= key >> 27;
+        key *= 0x94d049bb133111ebULL;
+        key ^= key >> 31;
+        return static_cast<size_t>(key);
+    }
+
+    void _rehash(size_t capacity)
+    {
+        std::vector<Entry> oldEntries;
+        oldEntries.swap(m_entries);
+        const uint32_t oldGeneration = m_generation;
+
+        m_entries.assign(capacity, Entry{0, 0, NO_AGENT});
+        m_mask = capacity - 1;
+        m_generation = 1;
+        m_size = 0;
+        for (const Entry &entry : oldEntries)
+        {
+            if (entry.generation == oldGeneration)
+            {
+                reserve(static_cast<int>(entry.key & 0xFFFFFFFFu), static_cast<int>(entry.key >> 32), entry.agent);
+            }
+        }
+    }
+
+    std::vector<Entry> m_entries;
+    size_t m_mask = 0;
+    size_t m_size = 0;
+    // Generation 0 marks never used slots
+    uint32_t m_generation = 1;
+};
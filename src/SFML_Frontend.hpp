@@ -1,12 +1,16 @@
 #pragma once
-#include <list>
+#include <algorithm>
 #include <deque>
+#include <iostream>
+#include <string>
 #include <thread>
 
 #include <SFML/Graphics.hpp>
 
 #include "ArrayMap.hpp"
 #include "MapSearchNode.hpp"
+#include "SearchEventStream.hpp"
+#include "Trace.hpp"
 
 class SFML_Frontend
 {
@@ -29,47 +33,10 @@ public:
         }
 
         // Create the main window
-        const float rectWidth = WINDOW_WIDTH / map.getWidth();
-        const float rectHeight = WINDOW_HEIGHT / map.getHeight();
         RenderWindow window(VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "A* visualization");
-        std::list<RectangleShape> rects;
+        window.setFramerateLimit(60);
+        _buildGrid(map, false);
 
-        for (size_t i = 0; i < map.getHeight(); ++i)
-        {
-            for (size_t j = 0; j < map.getWidth(); ++j)
-            {
-                auto currentCell = static_cast<ArrayMap::CellType>(map.getViewMap()[i][j]);
-                if (currentCell != ArrayMap::CellType::EMPTY_POS)
-                {
-                    RectangleShape rect(Vector2f(rectWidth, rectHeight));
-                    Vector2f pos(CELL_STEP + (j * rectWidth), CELL_STEP + (i * rectHeight));
-                    rect.setPosition(pos);
-                    switch (currentCell)
-                    {
-                    case ArrayMap::CellType::WALL_POS:
-                        rect.setFillColor(Color::White);
-                        break;
-                    case ArrayMap::CellType::PATH_POS:
-                        rect.setFillColor(Color::Yellow);
-                        break;
-                    case ArrayMap::CellType::START_POS:
-                        m_startText.setPosition(pos);
-                        rect.setFillColor(Color::Green);
-                        break;
-                    case ArrayMap::CellType::GOAL_POS:
-                        m_goalText.setPosition(pos);
-                        rect.setFillColor(Color::Red);
-                        break;
-                    case ArrayMap::CellType::OPEN_PATH_POS:
-                        rect.setFillColor(Color(144, 144, 144));
-                        break;
-                    default:
-                        break;
-                    }
-                    rects.push_back(rect);
-                }
-            }
-        }
         // Start the game loop
         while (window.isOpen())
         {
@@ -79,18 +46,17 @@ public:
                 if (event.type == Event::Closed)
                     window.close();
             }
-            window.clear();
-            for (const auto r : rects)
-            {
-                window.draw(r);
-            }
-            window.draw(m_startText);
-            window.draw(m_goalText);
-            window.display();
+            _display(window);
         }
     }
 
-    bool stepByStepDraw(ArrayMap &map, std::deque<MapSearchNode> solution, std::deque<MapSearchNode> visited)
+    /**
+     * @brief Draw search while it is running. Must be called from the render thread, events are drained
+     * from the stream at the window frame rate so the search thread never waits for drawing
+     *
+     * @return true If user closed the window
+     */
+    bool liveDraw(ArrayMap &map, SearchEventStream &stream)
     {
         using namespace sf;
 
@@ -104,48 +70,17 @@ public:
         }
 
         // Create the main window
-        const float rectWidth = WINDOW_WIDTH / map.getWidth();
-        const float rectHeight = WINDOW_HEIGHT / map.getHeight();
         RenderWindow window(VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT), "A* visualization");
         window.setFramerateLimit(60);
-        std::list<RectangleShape> rects;
 
         // First drawing empty grid
-        for (size_t i = 0; i < map.getHeight(); ++i)
-        {
-            for (size_t j = 0; j < map.getWidth(); ++j)
-            {
-                auto currentCell = static_cast<ArrayMap::CellType>(map.getViewMap()[i][j]);
-                if (currentCell == ArrayMap::CellType::WALL_POS or
-                    currentCell == ArrayMap::CellType::START_POS or
-                    currentCell == ArrayMap::CellType::GOAL_POS)
-                {
-                    RectangleShape rect(Vector2f(rectWidth, rectHeight));
-                    Vector2f pos(CELL_STEP + (j * rectWidth), CELL_STEP + (i * rectHeight));
-                    rect.setPosition(pos);
-                    switch (currentCell)
-                    {
-                    case ArrayMap::CellType::WALL_POS:
-                        rect.setFillColor(Color::White);
-                        break;
-                    case ArrayMap::CellType::START_POS:
-                        m_startText.setPosition(pos);
-                        rect.setFillColor(Color::Green);
-                        break;
-                    case ArrayMap::CellType::GOAL_POS:
-                        m_goalText.setPosition(pos);
-                        rect.setFillColor(Color::Red);
-                        break;
-                    default:
-                        break;
-                    }
-                    rects.push_back(rect);
-                }
-            }
-        }
+        _buildGrid(map, true);
+
+        // Bigger maps are animated with more events per frame so the whole search takes similar time on screen
+        const size_t eventsPerFrame = std::max<size_t>(1, static_cast<size_t>(map.getWidth()) * map.getHeight() / CELLS_PER_EVENT);
 
-        size_t visitedNodeIndex = 1;
         size_t solutionNodeIndex = 1;
+        uint64_t shownDroppedCount = 0;
 
         bool stopLoop = false;
         bool isShutDown = false;
@@ -162,51 +97,139 @@ public:
                 }
             }
 
-            if (visitedNodeIndex < visited.size())
+            // Finished flag has to be read before draining: if it is set all events are already queued
+            const bool isSearchFinished = stream.isFinished();
+            size_t processedEvents = 0;
+            SearchEvent searchEvent;
+            while (processedEvents < eventsPerFrame && stream.poll(searchEvent))
             {
-                RectangleShape rect(Vector2f(rectWidth, rectHeight));
-                Vector2f pos(CELL_STEP + (visited[visitedNodeIndex].x * rectWidth), CELL_STEP + (visited[visitedNodeIndex].y * rectHeight));
-                rect.setPosition(pos);
-                rect.setFillColor(Color(144, 144, 144));
-                rects.push_back(rect);
-                visitedNodeIndex++;
+                auto cell = static_cast<ArrayMap::CellType>(map.getViewMap()[searchEvent.y][searchEvent.x]);
+                if (cell != ArrayMap::CellType::START_POS && cell != ArrayMap::CellType::GOAL_POS)
+                {
+                    _setCellColor(searchEvent.x, searchEvent.y,
+                                  searchEvent.type == SearchEvent::Type::EXPAND ? VISITED_COLOR : OPEN_COLOR);
+                }
+                processedEvents++;
             }
-            // We dont want to fill the goal cell so we just skip the last node of the solution
-            else if (solutionNodeIndex < solution.size() - 1)
+
+            if (isSearchFinished && processedEvents < eventsPerFrame)
             {
-                RectangleShape rect(Vector2f(rectWidth, rectHeight));
-                Vector2f pos(CELL_STEP + (solution[solutionNodeIndex].x * rectWidth), CELL_STEP + (solution[solutionNodeIndex].y * rectHeight));
-                rect.setPosition(pos);
-                rect.setFillColor(Color::Yellow);
-                rects.push_back(rect);
-                solutionNodeIndex++;
+                const auto &solution = stream.getSolution();
+                // We dont want to fill the goal cell so we just skip the last node of the solution
+                if (solutionNodeIndex + 1 < solution.size())
+                {
+                    _setCellColor(solution[solutionNodeIndex].x, solution[solutionNodeIndex].y, Color::Yellow);
+                    solutionNodeIndex++;
+                }
+                else
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(800));
+                    stopLoop = true;
+                }
             }
-            else
+
+            if (stream.getDroppedCount() != shownDroppedCount)
             {
-                std::this_thread::sleep_for(std::chrono::milliseconds(800));
-                stopLoop = true;
+                shownDroppedCount = stream.getDroppedCount();
+                window.setTitle("A* visualization (dropped events: " + std::to_string(shownDroppedCount) + ")");
             }
 
-            // FIXME
-            // In good solution we should't send to sleep the main thread to get step-by-step drawing.
-            // I should implement sfml rendering in separate thread and use thread-safe queue (e.g. with mutex) or some kind
-            // of observer pattern to notify sfml thread that we have to render something new on window
-            // but it would be too much work for the job test case.
-            std::this_thread::sleep_for(std::chrono::milliseconds(80));
+            _display(window);
+        }
+        return isShutDown;
+    }
 
-            window.clear();
-            for (const auto r : rects)
+private:
+    // Average number of map cells per one drained event in a frame
+    static constexpr size_t CELLS_PER_EVENT = 400;
+
+    inline static const sf::Color VISITED_COLOR = sf::Color(144, 144, 144);
+    inline static const sf::Color OPEN_COLOR = sf::Color(72, 72, 72);
+
+    /**
+     * @brief Fill vertex array with one quad per map cell. Cells are square and scaled
+     * to fit the window whatever map dimensions are
+     *
+     * @param onlyStatic If true only walls, start and goal are colored, other cells stay empty
+     */
+    void _buildGrid(ArrayMap &map, bool onlyStatic)
+    {
+        const float fieldWidth = WINDOW_WIDTH - 2 * CELL_STEP;
+        const float fieldHeight = WINDOW_HEIGHT - 2 * CELL_STEP;
+        m_mapWidth = map.getWidth();
+        m_cellSize = std::min(fieldWidth / map.getWidth(), fieldHeight / map.getHeight());
+
+        m_grid.setPrimitiveType(sf::Quads);
+        m_grid.resize(static_cast<size_t>(map.getWidth()) * map.getHeight() * 4);
+
+        for (int i = 0; i < map.getHeight(); ++i)
+        {
+            for (int j = 0; j < map.getWidth(); ++j)
             {
-                window.draw(r);
+                sf::Vertex *quad = &m_grid[(static_cast<size_t>(i) * m_mapWidth + j) * 4];
+                const sf::Vector2f pos = _cellPosition(j, i);
+                quad[0].position = pos;
+                quad[1].position = sf::Vector2f(pos.x + m_cellSize, pos.y);
+                quad[2].position = sf::Vector2f(pos.x + m_cellSize, pos.y + m_cellSize);
+                quad[3].position = sf::Vector2f(pos.x, pos.y + m_cellSize);
+
+                auto currentCell = static_cast<ArrayMap::CellType>(map.getViewMap()[i][j]);
+                sf::Color color = sf::Color::Black;
+                switch (currentCell)
+                {
+                case ArrayMap::CellType::WALL_POS:
+                    color = sf::Color::White;
+                    break;
+                case ArrayMap::CellType::START_POS:
+                    m_startText.setPosition(pos);
+                    color = sf::Color::Green;
+                    break;
+                case ArrayMap::CellType::GOAL_POS:
+                    m_goalText.setPosition(pos);
+                    color = sf::Color::Red;
+                    break;
+                case ArrayMap::CellType::PATH_POS:
+                    color = onlyStatic ? sf::Color::Black : sf::Color::Yellow;
+                    break;
+                case ArrayMap::CellType::OPEN_PATH_POS:
+                    color = onlyStatic ? sf::Color::Black : VISITED_COLOR;
+                    break;
+                default:
+                    break;
+                }
+                _setCellColor(j, i, color);
             }
-            window.draw(m_startText);
-            window.draw(m_goalText);
-            window.display();
         }
-        return isShutDown;
     }
 
-private:
+    sf::Vector2f _cellPosition(int x, int y) const
+    {
+        return sf::Vector2f(CELL_STEP + x * m_cellSize, CELL_STEP + y * m_cellSize);
+    }
+
+    /**
+     * @brief Recolor single cell. Only 4 vertices are touched so it is cheap to call on every change
+     */
+    void _setCellColor(int x, int y, const sf::Color &color)
+    {
+        sf::Vertex *quad = &m_grid[(static_cast<size_t>(y) * m_mapWidth + x) * 4];
+        quad[0].color = color;
+        quad[1].color = color;
+        quad[2].color = color;
+        quad[3].color = color;
+    }
+
+    void _display(sf::RenderWindow &window)
+    {
+        ASTAR_TRACE_SPAN("sfml render");
+        window.clear();
+        // Whole grid goes to GPU with a single draw call
+        window.draw(m_grid);
+        window.draw(m_startText);
+        window.draw(m_goalText);
+        window.display();
+    }
+
     void _initializeText()
     {
         m_startText.setString("Start");
@@ -222,6 +245,10 @@ private:
         m_goalText.setFillColor(sf::Color::Black);
     }
 
+    sf::VertexArray m_grid;
+    float m_cellSize = 0.0f;
+    int m_mapWidth = 0;
+
     sf::Text m_startText;
     sf::Text m_goalText;
     sf::Font m_font;
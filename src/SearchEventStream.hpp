@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+#include "AStarSearch.hpp"
+#include "MapSearchNode.hpp"
+#include "SpscRingBuffer.hpp"
+
+/**
+ * @brief Single cell change published by the search
+ */
+struct SearchEvent
+{
+    enum class Type : uint8_t
+    {
+        EXPAND,  // node moved to closed list
+        GENERATE // node pushed to open list
+    };
+
+    Type type;
+    int x;
+    int y;
+};
+
+/**
+ * @brief Observer that forwards search progress from the search thread to a render thread.
+ * Search never waits for the renderer: if the queue is full event is dropped and counted.
+ * Solution is handed over separately after the search, so it is never lost
+ */
+class SearchEventStream : public AStarSearch<MapSearchNode>::Observer
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+    explicit SearchEventStream(size_t capacity = DEFAULT_CAPACITY) : m_events(capacity) {}
+
+    void onExpand(const MapSearchNode &state) override
+    {
+        _publish(SearchEvent::Type::EXPAND, state);
+    }
+
+    void onGenerate(const MapSearchNode &state) override
+    {
+        _publish(SearchEvent::Type::GENERATE, state);
+    }
+
+    void onFinish(SearchState result, const std::deque<MapSearchNode> &solution) override
+    {
+        m_solution = solution;
+        m_result = result;
+        m_finished.store(true, std::memory_order_release);
+    }
+
+    /**
+     * @brief Take next event. Must be called only from render thread
+     */
+    bool poll(SearchEvent &event)
+    {
+        return m_events.tryPop(event);
+    }
+
+    /**
+     * @brief True after search has finished. Once it is observed all events are already in the queue
+     * and solution with result can be read
+     */
+    bool isFinished() const { return m_finished.load(std::memory_order_acquire); }
+
+    SearchState getResult() const { return m_result; }
+
+    const std::deque<MapSearchNode> &getSolution() const { return m_solution; }
+
+    uint64_t getPublishedCount() const { return m_published.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Number of events that did not fit in the queue because renderer fell behind
+     */
+    uint64_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    void _publish(SearchEvent::Type type, const MapSearchNode &state)
+    {
+        // Counters have single writer so plain load and store are enough
+        m_published.store(m_published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (!m_events.tryPush(SearchEvent{type, state.x, state.y}))
+        {
+            m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+    }
+
+    SpscRingBuffer<SearchEvent> m_events;
+    std::atomic<uint64_t> m_published{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    std::atomic<bool> m_finished{false};
+    SearchState m_result = SearchState::SEARCHING;
+    std::deque<MapSearchNode> m_solution;
+};
@@ -0,0 +1,124 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+#include "ReservationTable.hpp"
+
+/**
+ * @brief Data shared by all nodes of one space-time search
+ */
+struct SpaceTimeContext
+{
+    const ReservationTable *reservations;
+    // True distance to goal for every cell in row-major order, see TrueDistanceHeuristic
+    const float *goalDistances;
+    int agent;
+    // Search stops at this time step, the rest of the route is estimated by goalDistances
+    int windowEnd;
+};
+
+/**
+ * @brief UserState for cooperative path finding: cell and time step. Moves to cells reserved
+ * by other agents and swapping places with other agent are not generated
+ */
+class SpaceTimeNode
+{
+public:
+    int x;
+    int y;
+    int t;
+    const SpaceTimeContext *context;
+
+    SpaceTimeNode() : x(0), y(0), t(0), context(nullptr) {}
+    SpaceTimeNode(int px, int py, int pt, const SpaceTimeContext *ctx) : x(px), y(py), t(pt), context(ctx) {}
+
+    /**
+     * @brief Precomputed true distance ignoring other agents, so the heuristic is exact on an empty map
+     */
+    float goalDistanceEstimate(SpaceTimeNode &nodeGoal)
+    {
+        return context->goalDistances[y * ArrayMap::getInstance().getWidth() + x];
+    }
+
+    /**
+     * @brief Search is windowed: any node at the end of the window is the goal
+     */
+    bool isGoal(SpaceTimeNode &nodeGoal) const
+    {
+        return t >= context->windowEnd;
+    }
+
+    bool getSuccessors(AStarSearch<SpaceTimeNode> *astarsearch, SpaceTimeNode *parent_node)
+    {
+        ArrayMap &map = ArrayMap::getInstance();
+        const int width = map.getWidth();
+        const int cell = y * width + x;
+        const ReservationTable &reservations = *context->reservations;
+
+        // Agent that will be in our cell on the next step must not swap places with us
+        const int incomingAgent = reservations.getAgent(cell, t + 1);
+
+        SpaceTimeNode NewNode;
+        if (incomingAgent == ReservationTable::NO_AGENT || incomingAgent == context->agent)
+        {
+            NewNode = SpaceTimeNode(x, y, t + 1, context);
+            astarsearch->addSuccessor(NewNode);
+        }
+
+        unsigned int mask = map.getNeighborMask(x, y);
+        for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+        {
+            if (mask & 1)
+            {
+                const int nx = x + ArrayMap::DIRECTION_DX[dir];
+                const int ny = y + ArrayMap::DIRECTION_DY[dir];
+                const int ncell = ny * width + nx;
+                const int occupant = reservations.getAgent(ncell, t + 1);
+                if (occupant != ReservationTable::NO_AGENT && occupant != context->agent)
+                {
+                    continue;
+                }
+                const int swapAgent = reservations.getAgent(ncell, t);
+                if (swapAgent != ReservationTable::NO_AGENT && swapAgent != context->agent && swapAgent == incomingAgent)
+                {
+                    continue;
+                }
+                NewNode = SpaceTimeNode(nx, ny, t + 1, context);
+                astarsearch->addSuccessor(NewNode);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Moving costs the same as for MapSearchNode, waiting costs 1 unless agent already waits on its goal
+     */
+    float getCost(SpaceTimeNode &successor) const
+    {
+        if (successor.x == x && successor.y == y)
+        {
+            const bool isOnGoal = context->goalDistances[y * ArrayMap::getInstance().getWidth() + x] == 0.0f;
+            return isOnGoal ? 0.0f : 1.0f;
+        }
+        MapSearchNode from(x, y);
+        MapSearchNode to(successor.x, successor.y);
+        return from.getCost(to);
+    }
+
+    bool isSameState(SpaceTimeNode &rhs) const
+    {
+        return x == rhs.x && y == rhs.y && t == rhs.t;
+    }
+
+    /**
+     * @brief Time step and cell, so AStarSearch finds existing nodes through a hash table. Windowed search
+     * touches few cells of each step, a dense table of the whole window would be mostly empty
+     */
+    uint64_t getStateKey() const
+    {
+        return (static_cast<uint64_t>(t) << 32) | static_cast<uint32_t>(y * ArrayMap::getInstance().getWidth() + x);
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief Lock-free bounded queue for exactly one producer thread and one consumer thread.
+ * Capacity is rounded up to the power of two so index wrapping is a single mask
+ *
+ * @tparam T Trivially copyable item type
+ */
+template <class T>
+class SpscRingBuffer
+{
+public:
+    explicit SpscRingBuffer(size_t capacity)
+    {
+        size_t roundedCapacity = 1;
+        while (roundedCapacity < capacity)
+        {
+            roundedCapacity <<= 1;
+        }
+        m_buffer.resize(roundedCapacity);
+        m_mask = roundedCapacity - 1;
+    }
+
+    SpscRingBuffer(SpscRingBuffer const &) = delete;
+    void operator=(SpscRingBuffer const &) = delete;
+
+    /**
+     * @brief Put item to the queue. Must be called only from producer thread
+     *
+     * @return false If queue is full and item was not added
+     */
+    bool tryPush(const T &item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_buffer.size())
+        {
+            // Refresh consumer position only when queue looks full
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_buffer.size())
+            {
+                return false;
+            }
+        }
+        m_buffer[tail & m_mask] = item;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Take item from the queue. Must be called only from consumer thread
+     *
+     * @return false If queue is empty
+     */
+    bool tryPop(T &item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+            {
+                return false;
+            }
+        }
+        item = m_buffer[head & m_mask];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return m_buffer.size(); }
+
+    /**
+     * @brief Approximate number of items in the queue, exact only when both threads are idle
+     */
+    size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    std::vector<T> m_buffer;
+    size_t m_mask = 0;
+
+    // Producer and consumer positions live on separate cache lines to avoid false sharing.
+    // Each side also keeps a cached copy of the other side position to touch shared line less often
+    alignas(64) std::atomic<size_t> m_head{0};
+    size_t m_cachedTail = 0;
+    alignas(64) std::atomic<size_t> m_tail{0};
+    size_t m_cachedHead = 0;
+};
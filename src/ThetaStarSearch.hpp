@@ -0,0 +1,296 @@
+#pragma once
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <queue>
+#include <vector>
+
+#include "AStarSearch.hpp"
+#include "ArrayMap.hpp"
+#include "MapSearchNode.hpp"
+#include "Trace.hpp"
+
+/**
+ * @brief Any-angle search on ArrayMap. Node parent may be any visible node, not only a neighbour,
+ * so solution is a short list of waypoints connected by straight segments.
+ * Cell weights are ignored: every passable cell costs the same and cost of segment is its Euclidean length.
+ * Line of sight uses the same no corner cutting rule as 8-connected MapSearchNode
+ */
+class ThetaStarSearch
+{
+public:
+    enum class Mode
+    {
+        THETA,     // line of sight is checked for every generated node
+        LAZY_THETA // line of sight is checked once per expanded node, parent is fixed on expansion
+    };
+
+    ThetaStarSearch(const MapSearchNode &start, const MapSearchNode &goal, Mode mode = Mode::THETA)
+        : m_map(ArrayMap::getInstance()),
+          m_width(m_map.getWidth()),
+          m_start(start.y * m_width + start.x),
+          m_goal(goal.y * m_width + goal.x),
+          m_goalX(goal.x),
+          m_goalY(goal.y),
+          m_mode(mode)
+    {
+        const size_t cellCount = static_cast<size_t>(m_width) * m_map.getHeight();
+        m_g.assign(cellCount, FLT_MAX);
+        m_parent.assign(cellCount, -1);
+        m_closed.assign(cellCount, 0);
+
+        m_g[m_start] = 0.0f;
+        m_parent[m_start] = m_start;
+        // Unreachable goal leaves open list empty and search fails without expansions
+        if (m_start == m_goal || m_map.isConnected(start.x, start.y, goal.x, goal.y))
+        {
+            m_open.push(OpenEntry{_heuristic(m_start), 0.0f, m_start});
+        }
+    }
+
+    /**
+     * @brief Function to run search and get result state in terms of SearchState enum
+     */
+    SearchState preformSearch()
+    {
+        ASTAR_TRACE_SPAN("theta search");
+        while (!m_open.empty())
+        {
+            const OpenEntry entry = m_open.top();
+            m_open.pop();
+            const int current = entry.index;
+            // Skip stale duplicates left in the heap after g improvement
+            if (m_closed[current] || entry.g > m_g[current])
+            {
+                continue;
+            }
+
+            if (m_mode == Mode::LAZY_THETA)
+            {
+                _fixParent(current);
+            }
+            if (current == m_goal)
+            {
+                m_state = SearchState::SUCCEEDED;
+                return m_state;
+            }
+            m_closed[current] = 1;
+            m_expandedCount++;
+
+            const int x = current % m_width;
+            const int y = current / m_width;
+            // Any-angle search always expands 8 neighbours whatever connectivity map has
+            unsigned int mask = m_map.getNeighborMask(x, y, ArrayMap::Connectivity::EIGHT);
+            for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+            {
+                if (mask & 1)
+                {
+                    const int successor = (y + ArrayMap::DIRECTION_DY[dir]) * m_width + x + ArrayMap::DIRECTION_DX[dir];
+                    if (!m_closed[successor])
+                    {
+                        _updateVertex(current, successor);
+                    }
+                }
+            }
+        }
+        m_state = SearchState::FAILED;
+        return m_state;
+    }
+
+    /**
+     * @brief Waypoints from start to goal. Every two consecutive waypoints are visible from each other
+     */
+    std::deque<MapSearchNode> linearizeSolution() const
+    {
+        std::deque<MapSearchNode> solution;
+        if (m_state != SearchState::SUCCEEDED)
+        {
+            return solution;
+        }
+        for (int node = m_goal;; node = m_parent[node])
+        {
+            solution.push_front(MapSearchNode(node % m_width, node / m_width));
+            if (node == m_start)
+            {
+                break;
+            }
+        }
+        return solution;
+    }
+
+    /**
+     * @brief Euclidean length of solution or FLT_MAX if there is no solution
+     */
+    float getSolutionCost() const
+    {
+        return m_state == SearchState::SUCCEEDED ? m_g[m_goal] : FLT_MAX;
+    }
+
+    /**
+     * @brief Get number of expanded nodes
+     */
+    unsigned int getStepCount() const { return m_expandedCount; }
+
+    /**
+     * @brief Get number of line of sight checks made during the search
+     */
+    unsigned int getLineOfSightCount() const { return m_lineOfSightCount; }
+
+    /**
+     * @brief Check that straight segment between centers of two cells crosses only passable cells.
+     * Segment going exactly through a corner needs both cells touching this corner to be passable
+     */
+    static bool lineOfSight(const ArrayMap &map, int x0, int y0, int x1, int y1)
+    {
+        const uint8_t *passable = map.getPassabilityData();
+        const int width = map.getWidth();
+        // Both ends are inside the map so every cell of the walk is inside its bounding box
+        int dx = std::abs(x1 - x0);
+        int dy = std::abs(y1 - y0);
+        const int stepX = x1 > x0 ? 1 : -1;
+        const int stepY = y1 > y0 ? width : -width;
+        int index = y0 * width + x0;
+        int error = dx - dy;
+        dx *= 2;
+        dy *= 2;
+        for (int n = (dx + dy) / 2; n > 0; --n)
+        {
+            if (error > 0)
+            {
+                index += stepX;
+                error -= dy;
+            }
+            else if (error < 0)
+            {
+                index += stepY;
+                error += dx;
+            }
+            else
+            {
+                // Exactly through the corner
+                if (!passable[index + stepX] || !passable[index + stepY])
+                {
+                    return false;
+                }
+                index += stepX + stepY;
+                error += dx - dy;
+                --n;
+            }
+            if (!passable[index])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    struct OpenEntry
+    {
+        float f;
+        float g;
+        int index;
+
+        // Lower f first, ties broken in favour of bigger g (closer to goal)
+        bool operator<(const OpenEntry &rhs) const
+        {
+            return f > rhs.f || (f == rhs.f && g < rhs.g);
+        }
+    };
+
+    float _heuristic(int index) const
+    {
+        return _distance(index % m_width, index / m_width, m_goalX, m_goalY);
+    }
+
+    static float _distance(int x0, int y0, int x1, int y1)
+    {
+        return std::sqrt(static_cast<float>((x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0)));
+    }
+
+    float _distance(int from, int to) const
+    {
+        return _distance(from % m_width, from / m_width, to % m_width, to / m_width);
+    }
+
+    bool _lineOfSight(int from, int to)
+    {
+        m_lineOfSightCount++;
+        return lineOfSight(m_map, from % m_width, from / m_width, to % m_width, to / m_width);
+    }
+
+    void _updateVertex(int current, int successor)
+    {
+        const int parent = m_parent[current];
+        int newParent = current;
+        float newG = 0.0f;
+
+        // Straight segment from parent is never longer than going through current node.
+        // Lazy variant assumes visibility and verifies it when successor is expanded
+        if (m_mode == Mode::LAZY_THETA || _lineOfSight(parent, successor))
+        {
+            newParent = parent;
+            newG = m_g[parent] + _distance(parent, successor);
+        }
+        else
+        {
+            newG = m_g[current] + _distance(current, successor);
+        }
+
+        if (newG < m_g[successor])
+        {
+            m_g[successor] = newG;
+            m_parent[successor] = newParent;
+            m_open.push(OpenEntry{newG + _heuristic(successor), newG, successor});
+        }
+    }
+
+    /**
+     * @brief Lazy Theta*: if assumed parent is not visible, take best expanded neighbour as parent
+     */
+    void _fixParent(int current)
+    {
+        const int parent = m_parent[current];
+        if (parent == current || _lineOfSight(parent, current))
+        {
+            return;
+        }
+        const int x = current % m_width;
+        const int y = current / m_width;
+        m_g[current] = FLT_MAX;
+        unsigned int mask = m_map.getNeighborMask(x, y, ArrayMap::Connectivity::EIGHT);
+        for (int dir = 0; mask != 0; ++dir, mask >>= 1)
+        {
+            if (mask & 1)
+            {
+                const int neighbor = (y + ArrayMap::DIRECTION_DY[dir]) * m_width + x + ArrayMap::DIRECTION_DX[dir];
+                const float g = m_g[neighbor] + _distance(neighbor, current);
+                if (m_closed[neighbor] && g < m_g[current])
+                {
+                    m_g[current] = g;
+                    m_parent[current] = neighbor;
+                }
+            }
+        }
+    }
+
+    const ArrayMap &m_map;
+    const int m_width;
+    const int m_start;
+    const int m_goal;
+    const int m_goalX;
+    const int m_goalY;
+    const Mode m_mode;
+
+    // Per cell search data in row-major order
+    std::vector<float> m_g;
+    std::vector<int> m_parent;
+    std::vector<uint8_t> m_closed;
+
+    std::priority_queue<OpenEntry> m_open;
+    SearchState m_state = SearchState::SEARCHING;
+    unsigned int m_expandedCount = 0;
+    unsigned int m_lineOfSightCount = 0;
+};
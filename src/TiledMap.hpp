@@ -0,0 +1,363 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ArrayMap.hpp"
+
+/**
+ * @brief Read-only map stored in file as square tiles and memory-mapped on open.
+ * Only limited number of tiles are kept resident: least recently used tile is evicted
+ * with madvise(MADV_DONTNEED) and is read from file again on the next touch.
+ * Not thread-safe: every getPoint may update LRU state
+ */
+class TiledMap
+{
+public:
+    static constexpr char MAGIC[8] = {'A', 'S', 'T', 'I', 'L', 'E', 'S', '\0'};
+    static constexpr uint32_t VERSION = 1;
+    // Tiles start at page boundary so each can be dropped from memory on its own
+    static constexpr size_t TILE_ALIGNMENT = 4096;
+
+    /**
+     * @brief Counters of tile cache, reset with resetCounters() before each search to get per search numbers
+     */
+    struct Counters
+    {
+        uint64_t tileFaults = 0; // tile was not resident and had to be loaded
+        uint64_t tileEvictions = 0;
+        uint64_t tileSwitches = 0; // access to other tile than previous one
+    };
+
+    /**
+     * @brief Write tiled map file. Cells are requested tile by tile so the whole map never has to be in memory
+     *
+     * @param tileShift Tile side is 1 << tileShift cells
+     * @param cell Function returning cell value (ArrayMap::CellType) for x, y
+     * @return false If file can't be written
+     */
+    static bool writeFile(const std::string &path, int width, int height, int tileShift,
+                          const std::function<int(int x, int y)> &cell, std::string &error)
+    {
+        FILE *file = fopen(path.c_str(), "wb");
+        if (!file)
+        {
+            error = "can't open " + path + " for writing";
+            return false;
+        }
+        const Header header = _makeHeader(width, height, tileShift);
+        std::vector<uint8_t> tile(_tileStride(header), 0);
+        bool isOk = fwrite(&header, sizeof(header), 1, file) == 1;
+        std::vector<uint8_t> padding(TILE_ALIGNMENT - sizeof(header), 0);
+        isOk = isOk && fwrite(padding.data(), 1, padding.size(), file) == padding.size();
+
+        const int tileSize = 1 << tileShift;
+        for (uint32_t tileY = 0; isOk && tileY < header.tilesY; ++tileY)
+        {
+            for (uint32_t tileX = 0; isOk && tileX < header.tilesX; ++tileX)
+            {
+                for (int y = 0; y < tileSize; ++y)
+                {
+                    for (int x = 0; x < tileSize; ++x)
+                    {
+                        const int mapX = tileX * tileSize + x;
+                        const int mapY = tileY * tileSize + y;
+                        // Cells out of map in the last tiles are walls
+                        tile[(y << tileShift) + x] = (mapX < width && mapY < height)
+                                                         ? static_cast<uint8_t>(cell(mapX, mapY))
+                                                         : static_cast<uint8_t>(ArrayMap::CellType::WALL_POS);
+                    }
+                }
+                isOk = fwrite(tile.data(), 1, tile.size(), file) == tile.size();
+            }
+        }
+        isOk = (fclose(file) == 0) && isOk;
+        if (!isOk)
+        {
+            error = "failed to write " + path;
+        }
+        return isOk;
+    }
+
+    static bool writeFile(const std::string &path, const ArrayMap::ArrayT &map, int tileShift, std::string &error)
+    {
+        const int height = map.size();
+        const int width = map.empty() ? 0 : map.front().size();
+        return writeFile(path, width, height, tileShift, [&map](int x, int y)
+                         { return map[y][x]; },
+                         error);
+    }
+
+    TiledMap() = default;
+    TiledMap(TiledMap const &) = delete;
+    void operator=(TiledMap const &) = delete;
+
+    ~TiledMap()
+    {
+        close();
+    }
+
+    /**
+     * @brief Map file and prepare tile cache
+     *
+     * @param maxResidentTiles Number of tiles kept in memory at once
+     * @return false If file is missing or is not a tiled map
+     */
+    bool open(const std::string &path, size_t maxResidentTiles, std::string &error)
+    {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            error = "can't open " + path;
+            return false;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(Header))
+        {
+            ::close(fd);
+            error = path + " is too small";
+            return false;
+        }
+        void *data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED)
+        {
+            error = "mmap of " + path + " failed";
+            return false;
+        }
+        m_data = static_cast<const uint8_t *>(data);
+        m_dataSize = fileStat.st_size;
+
+        memcpy(&m_header, m_data, sizeof(m_header));
+        const uint64_t tileCount = static_cast<uint64_t>(m_header.tilesX) * m_header.tilesY;
+        if (memcmp(m_header.magic, MAGIC, sizeof(MAGIC)) != 0 || m_header.version != VERSION ||
+            m_header.tileShift == 0 || m_header.tileShift > 12)
+        {
+            close();
+            error = path + " is not a valid tiled map";
+            return false;
+        }
+        if (!_isValidGeometry(m_header, m_dataSize))
+        {
+            close();
+            error = path + " has map size inconsistent with its tiles";
+            return false;
+        }
+
+        m_tileMask = (1u << m_header.tileShift) - 1;
+        m_tileSlot.assign(tileCount, NO_SLOT);
+        const size_t slotCount = std::max<size_t>(1, std::min<size_t>(maxResidentTiles, tileCount));
+        m_slotTile.assign(slotCount, NO_TILE);
+        m_slotPrev.assign(slotCount, NO_SLOT);
+        m_slotNext.assign(slotCount, NO_SLOT);
+        m_freeSlots.clear();
+        for (size_t slot = slotCount; slot > 0; --slot)
+        {
+            m_freeSlots.push_back(slot - 1);
+        }
+        m_lruHead = m_lruTail = NO_SLOT;
+        m_lastTile = NO_TILE;
+        m_lastTileData = nullptr;
+        m_canDropPages = _tileStride(m_header) % sysconf(_SC_PAGESIZE) == 0;
+        m_counters = Counters();
+        return true;
+    }
+
+    void close()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t *>(m_data), m_dataSize);
+            m_data = nullptr;
+            m_dataSize = 0;
+        }
+        m_header = Header();
+        m_lastTile = NO_TILE;
+        m_lastTileData = nullptr;
+    }
+
+    int getWidth() const { return m_header.width; }
+
+    int getHeight() const { return m_header.height; }
+
+    int getTileSize() const { return 1 << m_header.tileShift; }
+
+    uint64_t getTileCount() const { return static_cast<uint64_t>(m_header.tilesX) * m_header.tilesY; }
+
+    size_t getResidentTileCount() const { return m_slotTile.size() - m_freeSlots.size(); }
+
+    ArrayMap::CellType getPoint(int x, int y)
+    {
+        if (x < 0 || x >= getWidth() ||
+            y < 0 || y >= getHeight())
+        {
+            return ArrayMap::CellType::WALL_POS;
+        }
+        const uint64_t tile = static_cast<uint64_t>(y >> m_header.tileShift) * m_header.tilesX + (x >> m_header.tileShift);
+        // Fast path: neighbouring cells are almost always in the same tile as previous access
+        if (tile != m_lastTile)
+        {
+            _switchTile(tile);
+        }
+        return static_cast<ArrayMap::CellType>(m_lastTileData[((y & m_tileMask) << m_header.tileShift) + (x & m_tileMask)]);
+    }
+
+    bool isPassable(int x, int y)
+    {
+        return getPoint(x, y) < ArrayMap::CellType::WALL_POS;
+    }
+
+    const Counters &getCounters() const { return m_counters; }
+
+    void resetCounters() { m_counters = Counters(); }
+
+private:
+    static constexpr int32_t NO_SLOT = -1;
+    static constexpr uint64_t NO_TILE = UINT64_MAX;
+
+    struct Header
+    {
+        char magic[8] = {0};
+        uint32_t version = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t tileShift = 0;
+        uint32_t tilesX = 0;
+        uint32_t tilesY = 0;
+    };
+
+    static Header _makeHeader(int width, int height, int tileShift)
+    {
+        Header header;
+        memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.width = width;
+        header.height = height;
+        header.tileShift = tileShift;
+        header.tilesX = (width + (1 << tileShift) - 1) >> tileShift;
+        header.tilesY = (height + (1 << tileShift) - 1) >> tileShift;
+        return header;
+    }
+
+    /**
+     * @brief Map size fits into int coordinates, tile grid covers exactly the map and every tile is in file.
+     * Otherwise getPoint would index tile table or file out of bounds
+     */
+    static bool _isValidGeometry(const Header &header, size_t dataSize)
+    {
+        const uint64_t tileSize = uint64_t(1) << header.tileShift;
+        if (header.width > INT32_MAX || header.height > INT32_MAX ||
+            header.tilesX != (header.width + tileSize - 1) >> header.tileShift ||
+            header.tilesY != (header.height + tileSize - 1) >> header.tileShift)
+        {
+            return false;
+        }
+        const uint64_t tileCount = static_cast<uint64_t>(header.tilesX) * header.tilesY;
+        return dataSize >= TILE_ALIGNMENT && tileCount <= (dataSize - TILE_ALIGNMENT) / _tileStride(header);
+    }
+
+    static size_t _tileStride(const Header &header)
+    {
+        const size_t tileBytes = size_t(1) << (2 * header.tileShift);
+        return (tileBytes + TILE_ALIGNMENT - 1) / TILE_ALIGNMENT * TILE_ALIGNMENT;
+    }
+
+    const uint8_t *_tileData(uint64_t tile) const
+    {
+        return m_data + TILE_ALIGNMENT + tile * _tileStride(m_header);
+    }
+
+    void _switchTile(uint64_t tile)
+    {
+        m_counters.tileSwitches++;
+        int32_t slot = m_tileSlot[tile];
+        if (slot == NO_SLOT)
+        {
+            slot = _loadTile(tile);
+        }
+        else
+        {
+            _unlink(slot);
+        }
+        _pushFront(slot);
+        m_lastTile = tile;
+        m_lastTileData = _tileData(tile);
+    }
+
+    int32_t _loadTile(uint64_t tile)
+    {
+        m_counters.tileFaults++;
+        int32_t slot;
+        if (!m_freeSlots.empty())
+        {
+            slot = m_freeSlots.back();
+            m_freeSlots.pop_back();
+        }
+        else
+        {
+            slot = m_lruTail;
+            _unlink(slot);
+            const uint64_t evicted = m_slotTile[slot];
+            m_tileSlot[evicted] = NO_SLOT;
+            if (m_canDropPages)
+            {
+                madvise(const_cast<uint8_t *>(_tileData(evicted)), _tileStride(m_header), MADV_DONTNEED);
+            }
+            m_counters.tileEvictions++;
+        }
+        m_slotTile[slot] = tile;
+        m_tileSlot[tile] = slot;
+        if (m_canDropPages)
+        {
+            madvise(const_cast<uint8_t *>(_tileData(tile)), _tileStride(m_header), MADV_WILLNEED);
+        }
+        return slot;
+    }
+
+    void _unlink(int32_t slot)
+    {
+        const int32_t prev = m_slotPrev[slot];
+        const int32_t next = m_slotNext[slot];
+        (prev != NO_SLOT ? m_slotNext[prev] : m_lruHead) = next;
+        (next != NO_SLOT ? m_slotPrev[next] : m_lruTail) = prev;
+    }
+
+    void _pushFront(int32_t slot)
+    {
+        m_slotPrev[slot] = NO_SLOT;
+        m_slotNext[slot] = m_lruHead;
+        (m_lruHead != NO_SLOT ? m_slotPrev[m_lruHead] : m_lruTail) = slot;
+        m_lruHead = slot;
+    }
+
+    const uint8_t *m_data = nullptr;
+    size_t m_dataSize = 0;
+    Header m_header;
+    uint32_t m_tileMask = 0;
+    bool m_canDropPages = false;
+
+    // Resident slot for every tile or NO_SLOT
+    std::vector<int32_t> m_tileSlot;
+    // LRU list of resident tiles over slots, head is most recently used
+    std::vector<uint64_t> m_slotTile;
+    std::vector<int32_t> m_slotPrev;
+    std::vector<int32_t> m_slotNext;
+    std::vector<int32_t> m_freeSlots;
+    int32_t m_lruHead = NO_SLOT;
+    int32_t m_lruTail = NO_SLOT;
+
+    uint64_t m_lastTile = NO_TILE;
+    const uint8_t *m_lastTileData = nullptr;
+
+    Counters m_counters;
+};
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+
+#include "AStarSearch.hpp"
+#include "TiledMap.hpp"
+
+/**
+ * @brief UserState for 4-connected search on TiledMap. Same moves and costs as MapSearchNode,
+ * but map is taken from the node so maps larger than memory can be searched.
+ * Tiles are loaded only when search frontier reaches them. Such map is too large for a table of all cells,
+ * so search finds nodes of a cell through a hash table of its 64-bit key
+ */
+class TiledMapSearchNode
+{
+public:
+    int x;
+    int y;
+    TiledMap *map;
+
+    TiledMapSearchNode() : x(0), y(0), map(nullptr) {}
+    TiledMapSearchNode(int px, int py, TiledMap *tiledMap) : x(px), y(py), map(tiledMap) {}
+
+    float goalDistanceEstimate(TiledMapSearchNode &nodeGoal)
+    {
+        return abs(x - nodeGoal.x) + abs(y - nodeGoal.y);
+    }
+
+    bool isGoal(TiledMapSearchNode &nodeGoal) const
+    {
+        return x == nodeGoal.x && y == nodeGoal.y;
+    }
+
+    bool getSuccessors(AStarSearch<TiledMapSearchNode> *astarsearch, TiledMapSearchNode *parent_node)
+    {
+        int parent_x = -1;
+        int parent_y = -1;
+
+        if (parent_node)
+        {
+            parent_x = parent_node->x;
+            parent_y = parent_node->y;
+        }
+
+        // Same order of moves as in MapSearchNode so both searches visit nodes in the same order
+        static constexpr int dx[4] = {-1, 0, 1, 0};
+        static constexpr int dy[4] = {0, -1, 0, 1};
+        TiledMapSearchNode NewNode;
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const int nx = x + dx[dir];
+            const int ny = y + dy[dir];
+            if (map->isPassable(nx, ny) && !(parent_x == nx && parent_y == ny))
+            {
+                NewNode = TiledMapSearchNode(nx, ny, map);
+                astarsearch->addSuccessor(NewNode);
+            }
+        }
+        return true;
+    }
+
+    float getCost(TiledMapSearchNode &successor) const
+    {
+        return (float)map->getPoint(x, y);
+    }
+
+    uint64_t getStateKey() const
+    {
+        return static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32 | static_cast<uint32_t>(x);
+    }
+
+    bool isSameState(TiledMapSearchNode &rhs) const
+    {
+        return x == rhs.x && y == rhs.y;
+    }
+};
@@ -0,0 +1,458 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "../src/AStarSearch.hpp"
+#include "../src/CompressedPathDatabase.hpp"
+#include "../src/ContractionHierarchy.hpp"
+#include "../src/CooperativePlanner.hpp"
+#include "../src/CsrGraphSearchNode.hpp"
+#include "../src/FixedGridSearchNode.hpp"
+#include "../src/GoalSet.hpp"
+#include "../src/MapGenerator.hpp"
+#include "../src/MapSearchNode.hpp"
+#include "../src/MultiGoalSearchNode.hpp"
+#include "../src/ParallelAStarSearch.hpp"
+#include "../src/RectangleSearch.hpp"
+#include "../src/ThetaStarSearch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <vector>
+
+// Performance regression suite. Maps and queries come from fixed seeds, so expansion counts are exact and
+// are compared with recorded baselines. Time budgets are several times above timings of an optimized build
+// on a single core VM; ASTAR_PERF_BUDGET_SCALE environment variable scales them for slower machines.
+// When a change lowers expansions or time on purpose, record the new numbers here.
+
+namespace
+{
+constexpr int MAP_SIZE = 48;
+constexpr size_t QUERY_COUNT = 12;
+
+struct MapCase
+{
+    MapGenerator::Kind kind;
+    ArrayMap::Connectivity connectivity;
+    uint64_t expansionBaseline; // total A* expansions of all queries
+};
+
+const std::vector<MapCase> MAP_CASES{
+    {MapGenerator::Kind::RANDOM, ArrayMap::Connectivity::FOUR, 2963},
+    {MapGenerator::Kind::RANDOM, ArrayMap::Connectivity::EIGHT, 3331},
+    {MapGenerator::Kind::MAZE, ArrayMap::Connectivity::FOUR, 5312},
+    {MapGenerator::Kind::MAZE, ArrayMap::Connectivity::EIGHT, 5441},
+    {MapGenerator::Kind::ROOMS, ArrayMap::Connectivity::FOUR, 393},
+    {MapGenerator::Kind::ROOMS, ArrayMap::Connectivity::EIGHT, 267},
+    {MapGenerator::Kind::TERRAIN, ArrayMap::Connectivity::FOUR, 8636},
+    {MapGenerator::Kind::TERRAIN, ArrayMap::Connectivity::EIGHT, 9081},
+};
+
+/**
+ * @brief Costs from one cell to all cells of ArrayMap with the moves and costs of MapSearchNode
+ */
+std::vector<double> dijkstra(int startX, int startY)
+{
+    const ArrayMap &map = ArrayMap::getInstance();
+    const int width = map.getWidth();
+    std::vector<double> distance(static_cast<size_t>(width) * map.getHeight(), INFINITY);
+    using Entry = std::pair<double, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    distance[startY * width + startX] = 0.0;
+    open.push({0.0, startY * width + startX});
+    while (!open.empty())
+    {
+        const Entry entry = open.top();
+        open.pop();
+        const int x = entry.second % width;
+        const int y = entry.second / width;
+        if (entry.first > distance[entry.second])
+        {
+            continue;
+        }
+        const unsigned int mask = map.getNeighborMask(x, y);
+        for (int dir = 0; dir < 8; ++dir)
+        {
+            if (!(mask & (1u << dir)))
+            {
+                continue;
+            }
+            const int neighbor = (y + ArrayMap::DIRECTION_DY[dir]) * width + x + ArrayMap::DIRECTION_DX[dir];
+            const double step = static_cast<double>(map.getPoint(x, y)) * (dir >= 4 ? MapSearchNode::DIAGONAL_COST : 1.0);
+            if (entry.first + step < distance[neighbor])
+            {
+                distance[neighbor] = entry.first + step;
+                open.push({distance[neighbor], neighbor});
+            }
+        }
+    }
+    return distance;
+}
+
+bool isClose(double cost, double expected)
+{
+    return std::fabs(cost - expected) <= 1e-4 * std::max(1.0, expected);
+}
+
+template <class NodeT>
+float pathCost(const std::deque<NodeT> &path)
+{
+    float cost = 0.0f;
+    for (size_t i = 1; i < path.size(); ++i)
+    {
+        NodeT next = path[i];
+        cost += path[i - 1].getCost(next);
+    }
+    return cost;
+}
+
+double budgetScale()
+{
+    const char *scale = getenv("ASTAR_PERF_BUDGET_SCALE");
+    return scale ? std::max(0.01, atof(scale)) : 1.0;
+}
+
+/**
+ * @brief Median wall time of a run in microseconds
+ *
+ * Catch2 BENCHMARK blocks only hand their estimates to the reporter and are skipped without benchmarking
+ * enabled, so budgets are checked on this separate measurement.
+ */
+double medianMicros(const std::function<void()> &run, int runs = 7)
+{
+    std::vector<double> times;
+    for (int i = 0; i < runs; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        run();
+        times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+void checkBudget(const char *name, double micros, double budgetMicros)
+{
+    INFO(name << ": " << micros << " us, budget " << budgetMicros * budgetScale() << " us");
+    CHECK(micros <= budgetMicros * budgetScale());
+}
+
+void buildGridGraph(CsrGraph &graph)
+{
+    const ArrayMap &map = ArrayMap::getInstance();
+    const int width = map.getWidth();
+    std::vector<CsrGraph::Edge> edges;
+    for (int y = 0; y < map.getHeight(); ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const unsigned int mask = map.getNeighborMask(x, y, ArrayMap::Connectivity::FOUR);
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                if (mask & (1u << dir))
+                {
+                    const int neighbor = (y + ArrayMap::DIRECTION_DY[dir]) * width + x + ArrayMap::DIRECTION_DX[dir];
+                    edges.push_back(CsrGraph::Edge{CsrGraph::VertexId(y * width + x), CsrGraph::VertexId(neighbor), uint32_t(map.getPoint(x, y))});
+                }
+            }
+        }
+    }
+    graph.assign(width * map.getHeight(), edges, {}, CsrGraph::CoordinateKind::NONE);
+}
+} // namespace
+
+TEST_CASE("Every engine matches reference Dijkstra cost on generated maps", "[engines]")
+{
+    using Grid = FixedGrid<MAP_SIZE, MAP_SIZE>;
+    ArrayMap &map = ArrayMap::getInstance();
+    for (const MapCase &mapCase : MAP_CASES)
+    {
+        MapGenerator generator(2024 + static_cast<uint64_t>(mapCase.kind));
+        const ArrayMap::ArrayT grid = generator.generate(mapCase.kind, MAP_SIZE, MAP_SIZE);
+        const auto queries = generator.queries(grid, QUERY_COUNT);
+        map.setMap(grid);
+        map.setConnectivity(mapCase.connectivity);
+        const bool isEight = mapCase.connectivity == ArrayMap::Connectivity::EIGHT;
+        const bool isUniform = mapCase.kind != MapGenerator::Kind::TERRAIN;
+
+        Grid fixedGrid;
+        REQUIRE(fixedGrid.assign(grid));
+        CompressedPathDatabase database;
+        database.build(1);
+        CsrGraph graph;
+        ContractionHierarchy hierarchy;
+        if (!isEight)
+        {
+            buildGridGraph(graph);
+            hierarchy.build(graph, 1);
+        }
+        ContractionHierarchy::Query chQuery(hierarchy);
+        RectangleMap rectangles;
+        rectangles.build(map);
+
+        for (const auto &query : queries)
+        {
+            INFO("map " << int(mapCase.kind) << (isEight ? " 8" : " 4") << "-connected, query "
+                        << query.startX << "," << query.startY << " -> " << query.goalX << "," << query.goalY);
+            const double expected = dijkstra(query.startX, query.startY)[query.goalY * MAP_SIZE + query.goalX];
+            REQUIRE(std::isfinite(expected));
+            MapSearchNode nodeStart(query.startX, query.startY);
+            MapSearchNode nodeGoal(query.goalX, query.goalY);
+
+            AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+            REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+            CHECK(isClose(astarsearch.getSolutionCost(), expected));
+            CHECK(isClose(pathCost(astarsearch.linearizeSolution()), expected));
+
+            AStarSearch<MapSearchNode> limited(nodeStart, nodeGoal);
+            limited.setNodeLimit(astarsearch.getPeakNodeCount() / 2 + 16);
+            REQUIRE(limited.preformSearch() == SearchState::SUCCEEDED);
+            CHECK(isClose(limited.getSolutionCost(), expected));
+
+            ParallelAStarSearch parallel(nodeStart, nodeGoal, 2);
+            REQUIRE(parallel.preformSearch() == SearchState::SUCCEEDED);
+            CHECK(isClose(parallel.getSolutionCost(), expected));
+
+            std::deque<MapSearchNode> databasePath;
+            REQUIRE(database.findPath(nodeStart, nodeGoal, databasePath));
+            CHECK(isClose(pathCost(databasePath), expected));
+
+            RectangleSearch rectangleSearch(rectangles, nodeStart, nodeGoal);
+            REQUIRE(rectangleSearch.preformSearch() == SearchState::SUCCEEDED);
+            CHECK(isClose(rectangleSearch.getSolutionCost(), expected));
+            CHECK(isClose(pathCost(rectangleSearch.linearizeSolution()), expected));
+
+            GoalSet goals(MAP_SIZE, MAP_SIZE);
+            goals.add(query.goalX, query.goalY);
+            const auto nearest = MultiGoalSearchNode::findNearest(query.startX, query.startY, goals, 1);
+            REQUIRE(nearest.size() == 1);
+            CHECK(isClose(nearest.front().cost, expected));
+
+            float fixedCost;
+            if (isEight)
+            {
+                using Node = FixedGridSearchNode<Grid, ArrayMap::Connectivity::EIGHT>;
+                Node fixedStart(query.startX, query.startY, &fixedGrid);
+                Node fixedGoal(query.goalX, query.goalY, &fixedGrid);
+                AStarSearch<Node> fixedSearch(fixedStart, fixedGoal);
+                REQUIRE(fixedSearch.preformSearch() == SearchState::SUCCEEDED);
+                fixedCost = fixedSearch.getSolutionCost();
+            }
+            else
+            {
+                using Node = FixedGridSearchNode<Grid, ArrayMap::Connectivity::FOUR>;
+                Node fixedStart(query.startX, query.startY, &fixedGrid);
+                Node fixedGoal(query.goalX, query.goalY, &fixedGrid);
+                AStarSearch<Node> fixedSearch(fixedStart, fixedGoal);
+                REQUIRE(fixedSearch.preformSearch() == SearchState::SUCCEEDED);
+                fixedCost = fixedSearch.getSolutionCost();
+
+                // Integer weights of 4-connected map are exact in graph engines
+                const CsrGraph::VertexId source = query.startY * MAP_SIZE + query.startX;
+                const CsrGraph::VertexId target = query.goalY * MAP_SIZE + query.goalX;
+                CHECK(chQuery.findPath(source, target) == static_cast<uint64_t>(std::lround(expected)));
+                CsrGraphSearchNode graphStart(source, &graph);
+                CsrGraphSearchNode graphGoal(target, &graph);
+                AStarSearch<CsrGraphSearchNode> graphSearch(graphStart, graphGoal);
+                REQUIRE(graphSearch.preformSearch() == SearchState::SUCCEEDED);
+                CHECK(isClose(graphSearch.getSolutionCost(), expected));
+            }
+            CHECK(isClose(fixedCost, expected));
+
+            // Any-angle paths are never longer than grid paths and never shorter than straight line
+            if (isEight && isUniform)
+            {
+                for (auto mode : {ThetaStarSearch::Mode::THETA, ThetaStarSearch::Mode::LAZY_THETA})
+                {
+                    ThetaStarSearch theta(nodeStart, nodeGoal, mode);
+                    REQUIRE(theta.preformSearch() == SearchState::SUCCEEDED);
+                    CHECK(theta.getSolutionCost() <= expected + 1e-3);
+                    CHECK(theta.getSolutionCost() >= std::hypot(query.goalX - query.startX, query.goalY - query.startY) - 1e-3);
+                }
+            }
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+}
+
+TEST_CASE("A* expansions stay within recorded baselines", "[expansions]")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    for (const MapCase &mapCase : MAP_CASES)
+    {
+        MapGenerator generator(2024 + static_cast<uint64_t>(mapCase.kind));
+        const ArrayMap::ArrayT grid = generator.generate(mapCase.kind, MAP_SIZE, MAP_SIZE);
+        const auto queries = generator.queries(grid, QUERY_COUNT);
+        map.setMap(grid);
+        map.setConnectivity(mapCase.connectivity);
+
+        uint64_t expansions = 0;
+        for (const auto &query : queries)
+        {
+            MapSearchNode nodeStart(query.startX, query.startY);
+            MapSearchNode nodeGoal(query.goalX, query.goalY);
+            AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+            REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+            expansions += astarsearch.getStepCount();
+        }
+        INFO("map " << int(mapCase.kind) << (mapCase.connectivity == ArrayMap::Connectivity::EIGHT ? " 8" : " 4")
+                    << "-connected: " << expansions << " expansions, baseline " << mapCase.expansionBaseline);
+        CHECK(expansions <= mapCase.expansionBaseline);
+        if (expansions < mapCase.expansionBaseline)
+        {
+            WARN("expansions dropped below baseline, record the new value");
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+}
+
+TEST_CASE("Micro-benchmarks stay within time budgets", "[benchmark]")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    MapGenerator generator(99);
+    const ArrayMap::ArrayT rooms = generator.generate(MapGenerator::Kind::ROOMS, 64, 64);
+    // The longest of a few queries, so search crosses several rooms
+    const auto candidates = generator.queries(rooms, 16);
+    const auto query = *std::max_element(candidates.begin(), candidates.end(), [](const auto &lhs, const auto &rhs)
+                                         { return abs(lhs.goalX - lhs.startX) + abs(lhs.goalY - lhs.startY) <
+                                                  abs(rhs.goalX - rhs.startX) + abs(rhs.goalY - rhs.startY); });
+    map.setMap(rooms);
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    MapSearchNode nodeStart(query.startX, query.startY);
+    MapSearchNode nodeGoal(query.goalX, query.goalY);
+
+    const auto astarQuery = [&]()
+    {
+        AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        return astarsearch.preformSearch();
+    };
+    const auto goalSetQuery = [&]()
+    {
+        GoalSet goals(64, 64);
+        for (int i = 0; i < 64; ++i)
+        {
+            goals.add((i * 37) % 64, (i * 11) % 64);
+        }
+        return MultiGoalSearchNode::findNearest(query.startX, query.startY, goals, 4).size();
+    };
+    const auto componentUpdate = [&]()
+    {
+        map.setLogicalCell(query.goalX, query.goalY, ArrayMap::CellType::WALL_POS);
+        map.setLogicalCell(query.goalX, query.goalY, ArrayMap::CellType::EMPTY_POS);
+        return map.getComponentSize(query.goalX, query.goalY);
+    };
+
+    BENCHMARK("A* rooms 64x64 query")
+    {
+        return astarQuery();
+    };
+    BENCHMARK("k-nearest of 64 goals")
+    {
+        return goalSetQuery();
+    };
+    BENCHMARK("wall toggle with component update")
+    {
+        return componentUpdate();
+    };
+
+    // Budgets are about 4 times above medians of an optimized build
+    checkBudget("A* rooms 64x64 query", medianMicros(astarQuery), 600.0);
+    checkBudget("k-nearest of 64 goals", medianMicros(goalSetQuery), 250.0);
+    const auto hundredUpdates = [&]()
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            componentUpdate();
+        }
+    };
+    checkBudget("100 wall toggles with component update", medianMicros(hundredUpdates), 200.0);
+}
+
+TEST_CASE("Contraction hierarchy builds a 128x128 terrain graph within budget", "[benchmark]")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    MapGenerator generator(7);
+    const ArrayMap::ArrayT grid = generator.generate(MapGenerator::Kind::TERRAIN, 128, 128);
+    map.setMap(grid);
+    CsrGraph graph;
+    buildGridGraph(graph);
+
+    ContractionHierarchy hierarchy;
+    hierarchy.build(graph, 1);
+    const ContractionHierarchy::Stats &stats = hierarchy.getStats();
+    INFO(stats.rounds << " rounds, " << stats.shortcuts << " shortcuts");
+    // Shortcuts of a planar graph stay a small multiple of its vertices, denser hierarchy makes build superlinear
+    CHECK(stats.shortcuts < 12 * graph.getVertexCount());
+    checkBudget("CH build of 128x128 terrain graph", stats.seconds * 1e6, 14e6);
+
+    ContractionHierarchy::Query query(hierarchy);
+    size_t settled = 0;
+    for (const auto &mapQuery : generator.queries(grid, 50))
+    {
+        query.findPath(mapQuery.startY * 128 + mapQuery.startX, mapQuery.goalY * 128 + mapQuery.goalX);
+        settled += query.getSettledCount();
+    }
+    CHECK(settled < 50 * 2000);
+}
+
+TEST_CASE("Cooperative planner plans 200 agents on 64x64 rooms within budget", "[benchmark]")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    MapGenerator generator(5);
+    const ArrayMap::ArrayT rooms = generator.generate(MapGenerator::Kind::ROOMS, 64, 64);
+    map.setMap(rooms);
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    const size_t agentCount = 200;
+    CooperativePlanner planner(16, 8);
+    for (const auto &query : generator.queries(rooms, agentCount))
+    {
+        planner.addAgent(MapSearchNode(query.startX, query.startY), MapSearchNode(query.goalX, query.goalY));
+    }
+    for (int tick = 0; tick < 400 && !planner.isAllArrived(); ++tick)
+    {
+        planner.tick();
+    }
+    const CooperativePlanner::Stats &stats = planner.getStats();
+    REQUIRE(stats.replans > 0);
+    // Every replan plans all agents for the next window, each plan is one windowed space-time A*
+    const double microsPerAgent = stats.planningSeconds * 1e6 / (double(stats.replans) * agentCount);
+    INFO(stats.replans << " replans, " << stats.expandedNodes << " expansions, " << microsPerAgent << " us per agent plan");
+    checkBudget("cooperative plan of one agent", microsPerAgent, 200.0);
+}
+
+TEST_CASE("A* time per expansion stays flat from 64x64 to 256x256", "[benchmark]")
+{
+    // Open and closed list costs should grow with log of their size at most, so a 16 times larger map
+    // may cost somewhat more per expansion but never anywhere near 16 times
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    double microsPerExpansion[2] = {};
+    const int sides[2] = {64, 256};
+    for (int i = 0; i < 2; ++i)
+    {
+        MapGenerator generator(99);
+        const ArrayMap::ArrayT rooms = generator.generate(MapGenerator::Kind::ROOMS, sides[i], sides[i]);
+        const auto candidates = generator.queries(rooms, 16);
+        const auto query = *std::max_element(candidates.begin(), candidates.end(), [](const auto &lhs, const auto &rhs)
+                                             { return abs(lhs.goalX - lhs.startX) + abs(lhs.goalY - lhs.startY) <
+                                                      abs(rhs.goalX - rhs.startX) + abs(rhs.goalY - rhs.startY); });
+        map.setMap(rooms);
+        MapSearchNode nodeStart(query.startX, query.startY);
+        MapSearchNode nodeGoal(query.goalX, query.goalY);
+        int expansions = 0;
+        const double micros = medianMicros([&]()
+                                           {
+                                               AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+                                               REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+                                               expansions = astarsearch.getStepCount(); });
+        microsPerExpansion[i] = micros / expansions;
+        INFO(sides[i] << "x" << sides[i] << ": " << expansions << " expansions in " << micros << " us");
+        CHECK(expansions > 0);
+    }
+    INFO("64x64: " << microsPerExpansion[0] << " us per expansion, 256x256: " << microsPerExpansion[1]);
+    CHECK(microsPerExpansion[1] <= 3.0 * microsPerExpansion[0]);
+}
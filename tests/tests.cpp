@@ -2,8 +2,36 @@
 
 #include "../src/MapSearchNode.hpp"
 #include "../src/AStarSearch.hpp"
+#include "../src/CompressedPathDatabase.hpp"
+#include "../src/ConsoleFrontend.hpp"
+#include "../src/ContractionHierarchy.hpp"
+#include "../src/CooperativePlanner.hpp"
+#include "../src/CsrGraphSearchNode.hpp"
+#include "../src/FixedGridSearchNode.hpp"
+#include "../src/GoalSet.hpp"
+#include "../src/IndexSnapshot.hpp"
+#include "../src/MapGenerator.hpp"
+#include "../src/MapIO.hpp"
+#include "../src/MultiGoalSearchNode.hpp"
+#include "../src/ParallelAStarSearch.hpp"
+#include "../src/PathClient.hpp"
+#include "../src/PathServer.hpp"
+#include "../src/RectangleSearch.hpp"
+#include "../src/ReservationTable.hpp"
+#include "../src/SearchEventStream.hpp"
+#include "../src/SpscRingBuffer.hpp"
+#include "../src/ThetaStarSearch.hpp"
+#include "../src/TiledMapSearchNode.hpp"
+#include "../src/Trace.hpp"
 
 #include <iostream>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
 
 // Current implementation dosent' allow to change map
 // If any changes occurs in map then all tests will be invalid
@@ -86,12 +114,8 @@ TEST_CASE("Simple search test for A* algorithm with non-existing solution")
         {1, 1, 1, 1},
         {1, 1, 1, 1}};
 
-    std::vector<std::vector<int>> expectedVisitedNodes{
-        {0, 0},
-        {1, 0},
-        {2, 0},
-        {3, 0},
-    };
+    // Goal is in other connected component, so search fails without expanding any node
+    std::vector<std::vector<int>> expectedVisitedNodes{};
 
     size_t expectedVisitedSize = expectedVisitedNodes.size();
 
@@ -120,3 +144,1682 @@ TEST_CASE("Simple search test for A* algorithm with non-existing solution")
         CHECK(visitedNodes[i].y == expectedVisitedNodes[i][1]);
     }
 }
+
+TEST_CASE("Neighbor mask is updated when logical cell changes")
+{
+    std::vector<std::vector<int>> mockMap{
+        {1, 1, 1},
+        {1, 1, 1},
+        {1, 1, 1}};
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(mockMap);
+    map.setConnectivity(ArrayMap::Connectivity::EIGHT);
+
+    REQUIRE(map.getNeighborMask(1, 1) == 0xFF);
+    // Corner cell has only east, south and south-east neighbours
+    CHECK(map.getNeighborMask(0, 0) == (ArrayMap::directionBit(1, 0) | ArrayMap::directionBit(0, 1) | ArrayMap::directionBit(1, 1)));
+
+    // Wall to the north closes north move and both diagonals next to it
+    map.setLogicalCell(1, 0, ArrayMap::CellType::WALL_POS);
+    CHECK(map.getNeighborMask(1, 1) == (0xFF & ~(ArrayMap::directionBit(0, -1) | ArrayMap::directionBit(-1, -1) | ArrayMap::directionBit(1, -1))));
+    CHECK(map.getNeighborMask(0, 0) == ArrayMap::directionBit(0, 1));
+
+    map.setLogicalCell(1, 0, ArrayMap::CellType::EMPTY_POS);
+    CHECK(map.getNeighborMask(1, 1) == 0xFF);
+
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    CHECK(map.getNeighborMask(1, 1) == ArrayMap::ORTHOGONAL_MASK);
+
+    // Cells outside the map are walls without neighbours
+    CHECK(map.getNeighborMask(-1, 0) == 0);
+    CHECK(map.getNeighborMask(3, 1) == 0);
+    CHECK(map.getNeighborMask(1, 3, ArrayMap::Connectivity::EIGHT) == 0);
+}
+
+TEST_CASE("Search on 8-connected grid with octile heuristic")
+{
+    std::vector<std::vector<int>> mockMap{
+        {1, 1, 1, 1},
+        {1, 1, 9, 1},
+        {1, 1, 1, 1},
+        {1, 1, 1, 1}};
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(mockMap);
+    map.setConnectivity(ArrayMap::Connectivity::EIGHT);
+
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(3, 3);
+    AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+    SearchState searchResult = astarsearch.preformSearch();
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+
+    REQUIRE(searchResult == SearchState::SUCCEEDED);
+
+    // Wall at (2, 1) forbids cutting its corners so path needs two diagonal and two straight moves
+    auto solutionNodes = astarsearch.linearizeSolution();
+    CHECK(solutionNodes.size() == 5);
+    CHECK(std::fabs(astarsearch.getSolutionCost() - (2.0f + 2.0f * MapSearchNode::DIAGONAL_COST)) < 1e-4f);
+    for (size_t i = 1; i < solutionNodes.size(); ++i)
+    {
+        CHECK(abs(solutionNodes[i].x - solutionNodes[i - 1].x) <= 1);
+        CHECK(abs(solutionNodes[i].y - solutionNodes[i - 1].y) <= 1);
+        CHECK(map.getPoint(solutionNodes[i].x, solutionNodes[i].y) == ArrayMap::CellType::EMPTY_POS);
+    }
+}
+
+TEST_CASE("SPSC ring buffer keeps order between threads and rejects items when full")
+{
+    SpscRingBuffer<int> queue(5);
+    REQUIRE(queue.capacity() == 8);
+
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(queue.tryPush(i));
+    }
+    CHECK_FALSE(queue.tryPush(8));
+
+    int item = -1;
+    for (int i = 0; i < 8; ++i)
+    {
+        REQUIRE(queue.tryPop(item));
+        CHECK(item == i);
+    }
+    CHECK_FALSE(queue.tryPop(item));
+
+    const int itemCount = 100000;
+    std::thread producer([&queue]()
+                         {
+        for (int i = 0; i < itemCount; ++i)
+        {
+            while (!queue.tryPush(i))
+            {
+                std::this_thread::yield();
+            }
+        } });
+
+    bool isOrdered = true;
+    for (int expected = 0; expected < itemCount;)
+    {
+        if (queue.tryPop(item))
+        {
+            isOrdered = isOrdered && item == expected;
+            expected++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    CHECK(isOrdered);
+}
+
+TEST_CASE("Search event stream receives every expanded node and counts dropped events")
+{
+    std::vector<std::vector<int>> mockMap{
+        {1, 1, 1, 1},
+        {1, 9, 9, 9},
+        {1, 1, 1, 1},
+        {1, 1, 1, 1}};
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(mockMap);
+
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(3, 3);
+
+    {
+        AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        SearchEventStream stream;
+        astarsearch.setObserver(&stream);
+        REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+
+        REQUIRE(stream.isFinished());
+        CHECK(stream.getResult() == SearchState::SUCCEEDED);
+        CHECK(stream.getDroppedCount() == 0);
+        CHECK(stream.getSolution().size() == astarsearch.linearizeSolution().size());
+
+        auto visitedNodes = astarsearch.getVisitedNodes();
+        size_t expandIndex = 0;
+        SearchEvent event;
+        while (stream.poll(event))
+        {
+            if (event.type == SearchEvent::Type::EXPAND)
+            {
+                REQUIRE(expandIndex < visitedNodes.size());
+                CHECK(event.x == visitedNodes[expandIndex].x);
+                CHECK(event.y == visitedNodes[expandIndex].y);
+                expandIndex++;
+            }
+        }
+        CHECK(expandIndex == visitedNodes.size());
+    }
+
+    {
+        // Nobody drains this stream so search has to go on and drop the rest
+        AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        SearchEventStream stream(4);
+        astarsearch.setObserver(&stream);
+        REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+
+        CHECK(stream.getDroppedCount() == stream.getPublishedCount() - 4);
+        CHECK(stream.getSolution().size() == astarsearch.linearizeSolution().size());
+    }
+}
+
+TEST_CASE("Console frontend renders viewport and downsampled overview")
+{
+    std::vector<std::vector<int>> mockMap{
+        {1, 1, 9, 9},
+        {1, 1, 9, 9},
+        {1, 1, 1, 9},
+        {1, 1, 1, 1}};
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(mockMap);
+    map.setCell(0, 0, ArrayMap::CellType::START_POS);
+    map.setCell(1, 1, ArrayMap::CellType::PATH_POS);
+
+    ConsoleFrontend frontend;
+    CHECK(frontend.renderFrame(map, ConsoleFrontend::fullViewport(map), 1) == "|s XX|\n| *XX|\n|   X|\n|    |\n");
+    CHECK(frontend.renderFrame(map, ConsoleFrontend::Viewport{1, 1, 2, 2}, 1) == "|*X|\n|  |\n");
+    // 2x2 blocks: start wins over path, full wall block stays wall, single wall in block is hidden
+    CHECK(frontend.renderFrame(map, ConsoleFrontend::fullViewport(map), 2) == "|sX|\n|  |\n");
+    // Block size below 1 is rendered as 1
+    CHECK(frontend.renderFrame(map, ConsoleFrontend::Viewport{1, 1, 2, 2}, 0) == "|*X|\n|  |\n");
+    CHECK(frontend.renderFrame(map, ConsoleFrontend::Viewport{1, 1, 2, 2}, -3) == "|*X|\n|  |\n");
+
+    std::deque<MapSearchNode> path{MapSearchNode(1, 1), MapSearchNode(2, 2)};
+    auto viewport = ConsoleFrontend::pathViewport(map, path, 1);
+    CHECK(viewport.left == 0);
+    CHECK(viewport.top == 0);
+    CHECK(viewport.width == 4);
+    CHECK(viewport.height == 4);
+}
+
+TEST_CASE("Map loading from integer rows and MovingAI format")
+{
+    ArrayMap::ArrayT grid;
+    std::string error;
+
+    std::istringstream rows("\n1 1 9\n9 1 1\n");
+    REQUIRE(MapIO::load(rows, grid, error));
+    CHECK(grid == ArrayMap::ArrayT{{1, 1, 9}, {9, 1, 1}});
+
+    std::istringstream movingAI("type octile\nheight 2\nwidth 3\nmap\n..@\nT.G\n");
+    REQUIRE(MapIO::load(movingAI, grid, error));
+    CHECK(grid == ArrayMap::ArrayT{{1, 1, 9}, {9, 1, 1}});
+
+    std::ostringstream saved;
+    MapIO::saveMovingAI(saved, grid);
+    CHECK(saved.str() == "type octile\nheight 2\nwidth 3\nmap\n..@\n@..\n");
+
+    std::istringstream broken("1 1 1\n1 1\n");
+    CHECK_FALSE(MapIO::load(broken, grid, error));
+    CHECK_FALSE(error.empty());
+}
+
+TEST_CASE("Grid line of sight does not cross walls or cut corners")
+{
+    std::vector<std::vector<int>> mockMap{
+        {1, 1, 1, 1},
+        {1, 9, 1, 1},
+        {1, 1, 1, 1},
+        {1, 1, 1, 1}};
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(mockMap);
+
+    CHECK(ThetaStarSearch::lineOfSight(map, 0, 0, 3, 0));
+    CHECK(ThetaStarSearch::lineOfSight(map, 0, 3, 3, 1));
+    CHECK(ThetaStarSearch::lineOfSight(map, 2, 2, 2, 2));
+    CHECK_FALSE(ThetaStarSearch::lineOfSight(map, 0, 0, 3, 3));
+    CHECK_FALSE(ThetaStarSearch::lineOfSight(map, 1, 0, 1, 3));
+    // Touches only corner of the wall but corner cutting is not allowed
+    CHECK_FALSE(ThetaStarSearch::lineOfSight(map, 0, 2, 2, 0));
+    CHECK_FALSE(ThetaStarSearch::lineOfSight(map, 2, 0, 0, 2));
+}
+
+TEST_CASE("Theta* finds shorter any-angle paths with fewer waypoints than A*")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    map.reset();
+    map.setConnectivity(ArrayMap::Connectivity::EIGHT);
+
+    const std::vector<std::vector<int>> queries{{0, 0, 19, 19}, {19, 0, 0, 19}, {3, 2, 18, 19}, {0, 19, 19, 5}};
+    for (const auto &query : queries)
+    {
+        MapSearchNode nodeStart(query[0], query[1]);
+        MapSearchNode nodeGoal(query[2], query[3]);
+
+        AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+
+        ThetaStarSearch theta(nodeStart, nodeGoal);
+        REQUIRE(theta.preformSearch() == SearchState::SUCCEEDED);
+        ThetaStarSearch lazyTheta(nodeStart, nodeGoal, ThetaStarSearch::Mode::LAZY_THETA);
+        REQUIRE(lazyTheta.preformSearch() == SearchState::SUCCEEDED);
+
+        CHECK(theta.getSolutionCost() <= astarsearch.getSolutionCost() + 1e-4f);
+        CHECK(lazyTheta.getSolutionCost() <= astarsearch.getSolutionCost() + 1e-4f);
+        CHECK(theta.linearizeSolution().size() < astarsearch.linearizeSolution().size());
+        CHECK(lazyTheta.getLineOfSightCount() < theta.getLineOfSightCount());
+
+        for (const auto *search : {&theta, &lazyTheta})
+        {
+            auto waypoints = search->linearizeSolution();
+            REQUIRE(waypoints.size() >= 2);
+            CHECK(waypoints.front().isSameState(nodeStart));
+            CHECK(waypoints.back().isSameState(nodeGoal));
+            float length = 0.0f;
+            for (size_t i = 1; i < waypoints.size(); ++i)
+            {
+                CHECK(ThetaStarSearch::lineOfSight(map, waypoints[i - 1].x, waypoints[i - 1].y, waypoints[i].x, waypoints[i].y));
+                length += std::hypot(float(waypoints[i].x - waypoints[i - 1].x), float(waypoints[i].y - waypoints[i - 1].y));
+            }
+            CHECK(std::fabs(length - search->getSolutionCost()) < 1e-3f);
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+
+    // Straight line on open map is a single segment
+    map.setMap(ArrayMap::ArrayT(6, std::vector<int>(10, 1)));
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(9, 5);
+    ThetaStarSearch theta(nodeStart, nodeGoal);
+    REQUIRE(theta.preformSearch() == SearchState::SUCCEEDED);
+    CHECK(theta.linearizeSolution().size() == 2);
+    CHECK(std::fabs(theta.getSolutionCost() - std::sqrt(106.0f)) < 1e-4f);
+}
+
+TEST_CASE("Reservation table stores agents per cell and time and clears in O(1)")
+{
+    ReservationTable table(2);
+    for (int t = 0; t < 100; ++t)
+    {
+        table.reserve(t * 7, t, t % 5);
+    }
+    CHECK(table.size() == 100);
+    CHECK(table.getAgent(7 * 42, 42) == 2);
+    CHECK(table.getAgent(7 * 42, 43) == ReservationTable::NO_AGENT);
+
+    table.clear();
+    CHECK(table.size() == 0);
+    CHECK(table.getAgent(7 * 42, 42) == ReservationTable::NO_AGENT);
+    table.reserve(5, 1, 3);
+    CHECK(table.getAgent(5, 1) == 3);
+}
+
+TEST_CASE("Cooperative planner moves crossing agents to goals without collisions")
+{
+    ArrayMap::ArrayT grid(12, std::vector<int>(12, 1));
+    // Wall in the middle with two gaps makes agents compete for narrow passages
+    for (int y = 0; y < 12; ++y)
+    {
+        if (y != 3 && y != 8)
+        {
+            grid[y][6] = 9;
+        }
+    }
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(grid);
+
+    CooperativePlanner planner(16, 4);
+    const int agentCount = 10;
+    for (int i = 0; i < agentCount; ++i)
+    {
+        // Agents on the left go to the right in reversed row order so all paths cross
+        planner.addAgent(MapSearchNode(0, i), MapSearchNode(11 - i % 2, agentCount - 1 - i));
+    }
+    CHECK(planner.getHeuristicTableCount() == agentCount);
+
+    // Agents with the same goal share true distance table
+    CooperativePlanner sharedGoalPlanner;
+    sharedGoalPlanner.addAgent(MapSearchNode(0, 0), MapSearchNode(11, 11));
+    sharedGoalPlanner.addAgent(MapSearchNode(0, 1), MapSearchNode(11, 11));
+    CHECK(sharedGoalPlanner.getHeuristicTableCount() == 1);
+
+    for (int tick = 0; tick < 100 && !planner.isAllArrived(); ++tick)
+    {
+        std::vector<MapSearchNode> previous;
+        for (int i = 0; i < agentCount; ++i)
+        {
+            previous.push_back(planner.getPosition(i));
+        }
+        planner.tick();
+        for (int i = 0; i < agentCount; ++i)
+        {
+            const MapSearchNode &position = planner.getPosition(i);
+            REQUIRE(map.isPassable(position.x, position.y));
+            REQUIRE(std::abs(position.x - previous[i].x) + std::abs(position.y - previous[i].y) <= 1);
+            for (int j = i + 1; j < agentCount; ++j)
+            {
+                const MapSearchNode &other = planner.getPosition(j);
+                // Same cell or swapped places
+                REQUIRE_FALSE((position.x == other.x && position.y == other.y));
+                REQUIRE_FALSE((position.x == previous[j].x && position.y == previous[j].y &&
+                               other.x == previous[i].x && other.y == previous[i].y));
+            }
+        }
+    }
+    CHECK(planner.isAllArrived());
+    CHECK(planner.getStats().replans > 1);
+    CHECK(planner.getStats().failedPlans == 0);
+}
+
+TEST_CASE("Tiled map loads only tiles reached by search")
+{
+    ArrayMap::ArrayT grid(70, std::vector<int>(100, 1));
+    for (int x = 10; x < 90; ++x)
+    {
+        grid[35][x] = 9;
+    }
+    const std::string path = (std::filesystem::temp_directory_path() / "astar-tiled-map-test.tiles").string();
+    std::string error;
+    REQUIRE(TiledMap::writeFile(path, grid, 4, error));
+
+    TiledMap tiledMap;
+    REQUIRE(tiledMap.open(path, 4, error));
+    CHECK(tiledMap.getWidth() == 100);
+    CHECK(tiledMap.getHeight() == 70);
+    CHECK(tiledMap.getTileCount() == 7 * 5);
+    CHECK(tiledMap.getPoint(50, 35) == ArrayMap::CellType::WALL_POS);
+    CHECK(tiledMap.getPoint(50, 36) == ArrayMap::CellType::EMPTY_POS);
+    CHECK(tiledMap.getPoint(100, 0) == ArrayMap::CellType::WALL_POS);
+    tiledMap.resetCounters();
+
+    {
+        // Short query inside one tile
+        TiledMapSearchNode nodeStart(2, 2, &tiledMap);
+        TiledMapSearchNode nodeGoal(12, 10, &tiledMap);
+        AStarSearch<TiledMapSearchNode> astarsearch(nodeStart, nodeGoal);
+        REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(tiledMap.getCounters().tileFaults <= 2);
+    }
+
+    {
+        // Long query has to go around the wall, cache of 4 tiles is too small for it
+        tiledMap.resetCounters();
+        TiledMapSearchNode nodeStart(50, 20, &tiledMap);
+        TiledMapSearchNode nodeGoal(50, 50, &tiledMap);
+        AStarSearch<TiledMapSearchNode> tiledSearch(nodeStart, nodeGoal);
+        REQUIRE(tiledSearch.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(tiledMap.getCounters().tileFaults > 4);
+        CHECK(tiledMap.getCounters().tileEvictions > 0);
+        CHECK(tiledMap.getResidentTileCount() == 4);
+
+        ArrayMap::getInstance().setMap(grid);
+        MapSearchNode arrayStart(50, 20);
+        MapSearchNode arrayGoal(50, 50);
+        AStarSearch<MapSearchNode> arraySearch(arrayStart, arrayGoal);
+        REQUIRE(arraySearch.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(tiledSearch.getSolutionCost() == arraySearch.getSolutionCost());
+        CHECK(tiledSearch.getStepCount() == arraySearch.getStepCount());
+
+        // Nodes and records of forgotten children are found by 64-bit cell key
+        static_assert(detail::HasStateKey<TiledMapSearchNode>::value, "tiled cells are looked up in hash table");
+        AStarSearch<TiledMapSearchNode> limitedSearch(nodeStart, nodeGoal);
+        limitedSearch.setNodeLimit(tiledSearch.getPeakNodeCount() / 2);
+        REQUIRE(limitedSearch.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(limitedSearch.getPrunedNodeCount() > 0);
+        CHECK(limitedSearch.getSolutionCost() == arraySearch.getSolutionCost());
+    }
+
+    tiledMap.close();
+
+    // Header whose size doesn't match its tile grid is rejected, getPoint would read out of tile table
+    for (const uint32_t width : {uint32_t(1000), uint32_t(0x80000000u)})
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(12); // magic and version go before width
+        file.write(reinterpret_cast<const char *>(&width), sizeof(width));
+        file.close();
+        CHECK_FALSE(tiledMap.open(path, 4, error));
+        CHECK(tiledMap.getWidth() == 0);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Search with integer costs keeps compact nodes and finds the same solution")
+{
+    static_assert(AStarSearch<MapSearchNode, int>::NODE_SEARCH_DATA_SIZE == 12, "two costs and parent index");
+    static_assert(AStarSearch<MapSearchNode, uint16_t>::NODE_SEARCH_DATA_SIZE == 8, "two costs and parent index");
+    static_assert(AStarSearch<MapSearchNode, int>::getBytesPerNode() == 32, "state, search data and list bookkeeping");
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.reset();
+
+    const std::vector<std::vector<int>> queries{{0, 0, 19, 19}, {19, 0, 0, 19}, {3, 2, 18, 19}, {5, 5, 5, 5}};
+    for (const auto &query : queries)
+    {
+        MapSearchNode nodeStart(query[0], query[1]);
+        MapSearchNode nodeGoal(query[2], query[3]);
+        AStarSearch<MapSearchNode> floatSearch(nodeStart, nodeGoal);
+        AStarSearch<MapSearchNode, int> intSearch(nodeStart, nodeGoal);
+        REQUIRE(floatSearch.preformSearch() == SearchState::SUCCEEDED);
+        REQUIRE(intSearch.preformSearch() == SearchState::SUCCEEDED);
+
+        CHECK(intSearch.getSolutionCost() == floatSearch.getSolutionCost());
+        CHECK(intSearch.getStepCount() == floatSearch.getStepCount());
+        // Freed duplicates are reused so pool doesn't grow with every generated successor
+        CHECK(intSearch.getAllocatedNodeCount() <= 2 * (intSearch.getStepCount() + 2));
+
+        auto intSolution = intSearch.linearizeSolution();
+        auto floatSolution = floatSearch.linearizeSolution();
+        REQUIRE(intSolution.size() == floatSolution.size());
+        CHECK(intSolution.front().isSameState(nodeStart));
+        CHECK(intSolution.back().isSameState(nodeGoal));
+        for (size_t i = 0; i < intSolution.size(); ++i)
+        {
+            CHECK(intSolution[i].isSameState(floatSolution[i]));
+        }
+    }
+
+    // Diagonal moves cost a fraction, integer costs would truncate them
+    map.setMap(ArrayMap::ArrayT(20, std::vector<int>(20, 1)));
+    map.setConnectivity(ArrayMap::Connectivity::EIGHT);
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(19, 19);
+    AStarSearch<MapSearchNode> floatSearch(nodeStart, nodeGoal);
+    REQUIRE(floatSearch.preformSearch() == SearchState::SUCCEEDED);
+    CHECK(std::fabs(floatSearch.getSolutionCost() - 19 * MapSearchNode::DIAGONAL_COST) < 1e-3f);
+    auto solution = floatSearch.linearizeSolution();
+    for (size_t i = 1; i < solution.size(); ++i)
+    {
+        const float cost = solution[i - 1].getCost(solution[i]);
+        CHECK(AStarSearch<MapSearchNode>::isCostExact(cost));
+        CHECK_FALSE(AStarSearch<MapSearchNode, int>::isCostExact(cost));
+    }
+    CHECK(AStarSearch<MapSearchNode, int>::isCostExact(2.0f));
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    map.reset();
+}
+
+TEST_CASE("Search with node limit forgets worst leaves and keeps optimal cost")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    map.reset();
+
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(19, 19);
+    AStarSearch<MapSearchNode, int> unlimited(nodeStart, nodeGoal);
+    REQUIRE(unlimited.preformSearch() == SearchState::SUCCEEDED);
+    CHECK(unlimited.getPrunedNodeCount() == 0);
+    REQUIRE(unlimited.getPeakNodeCount() > 60);
+    CHECK(unlimited.getPeakMemoryBytes() == unlimited.getPeakNodeCount() * AStarSearch<MapSearchNode, int>::getBytesPerNode());
+
+    for (const size_t limit : {size_t(60), size_t(100)})
+    {
+        AStarSearch<MapSearchNode, int> limited(nodeStart, nodeGoal);
+        limited.setNodeLimit(limit);
+        REQUIRE(limited.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(limited.getPrunedNodeCount() > 0);
+        CHECK(limited.getPeakNodeCount() <= limit);
+        CHECK(limited.getSolutionCost() == unlimited.getSolutionCost());
+
+        auto solution = limited.linearizeSolution();
+        CHECK(solution.front().isSameState(nodeStart));
+        CHECK(solution.back().isSameState(nodeGoal));
+    }
+
+    // Limit in bytes is converted to nodes
+    AStarSearch<MapSearchNode, int> byBytes(nodeStart, nodeGoal);
+    byBytes.setMemoryLimit(100 * AStarSearch<MapSearchNode, int>::getBytesPerNode());
+    REQUIRE(byBytes.preformSearch() == SearchState::SUCCEEDED);
+    CHECK(byBytes.getPeakMemoryBytes() <= 100 * AStarSearch<MapSearchNode, int>::getBytesPerNode());
+
+    // Path alone doesn't fit into the limit
+    AStarSearch<MapSearchNode, int> tooSmall(nodeStart, nodeGoal);
+    tooSmall.setNodeLimit(10);
+    CHECK(tooSmall.preformSearch() == SearchState::OUT_OF_MEMORY);
+}
+
+TEST_CASE("Search with node limit near path length ends in bounded number of expansions")
+{
+    struct ExpansionCounter : AStarSearch<MapSearchNode>::Observer
+    {
+        size_t expanded = 0;
+        void onExpand(const MapSearchNode &) override { ++expanded; }
+        void onGenerate(const MapSearchNode &) override {}
+        void onFinish(SearchState, const std::deque<MapSearchNode> &) override {}
+    };
+
+    ArrayMap &map = ArrayMap::getInstance();
+    srand(13);
+    for (int seed = 0; seed < 40; ++seed)
+    {
+        // Weighted terrain and random walls on 4 and 8-connected grids
+        MapGenerator generator(seed);
+        const int size = 6 + rand() % 5;
+        const ArrayMap::ArrayT grid = generator.generate(seed % 2 ? MapGenerator::Kind::TERRAIN : MapGenerator::Kind::RANDOM, size, size, 0.25);
+        map.setMap(grid);
+        map.setConnectivity(seed / 2 % 2 ? ArrayMap::Connectivity::EIGHT : ArrayMap::Connectivity::FOUR);
+        for (const MapGenerator::Query &query : generator.queries(grid, 2))
+        {
+            MapSearchNode nodeStart(query.startX, query.startY);
+            MapSearchNode nodeGoal(query.goalX, query.goalY);
+            AStarSearch<MapSearchNode> unlimited(nodeStart, nodeGoal);
+            REQUIRE(unlimited.preformSearch() == SearchState::SUCCEEDED);
+            const size_t pathLength = unlimited.linearizeSolution().size();
+
+            // Any limit larger than the path must be enough
+            for (const size_t extra : {size_t(1), size_t(4), size_t(12), pathLength})
+            {
+                const size_t limit = pathLength + extra;
+                if (limit >= unlimited.getPeakNodeCount())
+                {
+                    continue;
+                }
+                INFO("seed " << seed << " size " << size << " limit " << limit << " path " << pathLength);
+                AStarSearch<MapSearchNode> limited(nodeStart, nodeGoal);
+                limited.setNodeLimit(limit);
+                ExpansionCounter counter;
+                limited.setObserver(&counter);
+                REQUIRE(limited.preformSearch() == SearchState::SUCCEEDED);
+                CHECK(counter.expanded <= 100000);
+                CHECK(std::fabs(limited.getSolutionCost() - unlimited.getSolutionCost()) < 1e-3f);
+            }
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    map.reset();
+}
+
+TEST_CASE("Search with node limit just above path length succeeds on large rooms map")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    MapGenerator generator(3);
+    const ArrayMap::ArrayT grid = generator.generate(MapGenerator::Kind::ROOMS, 600, 600);
+    map.setMap(grid);
+
+    for (const MapGenerator::Query &query : generator.queries(grid, 4))
+    {
+        MapSearchNode nodeStart(query.startX, query.startY);
+        MapSearchNode nodeGoal(query.goalX, query.goalY);
+        AStarSearch<MapSearchNode> unlimited(nodeStart, nodeGoal);
+        REQUIRE(unlimited.preformSearch() == SearchState::SUCCEEDED);
+        const size_t pathLength = unlimited.linearizeSolution().size();
+
+        for (const size_t extra : {size_t(6), size_t(100), size_t(300)})
+        {
+            INFO("query " << query.startX << "," << query.startY << " -> " << query.goalX << "," << query.goalY
+                          << " limit " << pathLength + extra << " path " << pathLength);
+            AStarSearch<MapSearchNode> limited(nodeStart, nodeGoal);
+            limited.setNodeLimit(pathLength + extra);
+            REQUIRE(limited.preformSearch() == SearchState::SUCCEEDED);
+            CHECK(limited.getSolutionCost() == unlimited.getSolutionCost());
+            CHECK(limited.getPeakNodeCount() <= pathLength + extra);
+        }
+    }
+    map.reset();
+}
+
+TEST_CASE("Multi-goal search finds nearest goals in one pass")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    MapGenerator generator(11);
+    const ArrayMap::ArrayT grid = generator.generate(MapGenerator::Kind::ROOMS, 70, 50);
+    map.setMap(grid);
+
+    // Goals on free cells, a few of them may be in other components
+    GoalSet goals(70, 50);
+    std::vector<std::pair<int, int>> goalCells;
+    for (const auto &query : generator.queries(grid, 40))
+    {
+        if (goals.add(query.goalX, query.goalY))
+        {
+            goalCells.emplace_back(query.goalX, query.goalY);
+        }
+    }
+    REQUIRE(goals.size() == goalCells.size());
+    CHECK(goals.contains(goalCells.front().first, goalCells.front().second));
+    CHECK_FALSE(goals.add(goalCells.front().first, goalCells.front().second));
+    CHECK_FALSE(goals.add(70, 0));
+
+    for (auto connectivity : {ArrayMap::Connectivity::FOUR, ArrayMap::Connectivity::EIGHT})
+    {
+        map.setConnectivity(connectivity);
+
+        // Spatial index gives the same heuristic as minimum over all goals
+        for (int y = 0; y < 50; y += 3)
+        {
+            for (int x = 0; x < 70; x += 5)
+            {
+                float nearest = FLT_MAX;
+                for (const auto &goal : goalCells)
+                {
+                    nearest = std::min(nearest, MapSearchNode::distanceEstimate(abs(goal.first - x), abs(goal.second - y)));
+                }
+                CHECK(goals.getNearestEstimate(x, y) == nearest);
+            }
+        }
+
+        const auto start = generator.queries(grid, 1).front();
+        const int startX = start.startX;
+        const int startY = start.startY;
+        std::vector<float> costs;
+        unsigned int separateSteps = 0;
+        for (const auto &goal : goalCells)
+        {
+            MapSearchNode nodeStart(startX, startY);
+            MapSearchNode nodeGoal(goal.first, goal.second);
+            AStarSearch<MapSearchNode> search(nodeStart, nodeGoal);
+            if (search.preformSearch() == SearchState::SUCCEEDED)
+            {
+                costs.push_back(search.getSolutionCost());
+            }
+            separateSteps += search.getStepCount();
+        }
+        REQUIRE(costs.size() >= 5);
+        std::sort(costs.begin(), costs.end());
+
+        MultiGoalSearchNode nodeStart(startX, startY, &goals);
+        MultiGoalSearchNode nodeGoal(&goals);
+        AStarSearch<MultiGoalSearchNode> search(nodeStart, nodeGoal);
+        REQUIRE(search.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(std::fabs(search.getSolutionCost() - costs.front()) < 1e-3);
+        CHECK(goals.contains(search.linearizeSolution().back().x, search.linearizeSolution().back().y));
+        CHECK(search.getStepCount() < separateSteps);
+
+        const auto nearest = MultiGoalSearchNode::findNearest(startX, startY, goals, 5);
+        REQUIRE(nearest.size() == 5);
+        for (size_t i = 0; i < nearest.size(); ++i)
+        {
+            CHECK(std::fabs(nearest[i].cost - costs[i]) < 1e-3);
+            CHECK(nearest[i].path.front().x == startX);
+            CHECK(nearest[i].path.back().x == nearest[i].x);
+            CHECK(nearest[i].path.back().y == nearest[i].y);
+        }
+        CHECK(goals.size() == goalCells.size());
+
+        // All reachable goals are found, then search runs out of open nodes
+        CHECK(MultiGoalSearchNode::findNearest(startX, startY, goals, goalCells.size()).size() == costs.size());
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+}
+
+TEST_CASE("Trace spans of all threads are exported as Chrome trace events")
+{
+    Trace::clear();
+    {
+        Trace::setQuery(7);
+        Trace::Span span("outer");
+        Trace::Span inner("inner");
+    }
+    std::thread worker([]()
+                       { Trace::Span span("worker"); });
+    worker.join();
+    CHECK(Trace::getEventCount() == 3);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "astar_trace_test.json").string();
+    std::string error;
+    REQUIRE(Trace::save(path, error));
+    std::ifstream in(path);
+    const std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    CHECK(json.find("\"traceEvents\"") != std::string::npos);
+    CHECK(json.find("{\"name\":\"outer\",\"ph\":\"X\"") != std::string::npos);
+    CHECK(json.find("\"args\":{\"query\":7}") != std::string::npos);
+    CHECK(json.find("\"name\":\"worker\"") != std::string::npos);
+    CHECK(json.find("\"thread_name\"") != std::string::npos);
+    std::remove(path.c_str());
+
+    // Ring buffer keeps only the latest spans
+    Trace::clear();
+    for (size_t i = 0; i < Trace::BUFFER_EVENTS + 10; ++i)
+    {
+        Trace::record("ring", i, i + 1);
+    }
+    CHECK(Trace::getEventCount() == Trace::BUFFER_EVENTS);
+    Trace::setQuery(Trace::NO_QUERY);
+    Trace::clear();
+}
+
+TEST_CASE("Hash distributed parallel A* finds optimal cost on any number of threads")
+{
+    ArrayMap::ArrayT grid(40, std::vector<int>(40, 1));
+    srand(7);
+    for (auto &row : grid)
+    {
+        for (auto &cell : row)
+        {
+            const int roll = rand() % 10;
+            cell = roll < 3 ? 9 : (roll < 5 ? 3 : 1);
+        }
+    }
+    grid[0][0] = 1;
+    grid[39][39] = 1;
+    grid[39][0] = 1;
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(grid);
+
+    for (auto connectivity : {ArrayMap::Connectivity::FOUR, ArrayMap::Connectivity::EIGHT})
+    {
+        map.setConnectivity(connectivity);
+        for (const auto &query : std::vector<std::vector<int>>{{0, 0, 39, 39}, {39, 0, 0, 0}, {0, 0, 0, 0}})
+        {
+            MapSearchNode nodeStart(query[0], query[1]);
+            MapSearchNode nodeGoal(query[2], query[3]);
+            AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+            const SearchState expected = astarsearch.preformSearch();
+
+            for (unsigned int threads = 1; threads <= 4; ++threads)
+            {
+                ParallelAStarSearch parallel(nodeStart, nodeGoal, threads);
+                REQUIRE(parallel.preformSearch() == expected);
+                if (expected != SearchState::SUCCEEDED)
+                {
+                    continue;
+                }
+                CHECK(std::fabs(parallel.getSolutionCost() - astarsearch.getSolutionCost()) < 1e-3f);
+
+                auto solution = parallel.linearizeSolution();
+                REQUIRE(!solution.empty());
+                CHECK(solution.front().isSameState(nodeStart));
+                CHECK(solution.back().isSameState(nodeGoal));
+                float cost = 0.0f;
+                for (size_t i = 1; i < solution.size(); ++i)
+                {
+                    cost += solution[i - 1].getCost(solution[i]);
+                }
+                CHECK(std::fabs(cost - parallel.getSolutionCost()) < 1e-3f);
+            }
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+
+    // Unreachable goal has to terminate too
+    grid[38][39] = 9;
+    grid[39][38] = 9;
+    grid[38][38] = 9;
+    map.setMap(grid);
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(39, 39);
+    ParallelAStarSearch parallel(nodeStart, nodeGoal, 3);
+    CHECK(parallel.preformSearch() == SearchState::FAILED);
+}
+
+TEST_CASE("Compressed path database answers queries with optimal paths after reload")
+{
+    ArrayMap::ArrayT grid(24, std::vector<int>(24, 1));
+    srand(11);
+    for (auto &row : grid)
+    {
+        for (auto &cell : row)
+        {
+            const int roll = rand() % 10;
+            cell = roll < 3 ? 9 : (roll < 5 ? 4 : 1);
+        }
+    }
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(grid);
+    const std::string path = (std::filesystem::temp_directory_path() / "astar_cpd_test.bin").string();
+
+    for (auto connectivity : {ArrayMap::Connectivity::FOUR, ArrayMap::Connectivity::EIGHT})
+    {
+        map.setConnectivity(connectivity);
+        CompressedPathDatabase built;
+        built.build(2);
+        CHECK(built.getRunCount() < uint64_t(built.getFreeCellCount()) * built.getFreeCellCount() / 4);
+
+        std::string error;
+        REQUIRE(built.save(path, error));
+        CompressedPathDatabase loaded;
+        REQUIRE(loaded.load(path, error));
+        CHECK(loaded.getRunCount() == built.getRunCount());
+        CHECK(loaded.getConnectivity() == connectivity);
+
+        for (int query = 0; query < 60; ++query)
+        {
+            MapSearchNode nodeStart(rand() % 24, rand() % 24);
+            MapSearchNode nodeGoal(rand() % 24, rand() % 24);
+            if (!map.isPassable(nodeStart.x, nodeStart.y) || !map.isPassable(nodeGoal.x, nodeGoal.y))
+            {
+                continue;
+            }
+            AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+            const bool isFound = astarsearch.preformSearch() == SearchState::SUCCEEDED;
+
+            std::deque<MapSearchNode> solution;
+            REQUIRE(loaded.findPath(nodeStart, nodeGoal, solution) == isFound);
+            if (!isFound)
+            {
+                continue;
+            }
+            CHECK(solution.front().isSameState(nodeStart));
+            CHECK(solution.back().isSameState(nodeGoal));
+            float cost = 0.0f;
+            for (size_t i = 1; i < solution.size(); ++i)
+            {
+                cost += solution[i - 1].getCost(solution[i]);
+            }
+            CHECK(std::fabs(cost - astarsearch.getSolutionCost()) < 1e-3f);
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+
+    // Database is tied to map content and connectivity
+    CompressedPathDatabase loaded;
+    std::string error;
+    REQUIRE(map.getConnectivity() == ArrayMap::Connectivity::FOUR);
+    CHECK_FALSE(loaded.load(path, error));
+    CHECK(loaded.isEmpty());
+    map.setConnectivity(ArrayMap::Connectivity::EIGHT);
+    CHECK(loaded.load(path, error));
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+    grid[0][0] = grid[0][0] == 1 ? 9 : 1;
+    map.setMap(grid);
+    CHECK_FALSE(loaded.load(path, error));
+    CHECK(loaded.isEmpty());
+
+    // Tables of a crafted snapshot are checked before queries index with them. Map is two cells, west and east
+    map.setMap(ArrayMap::ArrayT{{1, 1}});
+    const uint32_t WEST = 0;
+    const uint32_t EAST = 2;
+    const uint32_t NONE = CompressedPathDatabase::NO_MOVE;
+    const auto writeTables = [&](uint32_t width, uint32_t height, const std::vector<int32_t> &order,
+                                 const std::vector<uint64_t> &offsets, const std::vector<uint32_t> &runs)
+    {
+        struct
+        {
+            uint32_t width, height, connectivity, freeCount;
+            uint64_t runCount;
+        } header{width, height, uint32_t(ArrayMap::Connectivity::FOUR), 2, runs.size()};
+        IndexSnapshot::Writer writer;
+        writer.addSection(CompressedPathDatabase::SECTION_HEADER, &header, sizeof(header));
+        writer.addSection(CompressedPathDatabase::SECTION_ORDER, order.data(), order.size() * sizeof(int32_t));
+        writer.addSection(CompressedPathDatabase::SECTION_OFFSETS, offsets.data(), offsets.size() * sizeof(uint64_t));
+        writer.addSection(CompressedPathDatabase::SECTION_RUNS, runs.data(), runs.size() * sizeof(uint32_t));
+        std::string writeError;
+        REQUIRE(writer.write(path, map.getContentHash(), writeError));
+    };
+    const std::vector<uint32_t> runs{0 << 4 | NONE, 1 << 4 | EAST, 0 << 4 | WEST, 1 << 4 | NONE};
+    writeTables(2, 1, {0, 1}, {0, 2, 4}, runs);
+    REQUIRE(loaded.load(path, error));
+    CHECK(loaded.getFirstMove(0, 0, 1, 0) == EAST);
+    CHECK(loaded.getFirstMove(1, 0, 0, 0) == WEST);
+
+    writeTables(1, 2, {0, 1}, {0, 2, 4}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 2}, {0, 2, 4}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {1, 1}, {0, 2, 4}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, -1}, {0, 2, 4}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 5, 4}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 2, 5}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 0, 4}, runs);
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 2, 4}, {1 << 4 | EAST, 0 << 4 | NONE, 0 << 4 | WEST, 1 << 4 | NONE});
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 2, 4}, {0 << 4 | NONE, 1 << 4 | WEST, 0 << 4 | WEST, 1 << 4 | NONE});
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 2, 4}, {0 << 4 | NONE, 1 << 4 | 9, 0 << 4 | WEST, 1 << 4 | NONE});
+    CHECK_FALSE(loaded.load(path, error));
+    writeTables(2, 1, {0, 1}, {0, 2, 4}, {0 << 4 | NONE, 2 << 4 | EAST, 0 << 4 | WEST, 1 << 4 | NONE});
+    CHECK_FALSE(loaded.load(path, error));
+    CHECK(loaded.isEmpty());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Connected components follow wall changes")
+{
+    std::vector<std::vector<int>> mockMap{
+        {1, 1, 1, 1, 1},
+        {1, 9, 9, 9, 1},
+        {1, 9, 1, 9, 1},
+        {1, 9, 9, 9, 1},
+        {1, 1, 1, 1, 1}};
+    ArrayMap &map = ArrayMap::getInstance();
+    map.setMap(mockMap);
+
+    CHECK(map.getComponent(1, 1) == ArrayMap::NO_COMPONENT);
+    CHECK(map.getComponentSize(0, 0) == 16);
+    CHECK(map.getComponentSize(2, 2) == 1);
+    CHECK_FALSE(map.isConnected(0, 0, 2, 2));
+    CHECK(map.isConnected(0, 0, 4, 4));
+
+    // Wall with other path around doesn't split the ring
+    map.setLogicalCell(2, 0, ArrayMap::CellType::WALL_POS);
+    CHECK(map.isConnected(0, 0, 4, 0));
+    CHECK(map.getComponentSize(0, 0) == 15);
+
+    // Second wall cuts the ring into two halves
+    map.setLogicalCell(2, 4, ArrayMap::CellType::WALL_POS);
+    CHECK_FALSE(map.isConnected(0, 0, 4, 0));
+    CHECK(map.getComponentSize(0, 0) == 7);
+    CHECK(map.getComponentSize(4, 0) == 7);
+
+    // Opening the inner wall joins the center to the left half only
+    map.setLogicalCell(1, 2, ArrayMap::CellType::EMPTY_POS);
+    CHECK(map.isConnected(0, 0, 2, 2));
+    CHECK(map.getComponentSize(2, 2) == 9);
+    CHECK_FALSE(map.isConnected(2, 2, 4, 4));
+
+    // And the last opening merges everything back
+    map.setLogicalCell(3, 2, ArrayMap::CellType::EMPTY_POS);
+    CHECK(map.isConnected(0, 0, 4, 0));
+    CHECK(map.getComponentSize(4, 4) == 17);
+
+    MapSearchNode nodeStart(0, 0);
+    MapSearchNode nodeGoal(4, 0);
+    AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+    CHECK(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+
+    // Incremental labels agree with labels built from scratch after random edits
+    ArrayMap::ArrayT grid(16, std::vector<int>(16, 1));
+    map.setMap(grid);
+    srand(5);
+    for (int edit = 0; edit < 400; ++edit)
+    {
+        const int x = rand() % 16;
+        const int y = rand() % 16;
+        const bool isWall = rand() % 3 != 0;
+        map.setLogicalCell(x, y, isWall ? ArrayMap::CellType::WALL_POS : ArrayMap::CellType::EMPTY_POS);
+        grid[y][x] = isWall ? 9 : 1;
+    }
+    std::vector<std::vector<uint32_t>> incremental(16, std::vector<uint32_t>(16));
+    for (int y = 0; y < 16; ++y)
+    {
+        for (int x = 0; x < 16; ++x)
+        {
+            incremental[y][x] = map.getComponent(x, y);
+        }
+    }
+    map.setMap(grid);
+    for (int cell = 0; cell < 256; ++cell)
+    {
+        const int x0 = cell % 16;
+        const int y0 = cell / 16;
+        CHECK((incremental[y0][x0] == ArrayMap::NO_COMPONENT) == (map.getComponent(x0, y0) == ArrayMap::NO_COMPONENT));
+        for (int other = cell + 1; other < 256; other += 7)
+        {
+            const int x1 = other % 16;
+            const int y1 = other / 16;
+            const bool wasConnected = incremental[y0][x0] != ArrayMap::NO_COMPONENT && incremental[y0][x0] == incremental[y1][x1];
+            REQUIRE(wasConnected == map.isConnected(x0, y0, x1, y1));
+        }
+    }
+}
+
+TEST_CASE("Map generator is deterministic and produces connected queries")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    for (auto kind : {MapGenerator::Kind::RANDOM, MapGenerator::Kind::MAZE, MapGenerator::Kind::ROOMS, MapGenerator::Kind::TERRAIN})
+    {
+        MapGenerator generator(42);
+        const ArrayMap::ArrayT grid = generator.generate(kind, 101, 61);
+        const auto queries = generator.queries(grid, 50);
+        REQUIRE(grid.size() == 61);
+        REQUIRE(grid.front().size() == 101);
+
+        MapGenerator sameSeed(42);
+        CHECK(sameSeed.generate(kind, 101, 61) == grid);
+        MapGenerator otherSeed(43);
+        CHECK(otherSeed.generate(kind, 101, 61) != grid);
+
+        map.setMap(grid);
+        REQUIRE(queries.size() == 50);
+        for (const auto &query : queries)
+        {
+            CHECK(map.isConnected(query.startX, query.startY, query.goalX, query.goalY));
+        }
+    }
+
+    MapGenerator generator(7);
+    ArrayMap::ArrayT grid = generator.randomObstacles(200, 200, 0.25);
+    size_t walls = 0;
+    for (const auto &row : grid)
+    {
+        walls += std::count(row.begin(), row.end(), MapGenerator::WALL);
+    }
+    CHECK(std::fabs(walls / 40000.0 - 0.25) < 0.02);
+
+    // Perfect maze: all corridors form one tree
+    grid = generator.maze(41, 31);
+    map.setMap(grid);
+    size_t openCells = 0;
+    size_t edges = 0;
+    for (int y = 0; y < 31; ++y)
+    {
+        for (int x = 0; x < 41; ++x)
+        {
+            if (map.isPassable(x, y))
+            {
+                ++openCells;
+                edges += map.isPassable(x + 1, y) + map.isPassable(x, y + 1);
+            }
+        }
+    }
+    CHECK(map.getComponentSize(1, 1) == openCells);
+    CHECK(edges == openCells - 1);
+
+    // All rooms are joined and terrain has no walls
+    grid = generator.rooms(120, 80);
+    map.setMap(grid);
+    const auto queries = generator.queries(grid, 1);
+    REQUIRE(queries.size() == 1);
+    size_t roomCells = 0;
+    for (const auto &row : grid)
+    {
+        roomCells += std::count(row.begin(), row.end(), MapGenerator::EMPTY);
+    }
+    CHECK(map.getComponentSize(queries[0].startX, queries[0].startY) == roomCells);
+
+    grid = generator.terrain(130, 70);
+    for (const auto &row : grid)
+    {
+        CHECK(*std::min_element(row.begin(), row.end()) >= MapGenerator::EMPTY);
+        CHECK(*std::max_element(row.begin(), row.end()) <= MapGenerator::MAX_WEIGHT);
+    }
+}
+
+TEST_CASE("Fixed size grid search visits the same nodes as ArrayMap search")
+{
+    using Grid = FixedGrid<20, 20>;
+    static_assert(Grid::index(0, 0) == Grid::STRIDE + 1, "border is one cell wide");
+    static_assert(Grid::getX(Grid::index(7, 3)) == 7 && Grid::getY(Grid::index(7, 3)) == 3, "index math is constexpr");
+    static_assert(Grid().getPoint(-1, 0) == Grid::WALL && Grid().getPoint(19, 19) == Grid::EMPTY, "border is walls");
+
+    ArrayMap &map = ArrayMap::getInstance();
+    map.reset();
+    ArrayMap::ArrayT grid = map.getLogicalMap();
+    grid[5][5] = 4;
+    grid[8][3] = 7;
+    map.setMap(grid);
+
+    Grid fixedGrid;
+    REQUIRE(fixedGrid.assign(map.getLogicalMap()));
+    CHECK_FALSE(fixedGrid.assign(ArrayMap::ArrayT(3, std::vector<int>(3, 1))));
+
+    const std::vector<std::vector<int>> queries{{0, 0, 19, 19}, {19, 0, 0, 19}, {3, 2, 18, 19}};
+    for (auto connectivity : {ArrayMap::Connectivity::FOUR, ArrayMap::Connectivity::EIGHT})
+    {
+        map.setConnectivity(connectivity);
+        for (const auto &query : queries)
+        {
+            MapSearchNode nodeStart(query[0], query[1]);
+            MapSearchNode nodeGoal(query[2], query[3]);
+            AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+            REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+            const auto expected = astarsearch.getVisitedNodes();
+
+            std::vector<std::pair<int, int>> visited;
+            float cost = 0.0f;
+            if (connectivity == ArrayMap::Connectivity::EIGHT)
+            {
+                using Node = FixedGridSearchNode<Grid, ArrayMap::Connectivity::EIGHT>;
+                Node fixedStart(query[0], query[1], &fixedGrid);
+                Node fixedGoal(query[2], query[3], &fixedGrid);
+                AStarSearch<Node> fixedSearch(fixedStart, fixedGoal);
+                REQUIRE(fixedSearch.preformSearch() == SearchState::SUCCEEDED);
+                for (auto &node : fixedSearch.getVisitedNodes())
+                {
+                    visited.emplace_back(node.getX(), node.getY());
+                }
+                cost = fixedSearch.getSolutionCost();
+            }
+            else
+            {
+                using Node = FixedGridSearchNode<Grid>;
+                Node fixedStart(query[0], query[1], &fixedGrid);
+                Node fixedGoal(query[2], query[3], &fixedGrid);
+                AStarSearch<Node> fixedSearch(fixedStart, fixedGoal);
+                REQUIRE(fixedSearch.preformSearch() == SearchState::SUCCEEDED);
+                for (auto &node : fixedSearch.getVisitedNodes())
+                {
+                    visited.emplace_back(node.getX(), node.getY());
+                }
+                cost = fixedSearch.getSolutionCost();
+            }
+
+            REQUIRE(visited.size() == expected.size());
+            for (size_t i = 0; i < visited.size(); ++i)
+            {
+                CHECK(visited[i].first == expected[i].x);
+                CHECK(visited[i].second == expected[i].y);
+            }
+            CHECK(std::fabs(cost - astarsearch.getSolutionCost()) < 1e-4f);
+        }
+    }
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+}
+
+TEST_CASE("Index snapshot validates map hash and section checksums")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    map.reset();
+    const uint64_t hash = map.getContentHash();
+    map.setLogicalCell(0, 0, ArrayMap::CellType::WALL_POS);
+    CHECK(map.getContentHash() != hash);
+    map.setLogicalCell(0, 0, ArrayMap::CellType::EMPTY_POS);
+    CHECK(map.getContentHash() == hash);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "astar_snapshot_test.bin").string();
+    std::vector<uint32_t> first(1000);
+    for (size_t i = 0; i < first.size(); ++i)
+    {
+        first[i] = i * 7;
+    }
+    const std::string second = "component labels";
+    IndexSnapshot::Writer writer;
+    writer.addSection(IndexSnapshot::makeId('T', 'S', 'T', '1'), first.data(), first.size() * sizeof(uint32_t));
+    writer.addSection(IndexSnapshot::makeId('T', 'S', 'T', '2'), second.data(), second.size());
+    std::string error;
+    REQUIRE(writer.write(path, hash, error));
+
+    IndexSnapshot snapshot;
+    CHECK_FALSE(snapshot.open(path, hash + 1, error));
+    REQUIRE(snapshot.open(path, hash, error));
+    size_t size = 0;
+    const void *data = snapshot.getSection(IndexSnapshot::makeId('T', 'S', 'T', '1'), size);
+    REQUIRE(data);
+    CHECK(size == first.size() * sizeof(uint32_t));
+    CHECK(reinterpret_cast<uintptr_t>(data) % IndexSnapshot::SECTION_ALIGNMENT == 0);
+    CHECK(std::memcmp(data, first.data(), size) == 0);
+    data = snapshot.getSection(IndexSnapshot::makeId('T', 'S', 'T', '2'), size);
+    REQUIRE(data);
+    CHECK(std::string(static_cast<const char *>(data), size) == second);
+    CHECK(snapshot.getSection(IndexSnapshot::makeId('N', 'O', 'N', 'E'), size) == nullptr);
+    snapshot.close();
+
+    // Any flipped byte of section data is detected
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(0, std::ios::end);
+        const std::streamoff fileSize = file.tellg();
+        file.seekp(fileSize - 3);
+        file.put('X');
+    }
+    CHECK_FALSE(snapshot.open(path, hash, error));
+    CHECK_FALSE(snapshot.isOpen());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("CSR graph from DIMACS finds shortest paths with admissible heuristic")
+{
+    // 8x8 lattice road network with two-way roads of random weight, coordinates in millionths of degree
+    const int side = 8;
+    std::ostringstream graphText;
+    std::ostringstream coordinateText;
+    std::vector<std::vector<std::pair<int, int>>> adjacency(side * side);
+    srand(3);
+    graphText << "c test network\np sp " << side * side << " " << 4 * side * (side - 1) << "\n";
+    for (int v = 0; v < side * side; ++v)
+    {
+        coordinateText << "v " << v + 1 << " " << 13000000 + (v % side) * 1000 << " " << 52000000 + (v / side) * 1000 << "\n";
+        for (int neighbor : {v + 1, v + side})
+        {
+            if ((neighbor == v + 1 && v % side == side - 1) || neighbor >= side * side)
+            {
+                continue;
+            }
+            const int weight = 100 + rand() % 300;
+            graphText << "a " << v + 1 << " " << neighbor + 1 << " " << weight << "\n";
+            graphText << "a " << neighbor + 1 << " " << v + 1 << " " << weight << "\n";
+            adjacency[v].emplace_back(neighbor, weight);
+            adjacency[neighbor].emplace_back(v, weight);
+        }
+    }
+
+    CsrGraph graph;
+    std::string error;
+    std::istringstream graphStream(graphText.str());
+    std::istringstream coordinateStream(coordinateText.str());
+    REQUIRE(graph.loadDimacs(graphStream, &coordinateStream, CsrGraph::CoordinateKind::GEOGRAPHIC, error));
+    CHECK(graph.getVertexCount() == side * side);
+    CHECK(graph.getEdgeCount() == 4 * side * (side - 1));
+
+    const std::string path = (std::filesystem::temp_directory_path() / "astar_csr_test.bin").string();
+    REQUIRE(graph.save(path, error));
+    CsrGraph mapped;
+    REQUIRE(mapped.load(path, error));
+    CHECK(mapped.getEdgeCount() == graph.getEdgeCount());
+    CHECK(mapped.getCoordinateKind() == CsrGraph::CoordinateKind::GEOGRAPHIC);
+    CHECK(mapped.distanceEstimate(0, side * side - 1) > 0.0f);
+
+    for (int source = 0; source < side * side; source += 5)
+    {
+        // Reference Dijkstra
+        std::vector<int> distance(side * side, INT32_MAX);
+        std::vector<bool> done(side * side, false);
+        distance[source] = 0;
+        for (int iteration = 0; iteration < side * side; ++iteration)
+        {
+            int best = -1;
+            for (int v = 0; v < side * side; ++v)
+            {
+                if (!done[v] && (best < 0 || distance[v] < distance[best]))
+                {
+                    best = v;
+                }
+            }
+            done[best] = true;
+            for (const auto &edge : adjacency[best])
+            {
+                distance[edge.first] = std::min(distance[edge.first], distance[best] + edge.second);
+            }
+        }
+
+        for (int target = 0; target < side * side; target += 3)
+        {
+            CHECK(mapped.distanceEstimate(source, target) <= distance[target]);
+            CsrGraphSearchNode nodeStart(source, &mapped);
+            CsrGraphSearchNode nodeGoal(target, &mapped);
+            AStarSearch<CsrGraphSearchNode> astarsearch(nodeStart, nodeGoal);
+            REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+            CHECK(astarsearch.getSolutionCost() == float(distance[target]));
+            auto solution = astarsearch.linearizeSolution();
+            CHECK(solution.front().vertex == CsrGraph::VertexId(source));
+            CHECK(solution.back().vertex == CsrGraph::VertexId(target));
+        }
+    }
+
+    // Snapshot with valid checksums but arc to missing vertex is rejected
+    CsrGraph outOfBounds;
+    outOfBounds.assign(2, {{0, 1, 1}, {1, 2, 1}}, {}, CsrGraph::CoordinateKind::NONE);
+    REQUIRE(outOfBounds.save(path, error));
+    CHECK_FALSE(mapped.load(path, error));
+    CHECK(mapped.getVertexCount() == 0);
+    std::remove(path.c_str());
+
+    std::istringstream broken("p sp 2 1\na 1 3 5\n");
+    CHECK_FALSE(graph.loadDimacs(broken, nullptr, CsrGraph::CoordinateKind::NONE, error));
+}
+
+TEST_CASE("Contraction hierarchy returns A* costs and unpacks full paths")
+{
+    // Directed 12x12 lattice with different weights in both directions and some one-way streets
+    const int side = 12;
+    std::vector<CsrGraph::Edge> edges;
+    std::vector<int32_t> coordinates;
+    srand(9);
+    for (int v = 0; v < side * side; ++v)
+    {
+        coordinates.push_back(v % side * 100);
+        coordinates.push_back(v / side * 100);
+        for (int neighbor : {v + 1, v + side})
+        {
+            if ((neighbor == v + 1 && v % side == side - 1) || neighbor >= side * side)
+            {
+                continue;
+            }
+            edges.push_back(CsrGraph::Edge{CsrGraph::VertexId(v), CsrGraph::VertexId(neighbor), uint32_t(100 + rand() % 200)});
+            if (rand() % 5 != 0)
+            {
+                edges.push_back(CsrGraph::Edge{CsrGraph::VertexId(neighbor), CsrGraph::VertexId(v), uint32_t(100 + rand() % 200)});
+            }
+        }
+    }
+    CsrGraph graph;
+    graph.assign(side * side, edges, coordinates, CsrGraph::CoordinateKind::PLANAR);
+
+    const std::string path = (std::filesystem::temp_directory_path() / "astar_ch_test.bin").string();
+    for (unsigned int threads : {1u, 3u})
+    {
+        ContractionHierarchy built;
+        built.build(graph, threads);
+        CHECK(built.getStats().rounds > 0);
+        std::string error;
+        REQUIRE(built.save(path, error));
+        ContractionHierarchy hierarchy;
+        REQUIRE(hierarchy.load(path, graph, error));
+
+        ContractionHierarchy::Query query(hierarchy);
+        std::vector<CsrGraph::VertexId> vertices;
+        for (CsrGraph::VertexId source = 0; source < side * side; source += 7)
+        {
+            for (CsrGraph::VertexId target = 0; target < side * side; target += 5)
+            {
+                CsrGraphSearchNode nodeStart(source, &graph);
+                CsrGraphSearchNode nodeGoal(target, &graph);
+                AStarSearch<CsrGraphSearchNode> astarsearch(nodeStart, nodeGoal);
+                const bool isFound = astarsearch.preformSearch() == SearchState::SUCCEEDED;
+
+                const uint64_t cost = query.findPath(source, target, &vertices);
+                REQUIRE((cost != ContractionHierarchy::NO_PATH) == isFound);
+                if (!isFound)
+                {
+                    continue;
+                }
+                CHECK(float(cost) == astarsearch.getSolutionCost());
+                REQUIRE(vertices.front() == source);
+                REQUIRE(vertices.back() == target);
+                uint64_t pathCost = 0;
+                for (size_t i = 1; i < vertices.size(); ++i)
+                {
+                    uint32_t weight = UINT32_MAX;
+                    for (uint32_t edge = graph.getEdgeBegin(vertices[i - 1]); edge < graph.getEdgeEnd(vertices[i - 1]); ++edge)
+                    {
+                        if (graph.getTarget(edge) == vertices[i])
+                        {
+                            weight = std::min(weight, graph.getWeight(edge));
+                        }
+                    }
+                    REQUIRE(weight < UINT32_MAX);
+                    pathCost += weight;
+                }
+                CHECK(pathCost == cost);
+            }
+        }
+    }
+
+    // Hierarchy of other graph is rejected
+    edges[0].weight += 1;
+    CsrGraph changed;
+    changed.assign(side * side, edges, coordinates, CsrGraph::CoordinateKind::PLANAR);
+    ContractionHierarchy hierarchy;
+    std::string error;
+    CHECK_FALSE(hierarchy.load(path, changed, error));
+    std::remove(path.c_str());
+
+    // Zero weight arcs still need shortcuts when their middle vertex is contracted
+    const std::vector<CsrGraph::Edge> zeroEdges = {{1, 0, 0}, {0, 1, 0}, {0, 2, 0}, {2, 0, 0}};
+    CsrGraph zeroGraph;
+    zeroGraph.assign(3, zeroEdges, {}, CsrGraph::CoordinateKind::NONE);
+    ContractionHierarchy zeroHierarchy;
+    zeroHierarchy.build(zeroGraph, 1);
+    ContractionHierarchy::Query zeroQuery(zeroHierarchy);
+    for (CsrGraph::VertexId source = 0; source < 3; ++source)
+    {
+        for (CsrGraph::VertexId target = 0; target < 3; ++target)
+        {
+            CHECK(zeroQuery.findPath(source, target) == 0);
+        }
+    }
+
+    // Hierarchy file with valid checksums but broken arrays is rejected, queries would index out of them
+    using Arc = ContractionHierarchy::Arc;
+    const CsrGraph::VertexId none = CsrGraph::NO_VERTEX;
+    const std::vector<CsrGraph::Edge> chainEdges = {{0, 1, 1}, {1, 2, 1}};
+    CsrGraph chain;
+    chain.assign(3, chainEdges, {}, CsrGraph::CoordinateKind::NONE);
+    const auto writeChain = [&](std::vector<uint32_t> ranks, std::vector<uint32_t> offsets, std::vector<Arc> arcs)
+    {
+        const uint32_t header[4] = {3, uint32_t(arcs.size()), 0, 0};
+        const std::vector<uint32_t> noOffsets(4, 0);
+        IndexSnapshot::Writer writer;
+        writer.addSection(ContractionHierarchy::SECTION_HEADER, header, sizeof(header));
+        writer.addSection(ContractionHierarchy::SECTION_RANKS, ranks.data(), ranks.size() * sizeof(uint32_t));
+        writer.addSection(ContractionHierarchy::SECTION_FORWARD_OFFSETS, offsets.data(), offsets.size() * sizeof(uint32_t));
+        writer.addSection(ContractionHierarchy::SECTION_FORWARD_ARCS, arcs.data(), arcs.size() * sizeof(Arc));
+        writer.addSection(ContractionHierarchy::SECTION_BACKWARD_OFFSETS, noOffsets.data(), noOffsets.size() * sizeof(uint32_t));
+        writer.addSection(ContractionHierarchy::SECTION_BACKWARD_ARCS, nullptr, 0);
+        std::string writeError;
+        REQUIRE(writer.write(path, chain.getContentHash(), writeError));
+    };
+    ContractionHierarchy chainHierarchy;
+    writeChain({0, 1, 2}, {0, 1, 2, 2}, {{1, 1, none}, {2, 1, none}});
+    REQUIRE(chainHierarchy.load(path, chain, error));
+    CHECK(ContractionHierarchy::Query(chainHierarchy).findPath(0, 2) == 2);
+
+    writeChain({0, 1, 2}, {0, 2, 1, 2}, {{1, 1, none}, {2, 1, none}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    writeChain({0, 1, 2}, {0, 1, 2, 3}, {{1, 1, none}, {2, 1, none}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    writeChain({0, 1, 2}, {0, 1, 2, 2}, {{1, 1, none}, {7, 1, none}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    writeChain({0, 1, 2}, {0, 1, 2, 2}, {{1, 1, none}, {0, 1, none}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    writeChain({0, 1, 2}, {0, 1, 2, 2}, {{1, 1, none}, {2, 1, 9}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    writeChain({0, 1, 2}, {0, 1, 2, 2}, {{2, 2, 1}, {2, 1, none}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    writeChain({0, 0, 2}, {0, 1, 2, 2}, {{1, 1, none}, {2, 1, none}});
+    CHECK_FALSE(chainHierarchy.load(path, chain, error));
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Rectangle search expands only borders and keeps A* cost and cell path")
+{
+    ArrayMap &map = ArrayMap::getInstance();
+    for (auto kind : {MapGenerator::Kind::RANDOM, MapGenerator::Kind::ROOMS, MapGenerator::Kind::TERRAIN})
+    {
+        MapGenerator generator(23);
+        const ArrayMap::ArrayT grid = generator.generate(kind, 40, 30);
+        map.setMap(grid);
+        RectangleMap rectangles;
+        rectangles.build(map);
+
+        // Every free cell is in one rectangle of cells with its weight
+        for (int y = 0; y < 30; ++y)
+        {
+            for (int x = 0; x < 40; ++x)
+            {
+                const uint32_t id = rectangles.getRectangleId(x, y);
+                REQUIRE((id == RectangleMap::NO_RECTANGLE) == !map.isPassable(x, y));
+                if (id != RectangleMap::NO_RECTANGLE)
+                {
+                    const RectangleMap::Rectangle &rectangle = rectangles.getRectangle(id);
+                    CHECK(x >= rectangle.left);
+                    CHECK(x <= rectangle.right);
+                    CHECK(y >= rectangle.top);
+                    CHECK(y <= rectangle.bottom);
+                    CHECK(rectangle.weight == static_cast<int>(map.getPoint(x, y)));
+                }
+            }
+        }
+
+        const auto queries = generator.queries(grid, 15);
+        for (auto connectivity : {ArrayMap::Connectivity::FOUR, ArrayMap::Connectivity::EIGHT})
+        {
+            map.setConnectivity(connectivity);
+            unsigned int astarSteps = 0;
+            unsigned int rectangleSteps = 0;
+            for (const auto &query : queries)
+            {
+                MapSearchNode nodeStart(query.startX, query.startY);
+                MapSearchNode nodeGoal(query.goalX, query.goalY);
+                AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+                REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+                astarSteps += astarsearch.getStepCount();
+
+                RectangleSearch search(rectangles, nodeStart, nodeGoal);
+                REQUIRE(search.preformSearch() == SearchState::SUCCEEDED);
+                rectangleSteps += search.getStepCount();
+                CHECK(std::fabs(search.getSolutionCost() - astarsearch.getSolutionCost()) < 1e-3);
+
+                // Cell path is made of legal moves and has the same cost
+                const auto solution = search.linearizeSolution();
+                REQUIRE(solution.front().isSameState(nodeStart));
+                REQUIRE(solution.back().isSameState(nodeGoal));
+                float cost = 0.0f;
+                for (size_t i = 1; i < solution.size(); ++i)
+                {
+                    MapSearchNode from = solution[i - 1];
+                    MapSearchNode to = solution[i];
+                    REQUIRE(map.getNeighborMask(from.x, from.y) & ArrayMap::directionBit(to.x - from.x, to.y - from.y));
+                    cost += from.getCost(to);
+                }
+                CHECK(std::fabs(cost - astarsearch.getSolutionCost()) < 1e-3);
+            }
+            if (kind == MapGenerator::Kind::ROOMS)
+            {
+                CHECK(rectangleSteps < astarSteps);
+            }
+        }
+    }
+
+    MapSearchNode nodeStart(0, 0);
+    RectangleMap rectangles;
+    ArrayMap::ArrayT grid = {{1, 9, 1}, {1, 9, 1}};
+    map.setMap(grid);
+    rectangles.build(map);
+    RectangleSearch search(rectangles, nodeStart, MapSearchNode(2, 0));
+    CHECK(search.preformSearch() == SearchState::FAILED);
+    CHECK(search.getStepCount() == 0);
+    CHECK(search.linearizeSolution().empty());
+    map.setConnectivity(ArrayMap::Connectivity::FOUR);
+}
+
+TEST_CASE("Rectangle search generates fewer nodes than A* on large rooms map")
+{
+    struct GenerationCounter : AStarSearch<MapSearchNode>::Observer
+    {
+        size_t generated = 0;
+        void onExpand(const MapSearchNode &) override {}
+        void onGenerate(const MapSearchNode &) override { ++generated; }
+        void onFinish(SearchState, const std::deque<MapSearchNode> &) override {}
+    };
+
+    ArrayMap &map = ArrayMap::getInstance();
+    MapGenerator generator(7);
+    const ArrayMap::ArrayT grid = generator.generate(MapGenerator::Kind::ROOMS, 512, 512);
+    map.setMap(grid);
+    RectangleMap rectangles;
+    rectangles.build(map);
+
+    size_t astarGenerated = 0;
+    size_t rectangleGenerated = 0;
+    for (const auto &query : generator.queries(grid, 20))
+    {
+        MapSearchNode nodeStart(query.startX, query.startY);
+        MapSearchNode nodeGoal(query.goalX, query.goalY);
+        AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        GenerationCounter counter;
+        astarsearch.setObserver(&counter);
+        REQUIRE(astarsearch.preformSearch() == SearchState::SUCCEEDED);
+        astarGenerated += counter.generated;
+
+        RectangleSearch search(rectangles, nodeStart, nodeGoal);
+        REQUIRE(search.preformSearch() == SearchState::SUCCEEDED);
+        CHECK(std::fabs(search.getSolutionCost() - astarsearch.getSolutionCost()) < 1e-3);
+        rectangleGenerated += search.getGeneratedCount();
+    }
+    // Jumps across rooms replace rows of interior cells
+    CHECK(rectangleGenerated * 2 < astarGenerated);
+    map.reset();
+}
+
+TEST_CASE("Path server answers pipelined queries of many clients in batches")
+{
+    Histogram histogram;
+    for (uint64_t value : {0, 1, 2, 3, 100, 1000})
+    {
+        histogram.record(value);
+    }
+    CHECK(histogram.getCount() == 6);
+    CHECK(histogram.getMax() == 1000);
+    CHECK(histogram.getPercentile(0.5) == 3);
+    CHECK(histogram.getPercentile(1.0) == 1000);
+
+    const std::string mapPath = (std::filesystem::temp_directory_path() / "astar_server_test.map").string();
+    const std::string socketPath = (std::filesystem::temp_directory_path() / "astar_server_test.sock").string();
+    MapGenerator generator(31);
+    const ArrayMap::ArrayT grid = generator.generate(MapGenerator::Kind::TERRAIN, 40, 30);
+    {
+        std::ofstream mapStream(mapPath);
+        MapIO::saveRows(mapStream, grid);
+    }
+    std::vector<BatchRunner::Query> queries;
+    for (const auto &query : generator.queries(grid, 24))
+    {
+        queries.push_back(BatchRunner::Query{static_cast<uint32_t>(queries.size()), query.startX, query.startY, query.goalX, query.goalY});
+    }
+    queries.push_back(BatchRunner::Query{static_cast<uint32_t>(queries.size()), 0, 0, 40, 0});
+
+    PathServer::Options options;
+    options.socketPath = socketPath;
+    options.search.mapFile = mapPath;
+    options.search.threads = 2;
+    options.batchSize = 4;
+    PathServer server;
+    std::string error;
+    REQUIRE(server.start(options, error));
+    CHECK_FALSE(server.start(options, error));
+
+    std::vector<float> expected;
+    for (const auto &query : queries)
+    {
+        MapSearchNode nodeStart(query.startX, query.startY);
+        MapSearchNode nodeGoal(query.goalX, query.goalY);
+        AStarSearch<MapSearchNode> astarsearch(nodeStart, nodeGoal);
+        expected.push_back(query.goalX < 40 && astarsearch.preformSearch() == SearchState::SUCCEEDED ? astarsearch.getSolutionCost() : -1.0f);
+    }
+
+    // Every client sends all queries at once and gets results in any order, results are received while sending
+    std::vector<std::vector<BatchRunner::Result>> results(3);
+    std::vector<std::thread> clients;
+    for (auto &clientResults : results)
+    {
+        clients.emplace_back([&socketPath, &queries, &clientResults]()
+                             {
+                                 PathClient client;
+                                 std::string clientError;
+                                 if (!client.connect(socketPath, clientError))
+                                 {
+                                     return;
+                                 }
+                                 std::thread sender([&client, &queries]()
+                                                    { client.send(queries.data(), queries.size()); });
+                                 BatchRunner::Result result;
+                                 while (clientResults.size() < queries.size() && client.receive(result))
+                                 {
+                                     clientResults.push_back(result);
+                                 }
+                                 sender.join(); });
+    }
+    for (auto &client : clients)
+    {
+        client.join();
+    }
+    for (const auto &clientResults : results)
+    {
+        REQUIRE(clientResults.size() == queries.size());
+        std::vector<bool> isAnswered(queries.size(), false);
+        for (const auto &result : clientResults)
+        {
+            REQUIRE(result.id < queries.size());
+            CHECK_FALSE(isAnswered[result.id]);
+            isAnswered[result.id] = true;
+            CHECK(result.state == (expected[result.id] < 0 ? 'I' : 'S'));
+            CHECK(std::fabs(result.cost - expected[result.id]) < 1e-3);
+        }
+    }
+
+    PathClient client;
+    BatchRunner::Result result;
+    REQUIRE(client.connect(socketPath, error));
+    REQUIRE(client.query(queries.front(), result));
+    CHECK(result.id == queries.front().id);
+
+    // Client that doesn't read its results stalls only itself. Its queries are more than server reads
+    // at once and their results don't fit into socket buffers
+    const size_t floodCount = 40000;
+    std::vector<BatchRunner::Query> flood(floodCount, queries.back());
+    PathClient flooder;
+    REQUIRE(flooder.connect(socketPath, error));
+    std::thread floodSender([&flooder, &flood]()
+                            { flooder.send(flood.data(), flood.size()); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    for (const auto &query : queries)
+    {
+        REQUIRE(client.query(query, result));
+        CHECK(result.id == query.id);
+    }
+    size_t floodResults = 0;
+    while (floodResults < floodCount && flooder.receive(result) && result.state == 'I')
+    {
+        ++floodResults;
+    }
+    floodSender.join();
+    CHECK(floodResults == floodCount);
+
+    // Counters are final once workers are joined
+    server.stop();
+    CHECK_FALSE(client.receive(result));
+    CHECK(server.getServedCount() == 3 * queries.size() + 1 + queries.size() + floodCount);
+    CHECK(server.getLatency().getCount() == server.getServedCount());
+    CHECK(server.getBatchSizes().getMax() <= options.batchSize);
+    CHECK(server.getQueueDepth().getCount() == server.getBatchSizes().getCount());
+    std::ostringstream stats;
+    server.printStats(stats);
+    CHECK(stats.str().find("queue depth") != std::string::npos);
+    CHECK_FALSE(std::filesystem::exists(socketPath));
+    CHECK_FALSE(PathClient().connect(socketPath, error));
+    std::remove(mapPath.c_str());
+}